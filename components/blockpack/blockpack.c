@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "zlib.h"
+#include "sdkconfig.h"
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+
+#include "probe.h"
+#include "blockpack.h"
+
+// Deflate settings follow zlib_utils; zlib rejects raw deflate with a window of 8
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+#define MEM_LEVEL (CONFIG_MEM_LEVEL)
+#define COMPRESSION_LEVEL (CONFIG_COMPRESSION_LEVEL)
+#define COMPRESSION_STRATEGY (CONFIG_COMPRESSION_STRATEGY)
+
+// Largest block size accepted from a container (Kconfig range)
+#define MAX_BLOCK_SIZE (1 << 20)
+
+static const char *TAG = "blockpack";
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#if CONFIG_BLOCKPACK_BROTLI
+// Smallest Brotli window covering the block; the decoder sizes its ring buffer from it
+static int brotli_window(size_t len)
+{
+    int lg = BROTLI_MIN_WINDOW_BITS;
+
+    while (lg < BROTLI_MAX_WINDOW_BITS && ((size_t)1 << lg) < len) {
+        lg++;
+    }
+    return lg;
+}
+#endif
+
+/*
+    Compress one block into out (room for len - 1 bytes), falling back to stored
+    when the chosen codec does not make it smaller.
+*/
+static void encode_block(z_stream *strm, const uint8_t *in, size_t len, uint8_t *out, blockpack_block_t *block)
+{
+    probe_result_t res;
+
+    block->raw_len = len;
+    block->crc = crc32(0, in, len);
+
+    probe_run(in, len, &res);
+    probe_verdict_t verdict = probe_verdict(&res);
+
+#if CONFIG_BLOCKPACK_BROTLI
+    if (verdict == PROBE_COMPRESS && res.ratio < CONFIG_BLOCKPACK_BROTLI_RATIO) {
+        size_t size = len - 1;
+        int lgwin = brotli_window(len);
+
+        if (BrotliEncoderCompress(CONFIG_BLOCKPACK_BROTLI_QUALITY, lgwin, BROTLI_MODE_GENERIC,
+                                  len, in, &size, out)) {
+            block->codec = BLOCKPACK_BROTLI;
+            block->window_bits = lgwin;
+            block->comp_len = size;
+            return;
+        }
+    }
+#endif
+
+    if (verdict != PROBE_STORE && deflateReset(strm) == Z_OK) {
+        // A level change flushes through deflate(), which fails without output space
+        strm->next_in = (z_const Bytef *)in;
+        strm->avail_in = 0;
+        strm->next_out = out;
+        strm->avail_out = len - 1;
+
+        int level = verdict == PROBE_FAST ? Z_BEST_SPEED : COMPRESSION_LEVEL;
+        int ret = deflateParams(strm, level, COMPRESSION_STRATEGY);
+        if (ret != Z_OK) {
+            ESP_LOGW(TAG, "deflateParams(%d) failed (%d), storing block", level, ret);
+        } else {
+            strm->avail_in = len;
+            // Z_OK here means the output did not fit in fewer bytes than the input
+            if (deflate(strm, Z_FINISH) == Z_STREAM_END) {
+                block->codec = BLOCKPACK_DEFLATE;
+                block->window_bits = WINDOW_BITS;
+                block->comp_len = strm->total_out;
+                return;
+            }
+        }
+    }
+
+    memcpy(out, in, len);
+    block->codec = BLOCKPACK_STORED;
+    block->window_bits = 0;
+    block->comp_len = len;
+}
+
+esp_err_t blockpack_compress_file(FILE *source, FILE *dest, blockpack_stats_t *stats)
+{
+    esp_err_t ret = ESP_OK;
+    size_t have;
+    z_stream strm;
+    bool strm_ready = false;
+    uint8_t header[BLOCKPACK_HEADER_SIZE];
+    blockpack_block_t block;
+    blockpack_stats_t local;
+
+    uint8_t *in = (uint8_t *)malloc(BLOCKPACK_BLOCK_SIZE);
+    uint8_t *out = (uint8_t *)malloc(BLOCKPACK_BLOCK_SIZE);
+
+    if (stats == NULL) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(blockpack_stats_t));
+
+    if (in == NULL || out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, COMPRESSION_LEVEL, Z_DEFLATED, -WINDOW_BITS, MEM_LEVEL, COMPRESSION_STRATEGY) != Z_OK) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+    strm_ready = true;
+
+    ESP_LOGI(TAG, "Initiated Compression");
+
+    memcpy(header, BLOCKPACK_MAGIC, BLOCKPACK_MAGIC_SIZE);
+    put_u32(header + BLOCKPACK_MAGIC_SIZE, BLOCKPACK_BLOCK_SIZE);
+    if (fwrite(header, 1, BLOCKPACK_FILE_HEADER_SIZE, dest) != BLOCKPACK_FILE_HEADER_SIZE) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+    stats->bytes_out = BLOCKPACK_FILE_HEADER_SIZE;
+
+    while ((have = fread(in, 1, BLOCKPACK_BLOCK_SIZE, source)) > 0) {
+        encode_block(&strm, in, have, out, &block);
+
+        header[0] = block.codec;
+        header[1] = block.window_bits;
+        header[2] = header[3] = 0;
+        put_u32(header + 4, block.raw_len);
+        put_u32(header + 8, block.comp_len);
+        put_u32(header + 12, block.crc);
+
+        if (fwrite(header, 1, BLOCKPACK_HEADER_SIZE, dest) != BLOCKPACK_HEADER_SIZE ||
+                fwrite(out, 1, block.comp_len, dest) != block.comp_len || ferror(dest)) {
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+
+        stats->blocks[block.codec]++;
+        stats->bytes_in += have;
+        stats->bytes_out += BLOCKPACK_HEADER_SIZE + block.comp_len;
+    }
+    if (ferror(source)) {
+        ret = ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Blocks: %u stored, %u deflate, %u brotli", (unsigned)stats->blocks[BLOCKPACK_STORED],
+             (unsigned)stats->blocks[BLOCKPACK_DEFLATE], (unsigned)stats->blocks[BLOCKPACK_BROTLI]);
+
+CLEANUP:
+    if (strm_ready) {
+        (void)deflateEnd(&strm);
+    }
+    free(in);
+    free(out);
+    return ret;
+}
+
+esp_err_t blockpack_read_header(FILE *source, size_t *block_size)
+{
+    uint8_t header[BLOCKPACK_FILE_HEADER_SIZE];
+
+    if (fread(header, 1, BLOCKPACK_FILE_HEADER_SIZE, source) != BLOCKPACK_FILE_HEADER_SIZE ||
+            memcmp(header, BLOCKPACK_MAGIC, BLOCKPACK_MAGIC_SIZE) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *block_size = get_u32(header + BLOCKPACK_MAGIC_SIZE);
+    if (*block_size == 0 || *block_size > MAX_BLOCK_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t blockpack_next_block(FILE *source, blockpack_block_t *block)
+{
+    uint8_t header[BLOCKPACK_HEADER_SIZE];
+    size_t have = fread(header, 1, BLOCKPACK_HEADER_SIZE, source);
+
+    if (have == 0 && !ferror(source)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (have != BLOCKPACK_HEADER_SIZE) {
+        return ferror(source) ? ESP_FAIL : ESP_ERR_INVALID_SIZE;
+    }
+
+    block->codec = header[0];
+    block->window_bits = header[1];
+    block->raw_len = get_u32(header + 4);
+    block->comp_len = get_u32(header + 8);
+    block->crc = get_u32(header + 12);
+
+    if (block->codec >= BLOCKPACK_CODEC_MAX || block->raw_len == 0 || block->comp_len > block->raw_len ||
+            (block->codec == BLOCKPACK_STORED && block->comp_len != block->raw_len)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    return ESP_OK;
+}
+
+esp_err_t blockpack_skip_block(FILE *source, const blockpack_block_t *block)
+{
+    return fseek(source, block->comp_len, SEEK_CUR) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t inflate_block(const blockpack_block_t *block, const uint8_t *in, uint8_t *out)
+{
+    int ret;
+    z_stream strm;
+
+    if (block->window_bits < 9 || block->window_bits > MAX_WBITS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(&strm, 0, sizeof(strm));
+    ret = inflateInit2(&strm, -block->window_bits);
+    if (ret != Z_OK) {
+        return ret == Z_MEM_ERROR ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_ARG;
+    }
+
+    strm.next_in = (z_const Bytef *)in;
+    strm.avail_in = block->comp_len;
+    strm.next_out = out;
+    strm.avail_out = block->raw_len;
+
+    ret = inflate(&strm, Z_FINISH);
+    (void)inflateEnd(&strm);
+
+    if (ret == Z_MEM_ERROR) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ret == Z_STREAM_END && strm.avail_out == 0 ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t blockpack_decode_block(const blockpack_block_t *block, const uint8_t *in, uint8_t *out)
+{
+    esp_err_t ret;
+
+    switch (block->codec) {
+    case BLOCKPACK_STORED:
+        memcpy(out, in, block->raw_len);
+        ret = ESP_OK;
+        break;
+    case BLOCKPACK_DEFLATE:
+        ret = inflate_block(block, in, out);
+        break;
+    case BLOCKPACK_BROTLI: {
+#if CONFIG_BROTLI_DECODER
+        size_t size = block->raw_len;
+        ret = BrotliDecoderDecompress(block->comp_len, in, &size, out) == BROTLI_DECODER_RESULT_SUCCESS &&
+              size == block->raw_len ? ESP_OK : ESP_ERR_INVALID_CRC;
+#else
+        ret = ESP_ERR_NOT_SUPPORTED;
+#endif
+        break;
+    }
+    default:
+        ret = ESP_ERR_INVALID_ARG;
+        break;
+    }
+
+    if (ret == ESP_OK && crc32(0, out, block->raw_len) != block->crc) {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+    return ret;
+}
+
+esp_err_t blockpack_decompress_file(FILE *source, FILE *dest)
+{
+    esp_err_t ret;
+    size_t block_size;
+    blockpack_block_t block;
+    uint8_t *in = NULL;
+    uint8_t *out = NULL;
+
+    ret = blockpack_read_header(source, &block_size);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    in = (uint8_t *)malloc(block_size);
+    out = (uint8_t *)malloc(block_size);
+    if (in == NULL || out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "Initiated Decompression");
+
+    while ((ret = blockpack_next_block(source, &block)) == ESP_OK) {
+        if (block.raw_len > block_size) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+        if (fread(in, 1, block.comp_len, source) != block.comp_len) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+
+        ret = blockpack_decode_block(&block, in, out);
+        if (ret != ESP_OK) {
+            goto CLEANUP;
+        }
+        if (fwrite(out, 1, block.raw_len, dest) != block.raw_len || ferror(dest)) {
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+    }
+    if (ret == ESP_ERR_NOT_FOUND) {
+        ret = ESP_OK;
+    }
+
+CLEANUP:
+    free(in);
+    free(out);
+    return ret;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Adaptive block container: "BPK1" magic and the block size (32-bit LE), then
+    blocks of up to CONFIG_BLOCKPACK_BLOCK_SIZE input bytes, each compressed on its own.
+    The compressibility probe picks the codec per block, so incompressible regions are stored
+    and cost only their header.
+
+    Block header (16 bytes, little endian):
+        u8  codec           blockpack_codec_t
+        u8  window_bits     Window the block was compressed with, 0 if stored
+        u16 reserved
+        u32 raw_len
+        u32 comp_len        Payload bytes following the header
+        u32 crc             CRC-32 of the raw data
+
+    Blocks share no state: readers can skip them by comp_len or decode them in any order.
+*/
+
+#define BLOCKPACK_BLOCK_SIZE (CONFIG_BLOCKPACK_BLOCK_SIZE)
+#define BLOCKPACK_MAGIC "BPK1"
+#define BLOCKPACK_MAGIC_SIZE (4)
+#define BLOCKPACK_FILE_HEADER_SIZE (8)
+#define BLOCKPACK_HEADER_SIZE (16)
+
+typedef enum {
+    BLOCKPACK_STORED,
+    BLOCKPACK_DEFLATE,      // Raw deflate (no zlib/gzip wrapper)
+    BLOCKPACK_BROTLI,
+    BLOCKPACK_CODEC_MAX,
+} blockpack_codec_t;
+
+typedef struct {
+    blockpack_codec_t codec;
+    uint8_t window_bits;
+    uint32_t raw_len;
+    uint32_t comp_len;
+    uint32_t crc;
+} blockpack_block_t;
+
+typedef struct {
+    uint32_t blocks[BLOCKPACK_CODEC_MAX];   // Blocks written per codec
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} blockpack_stats_t;
+
+// stats may be NULL
+esp_err_t blockpack_compress_file(FILE *source, FILE *dest, blockpack_stats_t *stats);
+
+esp_err_t blockpack_decompress_file(FILE *source, FILE *dest);
+
+/*
+    Block level reading, for skipping blocks or handing them to other tasks.
+    blockpack_read_header() checks the magic and returns the block size the container was written with;
+    blockpack_next_block() returns ESP_ERR_NOT_FOUND at the end of the container.
+*/
+esp_err_t blockpack_read_header(FILE *source, size_t *block_size);
+
+esp_err_t blockpack_next_block(FILE *source, blockpack_block_t *block);
+
+esp_err_t blockpack_skip_block(FILE *source, const blockpack_block_t *block);
+
+// Decode one block payload into out (block->raw_len bytes) and verify its CRC; reentrant
+esp_err_t blockpack_decode_block(const blockpack_block_t *block, const uint8_t *in, uint8_t *out);
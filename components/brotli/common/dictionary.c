@@ -5895,7 +5895,16 @@ static BrotliDictionary kBrotliDictionary = {
 #endif
 };
 
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+static const uint8_t* (*kBrotliDictionaryLoader)(void) = NULL;
+#endif
+
 const BrotliDictionary* BrotliGetDictionary() {
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+  if (!kBrotliDictionary.data && kBrotliDictionaryLoader) {
+    kBrotliDictionary.data = kBrotliDictionaryLoader();
+  }
+#endif
   return &kBrotliDictionary;
 }
 
@@ -5909,6 +5918,14 @@ void BrotliSetDictionaryData(const uint8_t* data) {
 #endif
 }
 
+void BrotliSetDictionaryLoader(const uint8_t* (*loader)(void)) {
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+  kBrotliDictionaryLoader = loader;
+#else
+  BROTLI_UNUSED(loader);
+#endif
+}
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }  /* extern "C" */
 #endif
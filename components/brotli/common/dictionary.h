@@ -54,6 +54,17 @@ BROTLI_COMMON_API const BrotliDictionary* BrotliGetDictionary(void);
  */
 BROTLI_COMMON_API void BrotliSetDictionaryData(const uint8_t* data);
 
+/**
+ * Sets a callback that provides dictionary data on first use.
+ *
+ * When dictionary data is not set, BrotliGetDictionary invokes the loader and
+ * keeps the returned pointer. A loader returning NULL leaves the dictionary
+ * unset; it is retried on the next BrotliGetDictionary call.
+ * Only effective when built with BROTLI_EXTERNAL_DICTIONARY_DATA.
+ */
+BROTLI_COMMON_API void BrotliSetDictionaryLoader(
+    const uint8_t* (*loader)(void));
+
 #define BROTLI_MIN_DICTIONARY_WORD_LENGTH 4
 #define BROTLI_MAX_DICTIONARY_WORD_LENGTH 24
 
@@ -64,6 +64,9 @@ typedef enum BrotliEncoderFlintState {
 
 typedef struct BrotliEncoderStateStruct {
   BrotliEncoderParams params;
+  /* params as set by the user, before EnsureInitialized() derived the rest;
+     BrotliEncoderReset() starts the next stream from these. */
+  BrotliEncoderParams requested_params_;
 
   MemoryManager memory_manager_;
 
@@ -90,6 +93,9 @@ typedef struct BrotliEncoderStateStruct {
   uint8_t* storage_;
 
   Hasher hasher_;
+  /* Quality the hasher was set up for when BrotliEncoderReset() kept it,
+     -1 if not kept. */
+  int kept_hasher_quality_;
 
   /* Hash table for FAST_ONE_PASS_COMPRESSION_QUALITY mode. */
   int small_table_[1 << 10];  /* 4KiB */
@@ -688,12 +694,17 @@ static void ChooseDistanceParams(BrotliEncoderParams* params) {
 static BROTLI_BOOL EnsureInitialized(BrotliEncoderState* s) {
   if (BROTLI_IS_OOM(&s->memory_manager_)) return BROTLI_FALSE;
   if (s->is_initialized_) return BROTLI_TRUE;
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+  /* Static dictionary could not be loaded; encoder would dereference NULL. */
+  if (!s->params.dictionary.words->data) return BROTLI_FALSE;
+#endif
 
   s->last_bytes_bits_ = 0;
   s->last_bytes_ = 0;
   s->flint_ = BROTLI_FLINT_DONE;
   s->remaining_metadata_bytes_ = BROTLI_UINT32_MAX;
 
+  s->requested_params_ = s->params;
   SanitizeParams(&s->params);
   s->params.lgblock = ComputeLgBlock(&s->params);
   ChooseDistanceParams(&s->params);
@@ -709,6 +720,7 @@ static BROTLI_BOOL EnsureInitialized(BrotliEncoderState* s) {
   }
 
   RingBufferSetup(&s->params, &s->ringbuffer_);
+  RingBufferReset(&s->memory_manager_, &s->ringbuffer_);
 
   /* Initialize last byte with stream header. */
   {
@@ -767,6 +779,7 @@ static void BrotliEncoderInitState(BrotliEncoderState* s) {
   s->storage_size_ = 0;
   s->storage_ = 0;
   HasherInit(&s->hasher_);
+  s->kept_hasher_quality_ = -1;
   s->large_table_ = NULL;
   s->large_table_size_ = 0;
   s->cmd_code_numbits_ = 0;
@@ -827,6 +840,49 @@ static void BrotliEncoderCleanupState(BrotliEncoderState* s) {
   BROTLI_FREE(m, s->literal_buf_);
 }
 
+BROTLI_BOOL BrotliEncoderReset(BrotliEncoderState* s) {
+  MemoryManager* m = &s->memory_manager_;
+  if (BROTLI_IS_OOM(m)) return BROTLI_FALSE;
+
+  /* Storage, commands and the fast-quality tables only ever grow, and the
+     ring buffer is checked against the new sizes in EnsureInitialized(). */
+  if (s->hasher_.common.extra != NULL) {
+    HasherReset(&s->hasher_);
+    /* H10 is sized by the input of one-shot streams. */
+    if (s->hasher_.common.params.type == 10) {
+      DestroyHasher(m, &s->hasher_);
+    } else if (s->kept_hasher_quality_ < 0) {
+      s->kept_hasher_quality_ = s->params.quality;
+    }
+  }
+  if (s->is_initialized_) {
+    s->params = s->requested_params_;
+  }
+
+  s->input_pos_ = 0;
+  s->num_commands_ = 0;
+  s->num_literals_ = 0;
+  s->last_insert_len_ = 0;
+  s->last_flush_pos_ = 0;
+  s->last_processed_pos_ = 0;
+  s->prev_byte_ = 0;
+  s->prev_byte2_ = 0;
+  s->cmd_code_numbits_ = 0;
+  s->next_out_ = NULL;
+  s->available_out_ = 0;
+  s->total_out_ = 0;
+  s->stream_state_ = BROTLI_STREAM_PROCESSING;
+  s->is_last_block_emitted_ = BROTLI_FALSE;
+  s->is_initialized_ = BROTLI_FALSE;
+
+  s->dist_cache_[0] = 4;
+  s->dist_cache_[1] = 11;
+  s->dist_cache_[2] = 15;
+  s->dist_cache_[3] = 16;
+  memcpy(s->saved_dist_cache_, s->dist_cache_, sizeof(s->saved_dist_cache_));
+  return BROTLI_TRUE;
+}
+
 /* Deinitializes and frees BrotliEncoderState instance. */
 void BrotliEncoderDestroyInstance(BrotliEncoderState* state) {
   if (!state) {
@@ -957,6 +1013,21 @@ static void ExtendLastCommand(BrotliEncoderState* s, uint32_t* bytes,
    Returns BROTLI_FALSE if the size of the input data is larger than
    input_block_size().
  */
+/* A hasher kept by BrotliEncoderReset() is reused only if this stream would
+   choose the same one; H40-H42 also depend on the quality. */
+static void DropStaleHasher(BrotliEncoderState* s) {
+  BrotliHasherParams hparams = s->hasher_.common.params;
+  ChooseHasher(&s->params, &hparams);
+  if (s->params.quality != s->kept_hasher_quality_ ||
+      memcmp(&hparams, &s->hasher_.common.params, sizeof(hparams)) != 0) {
+    DestroyHasher(&s->memory_manager_, &s->hasher_);
+  } else {
+    /* HasherSetup() sets these only when it allocates. */
+    s->params.hasher = hparams;
+  }
+  s->kept_hasher_quality_ = -1;
+}
+
 static BROTLI_BOOL EncodeData(
     BrotliEncoderState* s, const BROTLI_BOOL is_last,
     const BROTLI_BOOL force_flush, size_t* out_size, uint8_t** output) {
@@ -1055,6 +1126,7 @@ static BROTLI_BOOL EncodeData(
     }
   }
 
+  if (s->kept_hasher_quality_ >= 0) DropStaleHasher(s);
   InitOrStitchToPreviousBlock(m, &s->hasher_, data, mask, &s->params,
       wrapped_last_processed_pos, bytes, is_last);
 
@@ -1231,6 +1303,10 @@ static BROTLI_BOOL BrotliCompressBufferQuality10(
   uint8_t prev_byte2 = 0;
 
   Hasher hasher;
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+  /* Static dictionary could not be loaded; encoder would dereference NULL. */
+  if (!BrotliGetDictionary()->data) return BROTLI_FALSE;
+#endif
   HasherInit(&hasher);
 
   BrotliEncoderInitParams(&params);
@@ -9,7 +9,7 @@
 #ifndef BROTLI_ENC_RINGBUFFER_H_
 #define BROTLI_ENC_RINGBUFFER_H_
 
-#include <string.h>  /* memcpy */
+#include <string.h>  /* memcpy, memset */
 
 #include "../common/platform.h"
 #include "brotli/types.h"
@@ -67,6 +67,26 @@ static BROTLI_INLINE void RingBufferFree(MemoryManager* m, RingBuffer* rb) {
   BROTLI_FREE(m, rb->data_);
 }
 
+/* Starts over at position 0 after RingBufferSetup() for a new stream. The
+   buffer of the previous stream is kept if it is not bigger than the new
+   total size, and left as a fresh allocation of the same size would be. */
+static BROTLI_INLINE void RingBufferReset(MemoryManager* m, RingBuffer* rb) {
+  rb->pos_ = 0;
+  if (!rb->data_) return;
+  if (rb->cur_size_ > rb->total_size_) {
+    BROTLI_FREE(m, rb->data_);
+    RingBufferInit(rb);
+    return;
+  }
+  rb->buffer_[-2] = rb->buffer_[-1] = 0;
+  if (rb->cur_size_ == rb->total_size_) {
+    /* RingBufferWrite() initializes these only when it allocates. */
+    rb->buffer_[rb->size_ - 2] = 0;
+    rb->buffer_[rb->size_ - 1] = 0;
+    rb->buffer_[rb->size_] = 241;
+  }
+}
+
 /* Allocates or re-allocates data_ to the given length + plus some slack
    region before and after. Fills the slack regions with zeros. */
 static BROTLI_INLINE void RingBufferInitBuffer(
@@ -112,8 +132,14 @@ static BROTLI_INLINE void RingBufferWrite(
        size, otherwise it is likely that other blocks will follow and we
        will need to reallocate to the full size anyway. */
     rb->pos_ = (uint32_t)n;
-    RingBufferInitBuffer(m, rb->pos_, rb);
-    if (BROTLI_IS_OOM(m)) return;
+    if (!rb->data_ || rb->cur_size_ < n) {
+      RingBufferInitBuffer(m, rb->pos_, rb);
+      if (BROTLI_IS_OOM(m)) return;
+    } else {
+      /* Buffer kept by RingBufferReset(): big enough, only clear the slack
+         after the data as RingBufferInitBuffer() would. */
+      memset(&rb->buffer_[n], 0, 7);  /* kSlackForEightByteHashingEverywhere */
+    }
     memcpy(rb->buffer_, bytes, n);
     return;
   }
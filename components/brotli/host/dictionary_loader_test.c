@@ -0,0 +1,192 @@
+/*
+    Host test of the external static dictionary (CONFIG_BROTLI_EXTERNAL_DICTIONARY): the file
+    loader in port/dictionary_loader.c, its failure paths and the encoder guards that keep a
+    missing dictionary from being dereferenced.
+
+    Run from the repository root, exits non-zero on failure.
+*/
+
+// Build:
+//   C=components
+//   gcc -O2 -DBROTLI_EXTERNAL_DICTIONARY_DATA -Itools/host/include -I$C/brotli/include -o dictionary_loader_test $C/brotli/host/dictionary_loader_test.c $C/brotli/port/dictionary_loader.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c -lm -lpthread
+//   ./dictionary_loader_test [components/brotli/common/dictionary.bin]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+#include "brotli_dictionary.h"
+
+#define DICTIONARY_PATH "components/brotli/common/dictionary.bin"
+#define SHORT_PATH "dictionary_loader_test.short"
+#define FIRST_USE_THREADS (8)
+
+// English text, so that qualities >= 2 find static dictionary words
+static const char *s_words[] = {
+    "the ", "information ", "available ", "between ", "government ", "development ",
+    "international ", "management ", "of ", "and ", "which ", "following ", "different ",
+    "experience ", "performance ", "environment ", "important ", "because ", "through ",
+};
+
+static int s_failures;
+
+static void check(int ok, const char *what)
+{
+    printf("%s: %s\n", ok ? "ok  " : "FAIL", what);
+    if (!ok) {
+        s_failures++;
+    }
+}
+
+static size_t make_text(uint8_t *buf, size_t len)
+{
+    size_t pos = 0;
+    srand(1);
+    while (pos < len) {
+        const char *w = s_words[rand() % (sizeof(s_words) / sizeof(s_words[0]))];
+        size_t n = strlen(w);
+        if (pos + n > len) {
+            break;
+        }
+        memcpy(buf + pos, w, n);
+        pos += n;
+    }
+    return pos;
+}
+
+static int stream_compress(int quality, const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len)
+{
+    BrotliEncoderState *enc = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    size_t avail_in = in_len;
+    size_t avail_out = *out_len;
+    int ok;
+
+    BrotliEncoderSetParameter(enc, BROTLI_PARAM_QUALITY, quality);
+    ok = BrotliEncoderCompressStream(enc, BROTLI_OPERATION_FINISH, &avail_in, &in, &avail_out, &out, NULL) &&
+         BrotliEncoderIsFinished(enc);
+    BrotliEncoderDestroyInstance(enc);
+    *out_len -= avail_out;
+    return ok;
+}
+
+// One-shot compression then decompression must give the input back
+static int round_trip(int quality, const uint8_t *in, size_t in_len, size_t *out_len)
+{
+    size_t enc_len = BrotliEncoderMaxCompressedSize(in_len);
+    uint8_t *enc = malloc(enc_len);
+    uint8_t *dec = malloc(in_len);
+    size_t dec_len = in_len;
+    int ok = BrotliEncoderCompress(quality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, in_len, in, &enc_len, enc) &&
+             BrotliDecoderDecompress(enc_len, enc, &dec_len, dec) == BROTLI_DECODER_RESULT_SUCCESS &&
+             dec_len == in_len && memcmp(dec, in, in_len) == 0;
+    *out_len = enc_len;
+    free(enc);
+    free(dec);
+    return ok;
+}
+
+static uint8_t s_text[64 * 1024];
+static size_t s_text_len;
+static pthread_barrier_t s_start;
+
+// First use from several threads at once, as compsvc workers or a codec pool would
+static void *first_use(void *arg)
+{
+    size_t out_len = 96 * 1024;
+    uint8_t *out = malloc(out_len);
+    pthread_barrier_wait(&s_start);
+    int ok = out != NULL && stream_compress(5, s_text, s_text_len, out, &out_len) && out_len < s_text_len / 2;
+    free(out);
+    *(int *)arg = ok;
+    return NULL;
+}
+
+// Mappings of the dictionary file in this process (Linux)
+static int count_mappings(const char *path)
+{
+    char line[512];
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    int n = 0;
+    FILE *f = fopen("/proc/self/maps", "r");
+
+    if (f == NULL) {
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        n += strstr(line, name) != NULL;
+    }
+    fclose(f);
+    return n;
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = argc > 1 ? argv[1] : DICTIONARY_PATH;
+    char long_name[128];
+    uint8_t *text = s_text;
+    static uint8_t out[96 * 1024];
+    size_t text_len = s_text_len = make_text(text, sizeof(s_text));
+    size_t out_len;
+    size_t stored_len;
+
+    // Registration
+    check(brotli_dictionary_use_partition(NULL) == ESP_ERR_NOT_SUPPORTED, "no partitions on host");
+    memset(long_name, 'a', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = '\0';
+    check(brotli_dictionary_use_file(long_name) == ESP_ERR_INVALID_ARG, "over-long path refused");
+    check(brotli_dictionary_use_file(NULL) == ESP_ERR_INVALID_ARG, "NULL path refused");
+
+    // Missing dictionary: the encoder must fail cleanly, one-shot falls back to stored data
+    check(brotli_dictionary_load() == ESP_ERR_NOT_FOUND, "nothing registered, not found");
+    out_len = sizeof(out);
+    check(!stream_compress(5, text, text_len, out, &out_len), "streaming quality 5 refused without dictionary");
+    check(round_trip(5, text, text_len, &stored_len) && stored_len > text_len, "one-shot quality 5 stored");
+    check(round_trip(10, text, text_len, &stored_len) && stored_len > text_len, "one-shot quality 10 stored");
+    check(round_trip(11, text, text_len, &stored_len) && stored_len > text_len, "one-shot quality 11 stored");
+
+    check(brotli_dictionary_use_file("dictionary_loader_test.missing") == ESP_OK, "missing file registered");
+    check(brotli_dictionary_load() == ESP_ERR_NOT_FOUND, "missing file, not found");
+    check(round_trip(10, text, text_len, &stored_len) && stored_len > text_len, "missing file, quality 10 stored");
+
+    FILE *f = fopen(SHORT_PATH, "wb");
+    if (f != NULL) {
+        fwrite(text, 1, 1000, f);
+        fclose(f);
+    }
+    check(brotli_dictionary_use_file(SHORT_PATH) == ESP_OK, "short file registered");
+    check(brotli_dictionary_load() == ESP_ERR_NOT_FOUND, "short file, not found");
+    remove(SHORT_PATH);
+
+    // The loader is retried until it succeeds, and maps the file once however many threads race for it
+    check(brotli_dictionary_use_file(path) == ESP_OK, "dictionary file registered");
+    pthread_t threads[FIRST_USE_THREADS];
+    int results[FIRST_USE_THREADS];
+    pthread_barrier_init(&s_start, NULL, FIRST_USE_THREADS);
+    for (int i = 0; i < FIRST_USE_THREADS; i++) {
+        pthread_create(&threads[i], NULL, first_use, &results[i]);
+    }
+    int all_ok = 1;
+    for (int i = 0; i < FIRST_USE_THREADS; i++) {
+        pthread_join(threads[i], NULL);
+        all_ok &= results[i];
+    }
+    pthread_barrier_destroy(&s_start);
+    check(all_ok, "concurrent first use compresses");
+    check(count_mappings(path) == 1, "dictionary mapped once");
+    check(brotli_dictionary_load() == ESP_OK, "dictionary file mapped");
+    check(brotli_dictionary_use_file(path) == ESP_ERR_INVALID_STATE, "no swapping once loaded");
+
+    for (int q = 0; q <= 11; q++) {
+        char what[64];
+        snprintf(what, sizeof(what), "quality %d round trip, compressed", q);
+        check(round_trip(q, text, text_len, &out_len) && out_len < text_len / 2, what);
+    }
+    out_len = sizeof(out);
+    check(stream_compress(5, text, text_len, out, &out_len) && out_len < text_len / 2, "streaming quality 5");
+
+    printf("%d failures\n", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -0,0 +1,211 @@
+/*
+    Host test of BrotliEncoderReset(): one instance reset between streams must produce the same
+    bytes as a fresh instance with the same parameters. Streams pick random quality (0-11),
+    window (10-24), length (up to 200K), size hint and split the input over process and flush
+    operations; the reset instance keeps whatever the previous stream left behind. Each
+    stream is also decoded and compared. Then prints allocations per message, fresh instance
+    against reset, for 100 byte to 4K messages.
+
+    Input is assets/hello-world.bin followed by copies of assets/demo.txt. Run from the
+    repository root, exits non-zero on failure.
+*/
+
+// Build:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/brotli/include -o encoder_reset_test $C/brotli/host/encoder_reset_test.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c -lm
+//   ./encoder_reset_test
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+
+#define BINARY_PATH "assets/hello-world.bin"
+#define TEXT_PATH "assets/demo.txt"
+#define TEXT_COPIES (16)
+#define DATA_MAX (300 * 1024)
+#define OUT_SIZE (1 << 20)
+#define STREAMS (700)
+#define LARGE_STREAM (200000)
+#define SMALL_STREAM (5000)
+#define LARGE_HINT (2000000)
+
+static uint8_t s_data[DATA_MAX];
+static size_t s_data_len;
+static long s_allocs;
+
+static void *counting_alloc(void *opaque, size_t size)
+{
+    (void)opaque;
+    s_allocs++;
+    return malloc(size);
+}
+
+static void counting_free(void *opaque, void *address)
+{
+    (void)opaque;
+    free(address);
+}
+
+static int append_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        printf("cannot open %s, run from the repository root\n", path);
+        return 0;
+    }
+    s_data_len += fread(s_data + s_data_len, 1, DATA_MAX - s_data_len, f);
+    fclose(f);
+    return 1;
+}
+
+static void set_params(BrotliEncoderState *s, int quality, int window, size_t hint)
+{
+    BrotliEncoderSetParameter(s, BROTLI_PARAM_QUALITY, (uint32_t)quality);
+    BrotliEncoderSetParameter(s, BROTLI_PARAM_LGWIN, (uint32_t)window);
+    BrotliEncoderSetParameter(s, BROTLI_PARAM_SIZE_HINT, (uint32_t)hint);
+}
+
+/*
+    Compresses in chunks pieces, every third one followed by a flush; returns the compressed
+    length, 0 on failure.
+*/
+static size_t encode(BrotliEncoderState *s, const uint8_t *in, size_t len, uint8_t *out, int chunks)
+{
+    size_t avail_out = OUT_SIZE, off = 0;
+    size_t step = len / chunks + 1;
+    uint8_t *next_out = out;
+
+    for (int c = 0;; c++) {
+        size_t take = off + step < len ? step : len - off;
+        int last = off + take >= len;
+        const uint8_t *next_in = in + off;
+        size_t avail_in = take;
+        BrotliEncoderOperation op = last ? BROTLI_OPERATION_FINISH :
+                                    (c % 3 == 1 ? BROTLI_OPERATION_FLUSH : BROTLI_OPERATION_PROCESS);
+        do {
+            if (!BrotliEncoderCompressStream(s, op, &avail_in, &next_in, &avail_out, &next_out, NULL)) {
+                return 0;
+            }
+        } while (avail_in > 0 || BrotliEncoderHasMoreOutput(s) || (last && !BrotliEncoderIsFinished(s)));
+        off += take;
+        if (last) {
+            break;
+        }
+    }
+    return OUT_SIZE - avail_out;
+}
+
+static int check_equivalence(void)
+{
+    uint8_t *reset_out = (uint8_t *)malloc(OUT_SIZE);
+    uint8_t *fresh_out = (uint8_t *)malloc(OUT_SIZE);
+    uint8_t *back = (uint8_t *)malloc(OUT_SIZE);
+    BrotliEncoderState *r = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+    int bad = 0;
+
+    if (reset_out == NULL || fresh_out == NULL || back == NULL || r == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    srand(1);
+    for (int i = 0; i < STREAMS; i++) {
+        int quality = rand() % 12, window = 10 + rand() % 15, chunks = 1 + rand() % 4;
+        size_t len = i % 4 == 0 ? (size_t)rand() % LARGE_STREAM : (size_t)rand() % SMALL_STREAM;
+        size_t hint = i % 9 == 0 ? LARGE_HINT : 0;
+        const uint8_t *in = s_data + rand() % (s_data_len - len);
+
+        if (!BrotliEncoderReset(r)) {
+            printf("stream %d: reset failed\n", i);
+            bad++;
+            break;
+        }
+        set_params(r, quality, window, hint);
+        BrotliEncoderState *fresh = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+        if (fresh == NULL) {
+            bad++;
+            break;
+        }
+        set_params(fresh, quality, window, hint);
+
+        size_t reset_len = encode(r, in, len, reset_out, chunks);
+        size_t fresh_len = encode(fresh, in, len, fresh_out, chunks);
+        BrotliEncoderDestroyInstance(fresh);
+
+        size_t back_len = OUT_SIZE;
+        BrotliDecoderResult dr = BrotliDecoderDecompress(reset_len, reset_out, &back_len, back);
+        if (reset_len == 0 || reset_len != fresh_len || memcmp(reset_out, fresh_out, reset_len) != 0 ||
+            dr != BROTLI_DECODER_RESULT_SUCCESS || back_len != len || memcmp(back, in, len) != 0) {
+            if (bad < 10) {
+                printf("stream %d (quality %d, window %d, %u bytes, %d chunks): %u bytes reset, %u fresh\n",
+                       i, quality, window, (unsigned)len, chunks, (unsigned)reset_len, (unsigned)fresh_len);
+            }
+            bad++;
+        }
+    }
+    printf("%d streams, %d differ from a fresh instance: %s\n", STREAMS, bad, bad ? "FAILED" : "ok");
+
+    BrotliEncoderDestroyInstance(r);
+    free(reset_out);
+    free(fresh_out);
+    free(back);
+    return bad != 0;
+}
+
+static int print_allocs(void)
+{
+    const int quality[] = { 1, 5, 9 }, window[] = { 18, 18, 22 };
+    const size_t sizes[] = { 100, 1024, 4096 };
+    uint8_t *out = (uint8_t *)malloc(OUT_SIZE);
+    int fail = 0;
+
+    if (out == NULL) {
+        return 1;
+    }
+    printf("\nAllocations per message, fresh instance -> reset:\n");
+    for (int c = 0; c < 3; c++) {
+        printf("  quality %d, window %d:", quality[c], window[c]);
+        for (int s = 0; s < 3; s++) {
+            int count = quality[c] >= 5 ? 100 : 1000;
+            long allocs = s_allocs;
+            for (int m = 0; m < count; m++) {
+                BrotliEncoderState *e = BrotliEncoderCreateInstance(counting_alloc, counting_free, NULL);
+                set_params(e, quality[c], window[c], 0);
+                fail |= encode(e, s_data + m * 97 % (s_data_len - sizes[s]), sizes[s], out, 1) == 0;
+                BrotliEncoderDestroyInstance(e);
+            }
+            double fresh = (double)(s_allocs - allocs) / count;
+
+            BrotliEncoderState *e = BrotliEncoderCreateInstance(counting_alloc, counting_free, NULL);
+            allocs = s_allocs;
+            for (int m = 0; m < count; m++) {
+                fail |= !BrotliEncoderReset(e);
+                set_params(e, quality[c], window[c], 0);
+                fail |= encode(e, s_data + m * 97 % (s_data_len - sizes[s]), sizes[s], out, 1) == 0;
+            }
+            BrotliEncoderDestroyInstance(e);
+            printf(" %u B %.1f -> %.1f%s", (unsigned)sizes[s], fresh, (double)(s_allocs - allocs) / count, s < 2 ? "," : "\n");
+        }
+    }
+    free(out);
+    return fail;
+}
+
+int main(void)
+{
+    int ok = append_file(BINARY_PATH);
+    for (int i = 0; ok && i < TEXT_COPIES; i++) {
+        ok = append_file(TEXT_PATH);
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    int fail = check_equivalence();
+    fail |= print_allocs();
+    return fail;
+}
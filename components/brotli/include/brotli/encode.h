@@ -273,6 +273,22 @@ extern "C"
  */
   BROTLI_ENC_API void BrotliEncoderDestroyInstance(BrotliEncoderState *state);
 
+  /**
+ * Prepares the instance for a new stream, keeping its allocations.
+ *
+ * Parameters set with ::BrotliEncoderSetParameter stay in effect and can be
+ * changed before the next stream. Ring buffer, hash tables and work buffers
+ * are reused when the new parameters need no more memory than the previous
+ * stream had; otherwise they are reallocated as by a fresh instance. The
+ * output is the same as that of a fresh instance with the same parameters.
+ *
+ * @param state encoder instance to be reset
+ * @returns ::BROTLI_FALSE if the instance ran out of memory and has to be
+ *          destroyed
+ * @returns ::BROTLI_TRUE otherwise
+ */
+  BROTLI_ENC_API BROTLI_BOOL BrotliEncoderReset(BrotliEncoderState *state);
+
   /**
  * Calculates the output size bound for the given @p input_size.
  *
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "esp_err.h"
+
+/*
+    External static dictionary (CONFIG_BROTLI_EXTERNAL_DICTIONARY).
+    The ~120K RFC 7932 dictionary is left out of the app image and mapped on demand
+    the first time an encoder or decoder instance is created.
+    The source only needs to be registered before that; nothing is read until then.
+    The mapping itself is serialized, so it happens once even when codecs are first created
+    on several threads (compsvc workers, codec pools). Still register the source and call
+    brotli_dictionary_load() before starting such threads: the first use also publishes the
+    pointer to the Brotli library, which does not lock.
+    Write common/dictionary.bin to the partition with:
+        parttool.py write_partition --partition-name <label> --input common/dictionary.bin
+*/
+
+#define BROTLI_DICTIONARY_SIZE (122784)
+
+// Map the dictionary from a raw data partition (ESP32 only); NULL uses CONFIG_BROTLI_DICTIONARY_PARTITION
+esp_err_t brotli_dictionary_use_partition(const char *label);
+
+// Map (host) or read (ESP32) the dictionary from a file
+esp_err_t brotli_dictionary_use_file(const char *path);
+
+// Load the registered dictionary now instead of on first use
+esp_err_t brotli_dictionary_load(void);
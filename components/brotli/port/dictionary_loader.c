@@ -0,0 +1,202 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "esp_log.h"
+
+#include "brotli_dictionary.h"
+#include "../common/dictionary.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#include "esp_spi_flash.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define DICTIONARY_SOURCE_MAX (64)
+
+static const char *TAG = "brotli_dictionary";
+
+#if defined(BROTLI_EXTERNAL_DICTIONARY_DATA)
+
+typedef enum {
+    SOURCE_NONE,
+    SOURCE_PARTITION,
+    SOURCE_FILE,
+} dictionary_source_t;
+
+static dictionary_source_t s_source = SOURCE_NONE;
+static char s_name[DICTIONARY_SOURCE_MAX];
+static const uint8_t *s_data = NULL;
+// Codecs may be created on several threads; one of them maps the dictionary, the others wait
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static const uint8_t *map_partition(const char *label)
+{
+#ifdef ESP_PLATFORM
+    const void *ptr;
+    spi_flash_mmap_handle_t handle;
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                                           ESP_PARTITION_SUBTYPE_ANY, label);
+    if (part == NULL) {
+        ESP_LOGE(TAG, "Partition %s not found", label);
+        return NULL;
+    }
+    if (part->size < BROTLI_DICTIONARY_SIZE) {
+        ESP_LOGE(TAG, "Partition %s too small", label);
+        return NULL;
+    }
+
+    // The mapping is never released; the dictionary cannot be swapped once set
+    if (esp_partition_mmap(part, 0, BROTLI_DICTIONARY_SIZE, SPI_FLASH_MMAP_DATA, &ptr, &handle) != ESP_OK) {
+        ESP_LOGE(TAG, "Could not map partition %s", label);
+        return NULL;
+    }
+    return (const uint8_t *)ptr;
+#else
+    (void)label;
+    return NULL;
+#endif
+}
+
+static const uint8_t *map_file(const char *path)
+{
+#ifdef ESP_PLATFORM
+    // VFS has no mmap; the dictionary is read into heap instead
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        ESP_LOGE(TAG, "Could not open %s", path);
+        return NULL;
+    }
+
+    uint8_t *data = malloc(BROTLI_DICTIONARY_SIZE);
+    if (data == NULL) {
+        fclose(file);
+        return NULL;
+    }
+
+    if (fread(data, 1, BROTLI_DICTIONARY_SIZE, file) != BROTLI_DICTIONARY_SIZE) {
+        ESP_LOGE(TAG, "Short read from %s", path);
+        free(data);
+        data = NULL;
+    }
+    fclose(file);
+    return data;
+#else
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "Could not open %s", path);
+        return NULL;
+    }
+
+    if (fstat(fd, &st) != 0 || st.st_size < BROTLI_DICTIONARY_SIZE) {
+        ESP_LOGE(TAG, "%s is not a dictionary file", path);
+        close(fd);
+        return NULL;
+    }
+
+    void *ptr = mmap(NULL, BROTLI_DICTIONARY_SIZE, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    return ptr == MAP_FAILED ? NULL : (const uint8_t *)ptr;
+#endif
+}
+
+static const uint8_t *dictionary_loader(void)
+{
+    pthread_mutex_lock(&s_lock);
+    if (s_data != NULL) {
+        goto DONE;
+    }
+
+    switch (s_source) {
+    case SOURCE_PARTITION:
+        s_data = map_partition(s_name);
+        break;
+    case SOURCE_FILE:
+        s_data = map_file(s_name);
+        break;
+    default:
+        break;
+    }
+
+    if (s_data != NULL) {
+        ESP_LOGI(TAG, "Loaded static dictionary from %s", s_name);
+    }
+
+DONE:
+    pthread_mutex_unlock(&s_lock);
+    return s_data;
+}
+
+static esp_err_t register_source(dictionary_source_t source, const char *name)
+{
+    if (name == NULL || strlen(name) >= DICTIONARY_SOURCE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    if (s_data != NULL) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    strcpy(s_name, name);
+    s_source = source;
+    BrotliSetDictionaryLoader(dictionary_loader);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t brotli_dictionary_use_partition(const char *label)
+{
+#ifdef ESP_PLATFORM
+    if (label == NULL) {
+        label = CONFIG_BROTLI_DICTIONARY_PARTITION;
+    }
+    return register_source(SOURCE_PARTITION, label);
+#else
+    (void)label;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t brotli_dictionary_use_file(const char *path)
+{
+    return register_source(SOURCE_FILE, path);
+}
+
+esp_err_t brotli_dictionary_load(void)
+{
+    return BrotliGetDictionary()->data != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+#else
+
+// Dictionary is built into the image; nothing to load
+
+esp_err_t brotli_dictionary_use_partition(const char *label)
+{
+    (void)label;
+    ESP_LOGW(TAG, "CONFIG_BROTLI_EXTERNAL_DICTIONARY is disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t brotli_dictionary_use_file(const char *path)
+{
+    (void)path;
+    ESP_LOGW(TAG, "CONFIG_BROTLI_EXTERNAL_DICTIONARY is disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t brotli_dictionary_load(void)
+{
+    return ESP_OK;
+}
+
+#endif
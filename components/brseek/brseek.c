@@ -0,0 +1,431 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+#include "sdkconfig.h"
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+
+#include "brseek.h"
+
+// Largest chunk size accepted from a file (Kconfig range)
+#define MAX_CHUNK_SIZE (1 << 24)
+#define INDEX_GROW (16)
+
+static const char *TAG = "brseek";
+
+typedef struct {
+    long coffset;
+    size_t uoffset;
+    uint32_t comp_len;
+    uint32_t raw_len;
+    uint32_t crc;
+} brseek_chunk_t;
+
+struct brseek {
+    FILE *source;
+    brseek_chunk_t *chunks;
+    size_t count;
+    size_t size;
+    uint8_t *in;
+    uint8_t *out;
+};
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#if CONFIG_BROTLI_ENCODER
+// Smallest Brotli window covering a chunk; the decoder sizes its ring buffer from it
+static int brotli_window(size_t len)
+{
+    int lg = BROTLI_MIN_WINDOW_BITS;
+
+    while (lg < BROTLI_MAX_WINDOW_BITS && ((size_t)1 << lg) < len) {
+        lg++;
+    }
+    return lg;
+}
+
+// Stream the next chunk of source into dest; ESP_ERR_NOT_FOUND when source is exhausted
+static esp_err_t compress_chunk(FILE *source, FILE *dest, uint8_t *in, uint8_t *out, uint8_t *entry)
+{
+    esp_err_t ret = ESP_OK;
+    BrotliEncoderState *enc = NULL;
+    BrotliEncoderOperation op = BROTLI_OPERATION_PROCESS;
+    uint32_t raw_len = 0, comp_len = 0, crc = 0;
+
+    while (op != BROTLI_OPERATION_FINISH) {
+        size_t want = BRSEEK_CHUNK_SIZE - raw_len < BRSEEK_BUFFER_SIZE ? BRSEEK_CHUNK_SIZE - raw_len : BRSEEK_BUFFER_SIZE;
+        size_t have = fread(in, 1, want, source);
+        if (ferror(source)) {
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+        if (have == 0 && raw_len == 0) {
+            ret = ESP_ERR_NOT_FOUND;
+            goto CLEANUP;
+        }
+
+        if (enc == NULL) {
+            enc = BrotliEncoderCreateInstance(NULL, NULL, NULL);
+            if (enc == NULL) {
+                ret = ESP_ERR_NO_MEM;
+                goto CLEANUP;
+            }
+            BrotliEncoderSetParameter(enc, BROTLI_PARAM_QUALITY, CONFIG_BRSEEK_QUALITY);
+            BrotliEncoderSetParameter(enc, BROTLI_PARAM_LGWIN, brotli_window(BRSEEK_CHUNK_SIZE));
+            BrotliEncoderSetParameter(enc, BROTLI_PARAM_SIZE_HINT, BRSEEK_CHUNK_SIZE);
+        }
+
+        raw_len += have;
+        crc = crc32(crc, in, have);
+        // A short read is the end of the source
+        if (raw_len == BRSEEK_CHUNK_SIZE || have < want) {
+            op = BROTLI_OPERATION_FINISH;
+        }
+
+        const uint8_t *next_in = in;
+        size_t avail_in = have;
+        do {
+            uint8_t *next_out = out;
+            size_t avail_out = BRSEEK_BUFFER_SIZE;
+
+            if (!BrotliEncoderCompressStream(enc, op, &avail_in, &next_in, &avail_out, &next_out, NULL)) {
+                ret = ESP_FAIL;
+                goto CLEANUP;
+            }
+            size_t n = BRSEEK_BUFFER_SIZE - avail_out;
+            if (fwrite(out, 1, n, dest) != n || ferror(dest)) {
+                ret = ESP_FAIL;
+                goto CLEANUP;
+            }
+            comp_len += n;
+        } while (avail_in > 0 || BrotliEncoderHasMoreOutput(enc) ||
+                 (op == BROTLI_OPERATION_FINISH && !BrotliEncoderIsFinished(enc)));
+    }
+
+    put_u32(entry, comp_len);
+    put_u32(entry + 4, raw_len);
+    put_u32(entry + 8, crc);
+
+CLEANUP:
+    if (enc != NULL) {
+        BrotliEncoderDestroyInstance(enc);
+    }
+    return ret;
+}
+#endif
+
+esp_err_t brseek_compress_file(FILE *source, FILE *dest)
+{
+#if CONFIG_BROTLI_ENCODER
+    esp_err_t ret = ESP_OK;
+    uint8_t header[BRSEEK_HEADER_SIZE];
+    uint8_t *index = NULL;
+    size_t count = 0;
+
+    uint8_t *in = (uint8_t *)malloc(BRSEEK_BUFFER_SIZE);
+    uint8_t *out = (uint8_t *)malloc(BRSEEK_BUFFER_SIZE);
+    if (in == NULL || out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "Initiated Compression");
+
+    memcpy(header, BRSEEK_MAGIC, BRSEEK_MAGIC_SIZE);
+    put_u32(header + BRSEEK_MAGIC_SIZE, BRSEEK_CHUNK_SIZE);
+    if (fwrite(header, 1, BRSEEK_HEADER_SIZE, dest) != BRSEEK_HEADER_SIZE) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+
+    for (;;) {
+        if (count % INDEX_GROW == 0) {
+            uint8_t *grown = (uint8_t *)realloc(index, (count + INDEX_GROW) * BRSEEK_ENTRY_SIZE);
+            if (grown == NULL) {
+                ret = ESP_ERR_NO_MEM;
+                goto CLEANUP;
+            }
+            index = grown;
+        }
+
+        ret = compress_chunk(source, dest, in, out, index + count * BRSEEK_ENTRY_SIZE);
+        if (ret == ESP_ERR_NOT_FOUND) {
+            break;
+        }
+        if (ret != ESP_OK) {
+            goto CLEANUP;
+        }
+        count++;
+    }
+
+    memcpy(header + 4, BRSEEK_INDEX_MAGIC, BRSEEK_MAGIC_SIZE);
+    put_u32(header, count);
+    if (fwrite(index, BRSEEK_ENTRY_SIZE, count, dest) != count ||
+            fwrite(header, 1, BRSEEK_TRAILER_SIZE, dest) != BRSEEK_TRAILER_SIZE || ferror(dest)) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+    ret = ESP_OK;
+
+    ESP_LOGI(TAG, "%d chunks", count);
+
+CLEANUP:
+    free(index);
+    free(in);
+    free(out);
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t brseek_open(FILE *source, brseek_t **out)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t header[BRSEEK_HEADER_SIZE];
+    uint8_t entry[BRSEEK_ENTRY_SIZE];
+
+    if (fseek(source, 0, SEEK_SET) != 0 || fread(header, 1, BRSEEK_HEADER_SIZE, source) != BRSEEK_HEADER_SIZE ||
+            memcmp(header, BRSEEK_MAGIC, BRSEEK_MAGIC_SIZE) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t chunk_size = get_u32(header + BRSEEK_MAGIC_SIZE);
+    if (chunk_size == 0 || chunk_size > MAX_CHUNK_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (fseek(source, -BRSEEK_TRAILER_SIZE, SEEK_END) != 0 ||
+            fread(header, 1, BRSEEK_TRAILER_SIZE, source) != BRSEEK_TRAILER_SIZE ||
+            memcmp(header + 4, BRSEEK_INDEX_MAGIC, BRSEEK_MAGIC_SIZE) != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    long end = ftell(source);
+    size_t count = get_u32(header);
+    long index_pos = end - BRSEEK_TRAILER_SIZE - (long)(count * BRSEEK_ENTRY_SIZE);
+    if (count > (size_t)end / BRSEEK_ENTRY_SIZE || index_pos < BRSEEK_HEADER_SIZE ||
+            fseek(source, index_pos, SEEK_SET) != 0) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    brseek_t *brseek = (brseek_t *)calloc(1, sizeof(brseek_t));
+    if (brseek == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    brseek->source = source;
+    brseek->count = count;
+    brseek->chunks = (brseek_chunk_t *)malloc((count ? count : 1) * sizeof(brseek_chunk_t));
+    brseek->in = (uint8_t *)malloc(BRSEEK_BUFFER_SIZE);
+    brseek->out = (uint8_t *)malloc(BRSEEK_BUFFER_SIZE);
+    if (brseek->chunks == NULL || brseek->in == NULL || brseek->out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    long coffset = BRSEEK_HEADER_SIZE;
+    for (size_t i = 0; i < count; i++) {
+        if (fread(entry, 1, BRSEEK_ENTRY_SIZE, source) != BRSEEK_ENTRY_SIZE) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+        brseek_chunk_t *chunk = &brseek->chunks[i];
+        chunk->coffset = coffset;
+        chunk->uoffset = brseek->size;
+        chunk->comp_len = get_u32(entry);
+        chunk->raw_len = get_u32(entry + 4);
+        chunk->crc = get_u32(entry + 8);
+        if (chunk->raw_len == 0 || chunk->raw_len > chunk_size || chunk->comp_len > index_pos - coffset) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+        coffset += chunk->comp_len;
+        brseek->size += chunk->raw_len;
+    }
+    // The chunks must fill the space before the index exactly
+    if (coffset != index_pos) {
+        ret = ESP_ERR_INVALID_SIZE;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "%d chunks, %d bytes", brseek->count, brseek->size);
+
+CLEANUP:
+    if (ret != ESP_OK) {
+        brseek_close(brseek);
+        return ret;
+    }
+    *out = brseek;
+    return ESP_OK;
+}
+
+size_t brseek_size(const brseek_t *brseek)
+{
+    return brseek->size;
+}
+
+void brseek_close(brseek_t *brseek)
+{
+    if (brseek == NULL) {
+        return;
+    }
+    free(brseek->chunks);
+    free(brseek->in);
+    free(brseek->out);
+    free(brseek);
+}
+
+/*
+    Decode a whole chunk, checking its size and CRC. Bytes [skip, skip + len) of it go to out,
+    or everything to dest when it is not NULL.
+*/
+static esp_err_t decode_chunk(brseek_t *brseek, const brseek_chunk_t *chunk, size_t skip,
+                              uint8_t *out, size_t len, FILE *dest)
+{
+#if CONFIG_BROTLI_DECODER
+    esp_err_t ret = ESP_OK;
+    BrotliDecoderResult res = BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT;
+    size_t comp_left = chunk->comp_len;
+    size_t avail_in = 0;
+    const uint8_t *next_in = brseek->in;
+    size_t pos = 0;
+    uint32_t crc = 0;
+
+    if (fseek(brseek->source, chunk->coffset, SEEK_SET) != 0) {
+        return ESP_FAIL;
+    }
+
+    BrotliDecoderState *dec = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+    if (dec == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    while (res != BROTLI_DECODER_RESULT_SUCCESS) {
+        if (res == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+            if (comp_left == 0) {
+                ret = ESP_ERR_INVALID_SIZE;
+                goto CLEANUP;
+            }
+            avail_in = comp_left < BRSEEK_BUFFER_SIZE ? comp_left : BRSEEK_BUFFER_SIZE;
+            if (fread(brseek->in, 1, avail_in, brseek->source) != avail_in) {
+                ret = ferror(brseek->source) ? ESP_FAIL : ESP_ERR_INVALID_SIZE;
+                goto CLEANUP;
+            }
+            comp_left -= avail_in;
+            next_in = brseek->in;
+        }
+
+        uint8_t *next_out = brseek->out;
+        size_t avail_out = BRSEEK_BUFFER_SIZE;
+        res = BrotliDecoderDecompressStream(dec, &avail_in, &next_in, &avail_out, &next_out, NULL);
+        if (res == BROTLI_DECODER_RESULT_ERROR) {
+            ESP_LOGE(TAG, "Corrupt chunk (%s)", BrotliDecoderErrorString(BrotliDecoderGetErrorCode(dec)));
+            ret = ESP_ERR_INVALID_CRC;
+            goto CLEANUP;
+        }
+
+        size_t n = BRSEEK_BUFFER_SIZE - avail_out;
+        if (pos + n > chunk->raw_len) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+        crc = crc32(crc, brseek->out, n);
+
+        if (dest != NULL) {
+            if (fwrite(brseek->out, 1, n, dest) != n || ferror(dest)) {
+                ret = ESP_FAIL;
+                goto CLEANUP;
+            }
+        } else if (pos + n > skip && pos < skip + len) {
+            size_t from = skip > pos ? skip - pos : 0;
+            size_t to = skip + len < pos + n ? skip + len - pos : n;
+            memcpy(out + pos + from - skip, brseek->out + from, to - from);
+        }
+        pos += n;
+    }
+
+    if (pos != chunk->raw_len || avail_in != 0 || comp_left != 0) {
+        ret = ESP_ERR_INVALID_SIZE;
+    } else if (crc != chunk->crc) {
+        ret = ESP_ERR_INVALID_CRC;
+    }
+
+CLEANUP:
+    BrotliDecoderDestroyInstance(dec);
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t brseek_read(brseek_t *brseek, size_t offset, uint8_t *out, size_t len, size_t *out_len)
+{
+    esp_err_t ret;
+    size_t done = 0;
+
+    *out_len = 0;
+    if (offset >= brseek->size || len == 0) {
+        return ESP_OK;
+    }
+    if (len > brseek->size - offset) {
+        len = brseek->size - offset;
+    }
+
+    // Last chunk starting at or before the offset
+    size_t lo = 0, hi = brseek->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (brseek->chunks[mid].uoffset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    for (size_t i = lo; done < len; i++) {
+        const brseek_chunk_t *chunk = &brseek->chunks[i];
+        size_t skip = offset + done - chunk->uoffset;
+        size_t n = chunk->raw_len - skip < len - done ? chunk->raw_len - skip : len - done;
+
+        ret = decode_chunk(brseek, chunk, skip, out + done, n, NULL);
+        if (ret != ESP_OK) {
+            *out_len = done;
+            return ret;
+        }
+        done += n;
+    }
+
+    *out_len = done;
+    return ESP_OK;
+}
+
+esp_err_t brseek_decompress_file(FILE *source, FILE *dest)
+{
+    esp_err_t ret;
+    brseek_t *brseek;
+
+    ret = brseek_open(source, &brseek);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Initiated Decompression");
+
+    for (size_t i = 0; i < brseek->count && ret == ESP_OK; i++) {
+        ret = decode_chunk(brseek, &brseek->chunks[i], 0, NULL, 0, dest);
+    }
+
+    brseek_close(brseek);
+    return ret;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Seekable Brotli: input split into chunks of CONFIG_BRSEEK_CHUNK_SIZE bytes, each a complete
+    Brotli stream with a window just covering it, followed by an index of all chunks.
+    A reader loads the index from the end of the file and decodes only the chunks that cover
+    the requested range.
+
+    Layout (little endian):
+        "BRS1", u32 chunk_size
+        Brotli streams, one per chunk
+        Index entries (12 bytes each): u32 comp_len, u32 raw_len, u32 crc (CRC-32 of the raw chunk)
+        u32 chunk count, "BRSI"
+*/
+
+#define BRSEEK_MAGIC "BRS1"
+#define BRSEEK_INDEX_MAGIC "BRSI"
+#define BRSEEK_MAGIC_SIZE (4)
+#define BRSEEK_HEADER_SIZE (8)
+#define BRSEEK_ENTRY_SIZE (12)
+#define BRSEEK_TRAILER_SIZE (8)
+
+#define BRSEEK_CHUNK_SIZE (CONFIG_BRSEEK_CHUNK_SIZE)
+#define BRSEEK_BUFFER_SIZE (CONFIG_BRSEEK_BUFFER_SIZE)
+
+typedef struct brseek brseek_t;
+
+esp_err_t brseek_compress_file(FILE *source, FILE *dest);
+
+// Load the index; source must stay open until brseek_close()
+esp_err_t brseek_open(FILE *source, brseek_t **out);
+
+// Total uncompressed size
+size_t brseek_size(const brseek_t *brseek);
+
+/*
+    Read len bytes at an uncompressed offset into out; *out_len is short only at the end of the data.
+    Every chunk touched is decoded to its end so its CRC can be checked.
+*/
+esp_err_t brseek_read(brseek_t *brseek, size_t offset, uint8_t *out, size_t len, size_t *out_len);
+
+void brseek_close(brseek_t *brseek);
+
+esp_err_t brseek_decompress_file(FILE *source, FILE *dest);
@@ -0,0 +1,732 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+
+#include "codec_priv.h"
+
+static const char *TAG = "codec";
+
+static const codec_ops_t *const codec_ops[CODEC_MAX] = {
+    [CODEC_DEFLATE] = &codec_zlib_ops,
+    [CODEC_GZIP] = &codec_zlib_ops,
+    [CODEC_BROTLI] = &codec_brotli_ops,
+    [CODEC_FASTLZ] = &codec_fastlz_ops,
+    [CODEC_LZSS] = &codec_lzss_ops,
+};
+
+static const char *const codec_names[CODEC_MAX] = {
+    [CODEC_DEFLATE] = "deflate",
+    [CODEC_GZIP] = "gzip",
+    [CODEC_BROTLI] = "brotli",
+    [CODEC_FASTLZ] = "fastlz",
+    [CODEC_LZSS] = "lzss",
+};
+
+// Size prefix for tracked allocations, keeps the returned pointer aligned
+typedef union {
+    size_t size;
+    max_align_t align;
+} alloc_header_t;
+
+void *codec_alloc(codec_t *codec, size_t size)
+{
+    if (codec->mem_budget && codec->stats.mem_current + size > codec->mem_budget) {
+        ESP_LOGW(TAG, "%s: allocation of %u bytes exceeds budget", codec_names[codec->type], (unsigned)size);
+        return NULL;
+    }
+
+    alloc_header_t *hdr = (alloc_header_t *)malloc(sizeof(alloc_header_t) + size);
+    if (hdr == NULL) {
+        return NULL;
+    }
+
+    hdr->size = size;
+    codec->stats.mem_current += size;
+    if (codec->stats.mem_current > codec->stats.mem_peak) {
+        codec->stats.mem_peak = codec->stats.mem_current;
+    }
+    return hdr + 1;
+}
+
+void codec_free(codec_t *codec, void *ptr)
+{
+    if (ptr == NULL) {
+        return;
+    }
+
+    alloc_header_t *hdr = (alloc_header_t *)ptr - 1;
+    codec->stats.mem_current -= hdr->size;
+    free(hdr);
+}
+
+const char *codec_name(codec_type_t type)
+{
+    return type < CODEC_MAX ? codec_names[type] : "unknown";
+}
+
+void codec_default_params(codec_type_t type, codec_params_t *params)
+{
+    memset(params, 0, sizeof(codec_params_t));
+    if (type < CODEC_MAX) {
+        codec_ops[type]->default_params(params);
+    }
+}
+
+size_t codec_mem_estimate(codec_type_t type, codec_mode_t mode, const codec_params_t *params)
+{
+    codec_params_t defaults;
+
+    if (type >= CODEC_MAX) {
+        return 0;
+    }
+    if (params == NULL) {
+        codec_default_params(type, &defaults);
+        params = &defaults;
+    }
+
+    size_t size = sizeof(codec_t) + CODEC_BUFFER_SIZE + codec_ops[type]->mem_estimate(mode, params);
+    size += filter_mem_estimate(&params->filter);
+    if (mode == CODEC_DECOMPRESS && filter_is_blocked(&params->filter)) {
+        size += params->filter.stride;
+    }
+    return size;
+}
+
+esp_err_t codec_create(codec_type_t type, codec_mode_t mode, const codec_params_t *params,
+                       size_t mem_budget, codec_t **out)
+{
+    codec_params_t eff;
+
+    if (type >= CODEC_MAX || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const codec_ops_t *ops = codec_ops[type];
+    if (params != NULL) {
+        eff = *params;
+    } else {
+        codec_default_params(type, &eff);
+    }
+    // Shuffle blocks are filtered in the staging buffer
+    if (filter_is_blocked(&eff.filter) && eff.filter.stride > CODEC_BUFFER_SIZE) {
+        ESP_LOGE(TAG, "Shuffle stride %u exceeds the staging buffer", (unsigned)eff.filter.stride);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // The decompressor cannot pick a smaller window than the stream was made with
+    while (mem_budget && codec_mem_estimate(type, mode, &eff) > mem_budget) {
+        if (mode == CODEC_DECOMPRESS || !ops->shrink(&eff)) {
+            ESP_LOGE(TAG, "%s: needs ~%u bytes, budget is %u", codec_names[type],
+                     (unsigned)codec_mem_estimate(type, mode, &eff), (unsigned)mem_budget);
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    codec_t *codec = (codec_t *)calloc(1, sizeof(codec_t));
+    if (codec == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    codec->ops = ops;
+    codec->type = type;
+    codec->mode = mode;
+    codec->params = eff;
+    codec->base_params = eff;
+    codec->mem_budget = mem_budget;
+    codec->stats.mem_current = sizeof(codec_t) + filter_mem_estimate(&eff.filter);
+    codec->stats.mem_peak = codec->stats.mem_current;
+
+    esp_err_t ret = filter_init(&codec->filter, &eff.filter);
+    if (ret != ESP_OK) {
+        free(codec);
+        return ret;
+    }
+
+    codec->buf = (uint8_t *)codec_alloc(codec, CODEC_BUFFER_SIZE);
+    if (codec->buf == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    if (mode == CODEC_DECOMPRESS && filter_is_blocked(&eff.filter)) {
+        codec->block = (uint8_t *)codec_alloc(codec, eff.filter.stride);
+        if (codec->block == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            goto CLEANUP;
+        }
+    }
+
+    ret = ops->init(codec);
+    if (ret != ESP_OK) {
+        if (codec->ctx != NULL) {
+            ops->deinit(codec);
+        }
+        goto CLEANUP;
+    }
+
+    *out = codec;
+    return ESP_OK;
+
+CLEANUP:
+    filter_deinit(&codec->filter);
+    codec_free(codec, codec->block);
+    codec_free(codec, codec->buf);
+    free(codec);
+    return ret;
+}
+
+// Filter staged input for the compressor; shuffling waits for whole blocks until the final call
+static esp_err_t codec_filter_staged(codec_t *codec, bool final)
+{
+    size_t len = codec->buf_len - codec->buf_filtered;
+
+    if (filter_is_blocked(&codec->filter.params) && !final) {
+        len -= len % codec->filter.params.stride;
+    }
+    esp_err_t ret = filter_encode(&codec->filter, codec->buf + codec->buf_filtered, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    codec->buf_filtered += len;
+    return ESP_OK;
+}
+
+esp_err_t codec_push(codec_t *codec, const uint8_t *in, size_t len, size_t *consumed)
+{
+    if (codec == NULL || (in == NULL && len > 0) || consumed == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // Staged input must not change while a flush is being emitted
+    if (codec->pending != CODEC_FLUSH_NONE) {
+        *consumed = 0;
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (codec->buf_pos > 0) {
+        memmove(codec->buf, codec->buf + codec->buf_pos, codec->buf_len - codec->buf_pos);
+        codec->buf_len -= codec->buf_pos;
+        codec->buf_filtered -= codec->buf_pos;
+        codec->buf_pos = 0;
+    }
+
+    size_t room = CODEC_BUFFER_SIZE - codec->buf_len;
+    size_t count = len < room ? len : room;
+    memcpy(codec->buf + codec->buf_len, in, count);
+    codec->buf_len += count;
+    codec->stats.bytes_in += count;
+    if (count > 0 && codec->unflushed == 0) {
+        codec->unflushed_since = esp_timer_get_time();
+    }
+    codec->unflushed += count;
+    *consumed = count;
+
+    if (codec->mode == CODEC_COMPRESS) {
+        return codec_filter_staged(codec, false);
+    }
+    codec->buf_filtered = codec->buf_len;
+    return ESP_OK;
+}
+
+// Probe the first staged block before the compressor sees any input
+static esp_err_t codec_probe(codec_t *codec)
+{
+    probe_result_t res;
+    probe_verdict_t verdict;
+
+    probe_run(codec->buf + codec->buf_pos, codec->buf_filtered - codec->buf_pos, &res);
+    codec->stats.probe_ratio = res.ratio;
+    codec->probed = true;
+
+    verdict = probe_verdict(&res);
+    if (verdict == PROBE_COMPRESS) {
+        return ESP_OK;
+    }
+
+    ESP_LOGI(TAG, "%s: predicted ratio %u%%, %s", codec_names[codec->type], res.ratio,
+             verdict == PROBE_STORE ? "storing" : "fastest level");
+    return codec->ops->downgrade(codec, verdict);
+}
+
+static bool codec_low_memory(codec_t *codec)
+{
+    if (codec->low_water && esp_get_free_heap_size() < codec->low_water) {
+        return true;
+    }
+    return codec->low_mem_cb != NULL && codec->low_mem_cb(codec->low_mem_arg);
+}
+
+// Let the codec end its block into out and switch to its lightest configuration
+static esp_err_t codec_degrade(codec_t *codec, uint8_t *out, size_t len, size_t *produced)
+{
+    bool complete = false;
+    uint8_t *next_out = out;
+    size_t avail_out = len;
+
+    if (!codec->degrading) {
+        ESP_LOGW(TAG, "%s: low memory, switching to the lightest configuration", codec_names[codec->type]);
+        codec->degrading = true;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = codec->ops->degrade(codec, &next_out, &avail_out, &complete);
+    codec->stats.time_us += esp_timer_get_time() - start;
+
+    *produced = len - avail_out;
+    codec->stats.bytes_out += *produced;
+    if (ret == ESP_OK && complete) {
+        codec->degrading = false;
+        codec->stats.degraded = true;
+    }
+    return ret;
+}
+
+// One process call on the staged input
+static esp_err_t codec_run(codec_t *codec, uint8_t *out, size_t len, size_t *produced)
+{
+    bool complete = false;
+
+    *produced = 0;
+    if (codec->mode == CODEC_COMPRESS && codec->pending == CODEC_FLUSH_FINISH) {
+        esp_err_t ret = codec_filter_staged(codec, true);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (codec->mode == CODEC_COMPRESS && codec->ops->downgrade != NULL && !codec->probed) {
+        // Keep staging until there is a full sample, unless the caller wants output now
+        if (codec->buf_len < CODEC_BUFFER_SIZE && codec->pending == CODEC_FLUSH_NONE) {
+            return ESP_OK;
+        }
+        esp_err_t ret = codec_probe(codec);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    // Not in the middle of a flush, which has to complete with the configuration that started it
+    if (codec->degrading || (codec->ops->degrade != NULL && !codec->stats.degraded &&
+                             codec->pending == CODEC_FLUSH_NONE && codec_low_memory(codec))) {
+        return codec_degrade(codec, out, len, produced);
+    }
+
+    // Batch small pushes: Brotli's fast qualities compress each call's input as a meta-block of its own
+    if (codec->mode == CODEC_COMPRESS && codec->pending == CODEC_FLUSH_NONE &&
+        codec->buf_len < CODEC_BUFFER_SIZE) {
+        return ESP_OK;
+    }
+
+    const uint8_t *next_in = codec->buf + codec->buf_pos;
+    size_t avail_in = codec->buf_filtered - codec->buf_pos;
+    uint8_t *next_out = out;
+    size_t avail_out = len;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = codec->ops->process(codec, &next_in, &avail_in, &next_out, &avail_out,
+                                        codec->pending, &complete);
+    codec->stats.time_us += esp_timer_get_time() - start;
+
+    codec->buf_pos = next_in - codec->buf;
+    if (codec->buf_pos == codec->buf_len) {
+        codec->buf_pos = codec->buf_len = codec->buf_filtered = 0;
+    }
+
+    *produced = len - avail_out;
+    codec->stats.bytes_out += *produced;
+
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    if (complete) {
+        if (codec->pending == CODEC_FLUSH_SYNC) {
+            int64_t latency = esp_timer_get_time() - codec->unflushed_since;
+            if (codec->unflushed > 0 && latency > codec->stats.max_flush_latency_us) {
+                codec->stats.max_flush_latency_us = latency;
+            }
+            codec->stats.flushes++;
+            codec->stats.auto_flushes += codec->auto_flush;
+            codec->auto_flush = false;
+            codec->unflushed = 0;
+        }
+        // Decompression completes on the end of stream marker, with or without finish
+        codec->done = codec->pending == CODEC_FLUSH_FINISH || codec->mode == CODEC_DECOMPRESS;
+        codec->pending = CODEC_FLUSH_NONE;
+    }
+    return ESP_OK;
+}
+
+// Decompressed shuffled data is collected into whole blocks, unfiltered, then handed out
+static esp_err_t codec_pull_blocks(codec_t *codec, uint8_t *out, size_t len, size_t *produced)
+{
+    const size_t stride = codec->filter.params.stride;
+    esp_err_t ret = ESP_OK;
+    size_t n;
+
+    while (*produced < len) {
+        if (codec->block_len == stride || codec->done) {
+            n = codec->block_len - codec->block_pos;
+            n = n < len - *produced ? n : len - *produced;
+            memcpy(out + *produced, codec->block + codec->block_pos, n);
+            *produced += n;
+            codec->block_pos += n;
+            if (codec->block_pos < codec->block_len || codec->done) {
+                break;
+            }
+            codec->block_pos = codec->block_len = 0;
+            continue;
+        }
+
+        ret = codec_run(codec, codec->block + codec->block_len, stride - codec->block_len, &n);
+        codec->block_len += n;
+        if (ret != ESP_OK) {
+            break;
+        }
+        if (codec->block_len == stride || codec->done) {
+            ret = filter_decode(&codec->filter, codec->block, codec->block_len);
+            if (ret != ESP_OK) {
+                break;
+            }
+        } else if (n == 0) {
+            break;
+        }
+    }
+    return ret;
+}
+
+esp_err_t codec_pull(codec_t *codec, uint8_t *out, size_t len, size_t *produced)
+{
+    if (codec == NULL || out == NULL || produced == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *produced = 0;
+    if (codec->block != NULL) {
+        return codec_pull_blocks(codec, out, len, produced);
+    }
+    if (codec->done) {
+        return ESP_OK;
+    }
+
+    if (codec->pending == CODEC_FLUSH_NONE && codec->unflushed > 0 &&
+        ((codec->flush_bytes && codec->unflushed >= codec->flush_bytes) ||
+         (codec->flush_age_us && esp_timer_get_time() - codec->unflushed_since >= codec->flush_age_us))) {
+        codec->pending = CODEC_FLUSH_SYNC;
+        codec->auto_flush = true;
+    }
+
+    esp_err_t ret = codec_run(codec, out, len, produced);
+    if (ret == ESP_OK && codec->mode == CODEC_DECOMPRESS) {
+        ret = filter_decode(&codec->filter, out, *produced);
+    }
+    return ret;
+}
+
+esp_err_t codec_flush(codec_t *codec)
+{
+    if (codec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (codec->mode != CODEC_COMPRESS || !codec->ops->can_flush ||
+        filter_is_blocked(&codec->filter.params)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (codec->pending == CODEC_FLUSH_FINISH || codec->done) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    codec->pending = CODEC_FLUSH_SYNC;
+    return ESP_OK;
+}
+
+esp_err_t codec_set_auto_flush(codec_t *codec, size_t max_bytes, uint32_t max_age_us)
+{
+    if (codec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (codec->mode != CODEC_COMPRESS || !codec->ops->can_flush ||
+        filter_is_blocked(&codec->filter.params)) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    codec->flush_bytes = max_bytes;
+    codec->flush_age_us = max_age_us;
+    return ESP_OK;
+}
+
+esp_err_t codec_set_low_memory(codec_t *codec, size_t low_water, codec_low_mem_cb_t cb, void *arg)
+{
+    if (codec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (codec->mode != CODEC_COMPRESS || codec->ops->degrade == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    codec->low_water = low_water;
+    codec->low_mem_cb = cb;
+    codec->low_mem_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t codec_finish(codec_t *codec)
+{
+    if (codec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (codec->pending == CODEC_FLUSH_SYNC) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    codec->pending = CODEC_FLUSH_FINISH;
+    return ESP_OK;
+}
+
+bool codec_is_done(const codec_t *codec)
+{
+    return codec->done && codec->block_pos == codec->block_len;
+}
+
+void codec_get_stats(const codec_t *codec, codec_stats_t *stats)
+{
+    *stats = codec->stats;
+}
+
+void codec_get_params(const codec_t *codec, codec_params_t *params)
+{
+    *params = codec->params;
+}
+
+codec_type_t codec_get_type(const codec_t *codec)
+{
+    return codec->type;
+}
+
+void codec_destroy(codec_t *codec)
+{
+    if (codec == NULL) {
+        return;
+    }
+
+    if (codec->ctx != NULL) {
+        codec->ops->deinit(codec);
+    }
+    filter_deinit(&codec->filter);
+    codec_free(codec, codec->block);
+    codec_free(codec, codec->buf);
+    free(codec);
+}
+
+esp_err_t codec_reset(codec_t *codec)
+{
+    if (codec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t mem_current = codec->stats.mem_current;
+    size_t mem_peak = codec->stats.mem_peak;
+    memset(&codec->stats, 0, sizeof(codec_stats_t));
+    codec->stats.mem_current = mem_current;
+    codec->stats.mem_peak = mem_peak;
+
+    codec->buf_pos = codec->buf_len = codec->buf_filtered = 0;
+    codec->block_pos = codec->block_len = 0;
+    codec->pending = CODEC_FLUSH_NONE;
+    codec->auto_flush = false;
+    codec->unflushed = 0;
+    codec->degrading = false;
+    codec->probed = false;
+    codec->done = false;
+    filter_reset(&codec->filter);
+
+    codec->params = codec->base_params;
+    esp_err_t ret = ESP_ERR_NOT_SUPPORTED;
+    if (codec->ctx != NULL && codec->ops->reset != NULL) {
+        ret = codec->ops->reset(codec);
+    }
+    if (ret == ESP_ERR_NOT_SUPPORTED) {
+        if (codec->ctx != NULL) {
+            codec->ops->deinit(codec);
+            codec->ctx = NULL;
+        }
+        ret = codec->ops->init(codec);
+        if (ret != ESP_OK && codec->ctx != NULL) {
+            codec->ops->deinit(codec);
+            codec->ctx = NULL;
+        }
+    }
+    return ret;
+}
+
+struct codec_step {
+    codec_t *codec;
+    FILE *source;
+    FILE *dest;
+    uint8_t *in;                // Read from source, not yet pushed
+    size_t in_pos;
+    size_t in_len;
+    uint8_t *out;
+    bool eof;
+    bool finishing;
+};
+
+esp_err_t codec_step_begin(codec_t *codec, FILE *source, FILE *dest, codec_step_t **out)
+{
+    if (codec == NULL || source == NULL || dest == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    codec_step_t *step = (codec_step_t *)calloc(1, sizeof(codec_step_t));
+    if (step == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    step->in = (uint8_t *)malloc(CODEC_BUFFER_SIZE);
+    step->out = (uint8_t *)malloc(CODEC_BUFFER_SIZE);
+    if (step->in == NULL || step->out == NULL) {
+        codec_step_end(step);
+        return ESP_ERR_NO_MEM;
+    }
+
+    step->codec = codec;
+    step->source = source;
+    step->dest = dest;
+    *out = step;
+    return ESP_OK;
+}
+
+/*
+    Output is drained before more input is read, so a step that stops early leaves nothing
+    but staged input and unread source behind. Limits are checked between buffers: a step
+    overshoots max_us by at most one buffer's worth of codec time.
+*/
+esp_err_t codec_step(codec_step_t *step, size_t max_in, uint32_t max_us, bool *more)
+{
+    esp_err_t ret = ESP_OK;
+    codec_t *codec = step->codec;
+    size_t fed = 0, produced, consumed;
+    int64_t start = esp_timer_get_time();
+
+    while (!codec_is_done(codec)) {
+        if (max_us > 0 && esp_timer_get_time() - start >= max_us) {
+            break;
+        }
+
+        ret = codec_pull(codec, step->out, CODEC_BUFFER_SIZE, &produced);
+        if (ret != ESP_OK) {
+            break;
+        }
+        if (fwrite(step->out, 1, produced, step->dest) != produced || ferror(step->dest)) {
+            ret = ESP_FAIL;
+            break;
+        }
+        if (produced == CODEC_BUFFER_SIZE || codec_is_done(codec)) {
+            continue;
+        }
+
+        if (step->finishing) {
+            // Finishing and no output: the compressed stream is cut short
+            if (produced == 0) {
+                ret = ESP_ERR_INVALID_SIZE;
+                break;
+            }
+            continue;
+        }
+
+        if (step->in_pos == step->in_len) {
+            if (step->eof) {
+                codec_finish(codec);
+                step->finishing = true;
+                continue;
+            }
+            if (max_in > 0 && fed >= max_in) {
+                break;
+            }
+
+            size_t n = CODEC_BUFFER_SIZE;
+            if (max_in > 0 && max_in - fed < n) {
+                n = max_in - fed;
+            }
+            step->in_len = fread(step->in, 1, n, step->source);
+            step->in_pos = 0;
+            if (ferror(step->source)) {
+                ret = ESP_FAIL;
+                break;
+            }
+            step->eof = step->in_len < n && feof(step->source);
+        }
+
+        ret = codec_push(codec, step->in + step->in_pos, step->in_len - step->in_pos, &consumed);
+        if (ret != ESP_OK) {
+            break;
+        }
+        step->in_pos += consumed;
+        fed += consumed;
+    }
+
+    *more = ret == ESP_OK && !codec_is_done(codec);
+    return ret;
+}
+
+void codec_step_end(codec_step_t *step)
+{
+    if (step == NULL) {
+        return;
+    }
+    free(step->in);
+    free(step->out);
+    free(step);
+}
+
+esp_err_t codec_file(codec_t *codec, FILE *source, FILE *dest)
+{
+    codec_step_t *step;
+    bool more;
+
+    esp_err_t ret = codec_step_begin(codec, source, dest, &step);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = codec_step(step, 0, 0, &more);
+    codec_step_end(step);
+    return ret;
+}
+
+esp_err_t codec_buf(codec_t *codec, const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len)
+{
+    esp_err_t ret;
+    size_t ip = 0, op = 0, consumed, produced;
+
+    // Each pull consumes all staged input unless the output buffer is full
+    while (ip < in_len && !codec_is_done(codec)) {
+        codec_push(codec, in + ip, in_len - ip, &consumed);
+        ip += consumed;
+
+        ret = codec_pull(codec, out + op, *out_len - op, &produced);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        op += produced;
+        if (!codec_is_done(codec) && op == *out_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    codec_finish(codec);
+    while (!codec_is_done(codec)) {
+        ret = codec_pull(codec, out + op, *out_len - op, &produced);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        op += produced;
+        if (!codec_is_done(codec) && op == *out_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+
+    *out_len = op;
+    return ESP_OK;
+}
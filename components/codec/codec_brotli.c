@@ -0,0 +1,380 @@
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "brotli/encode.h"
+#include "brotli/decode.h"
+
+#include "codec_priv.h"
+
+// Qualities 0 and 1 use one/two pass fragment compressors that always declare an 18-bit window
+#define FAST_QUALITY (1)
+#define FAST_MIN_WINDOW (18)
+
+// Largest uncompressed meta-block (MLEN is at most 24 bits)
+#define STORED_MAX_BLOCK (1 << 24)
+
+typedef struct {
+    BrotliEncoderState *enc;    // NULL once switched to stored output
+    uint8_t hdr[8];             // Meta-block header being written out
+    size_t hdr_len;
+    size_t hdr_pos;
+    size_t raw_left;            // Bytes of the current uncompressed meta-block still to copy
+    bool started;               // Stream header (window bits) written
+    bool finished;              // Last empty meta-block written
+} brotli_enc_ctx_t;
+
+static void *brotli_alloc(void *opaque, size_t size)
+{
+    return codec_alloc((codec_t *)opaque, size);
+}
+
+static void brotli_free(void *opaque, void *ptr)
+{
+    codec_free((codec_t *)opaque, ptr);
+}
+
+static void brotli_default_params(codec_params_t *params)
+{
+    params->level = CONFIG_CODEC_BROTLI_QUALITY;
+    params->window_bits = CONFIG_CODEC_BROTLI_WINDOW;
+}
+
+/*
+    Peak heap measured on host while streaming 170K of mixed text and binary:
+    quality 0/1 encoders ~16-19K, quality 2/3 ~540K plus ~2.5x the window, quality >= 4 ~1.8M and up.
+    Decoders ~24K plus up to 1.5x the window while the ring buffer grows.
+*/
+static size_t brotli_mem_estimate(codec_mode_t mode, const codec_params_t *params)
+{
+    int bits = params->window_bits;
+
+    if (mode == CODEC_COMPRESS) {
+        if (params->level <= FAST_QUALITY) {
+            return 20 * 1024;
+        }
+        return (params->level < 4 ? 545 * 1024 : 1800 * 1024) + 3 * (1 << bits);
+    }
+
+    if (params->level <= FAST_QUALITY && bits < FAST_MIN_WINDOW) {
+        bits = FAST_MIN_WINDOW;
+    }
+    return 24 * 1024 + 3 * (1 << bits) / 2;
+}
+
+static bool brotli_shrink(codec_params_t *params)
+{
+    if (params->level > FAST_QUALITY && params->window_bits > BROTLI_MIN_WINDOW_BITS) {
+        params->window_bits--;
+        return true;
+    }
+    if (params->level > FAST_QUALITY) {
+        params->level = FAST_QUALITY;
+        return true;
+    }
+    return false;
+}
+
+static esp_err_t brotli_init(codec_t *codec)
+{
+    if (codec->mode == CODEC_COMPRESS) {
+#if CONFIG_BROTLI_ENCODER
+        brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec_alloc(codec, sizeof(brotli_enc_ctx_t));
+        if (ctx == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        memset(ctx, 0, sizeof(brotli_enc_ctx_t));
+        codec->ctx = ctx;
+
+        ctx->enc = BrotliEncoderCreateInstance(brotli_alloc, brotli_free, codec);
+        if (ctx->enc == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        BrotliEncoderSetParameter(ctx->enc, BROTLI_PARAM_QUALITY, codec->params.level);
+        BrotliEncoderSetParameter(ctx->enc, BROTLI_PARAM_LGWIN, codec->params.window_bits);
+        return ESP_OK;
+#else
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+
+#if CONFIG_BROTLI_DECODER
+    BrotliDecoderState *dec = BrotliDecoderCreateInstance(brotli_alloc, brotli_free, codec);
+    if (dec == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    codec->ctx = dec;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Only the encoder keeps its buffers; stored output (no encoder) and the decoder are re-created
+static esp_err_t brotli_reset(codec_t *codec)
+{
+#if CONFIG_BROTLI_ENCODER
+    brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec->ctx;
+
+    if (codec->mode == CODEC_DECOMPRESS || ctx->enc == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!BrotliEncoderReset(ctx->enc)) {
+        return ESP_ERR_NO_MEM;
+    }
+    // The probe may have lowered the quality
+    BrotliEncoderSetParameter(ctx->enc, BROTLI_PARAM_QUALITY, codec->params.level);
+    BrotliEncoderSetParameter(ctx->enc, BROTLI_PARAM_LGWIN, codec->params.window_bits);
+
+    BrotliEncoderState *enc = ctx->enc;
+    memset(ctx, 0, sizeof(brotli_enc_ctx_t));
+    ctx->enc = enc;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+#if CONFIG_BROTLI_ENCODER
+// Window bits stream header, as written by EncodeWindowBits() in enc/encode.c
+static void put_window_bits(int lgwin, uint64_t *bits, int *nbits)
+{
+    uint64_t v;
+    int n;
+
+    if (lgwin == 16) {
+        v = 0;
+        n = 1;
+    } else if (lgwin == 17) {
+        v = 1;
+        n = 7;
+    } else if (lgwin > 17) {
+        v = ((lgwin - 17) << 1) | 0x01;
+        n = 4;
+    } else {
+        v = ((lgwin - 8) << 4) | 0x01;
+        n = 7;
+    }
+    *bits |= v << *nbits;
+    *nbits += n;
+}
+
+/*
+    Queue the header of an uncompressed meta-block of len bytes (0 for the final empty one),
+    padded to a byte boundary as the format requires before raw data.
+*/
+static void stored_header(codec_t *codec, brotli_enc_ctx_t *ctx, size_t len)
+{
+    uint64_t bits = 0;
+    int nbits = 0;
+
+    if (!ctx->started) {
+        put_window_bits(codec->params.window_bits, &bits, &nbits);
+        ctx->started = true;
+    }
+
+    if (len == 0) {
+        bits |= (uint64_t)0x3 << nbits;             // ISLAST, ISLASTEMPTY
+        nbits += 2;
+    } else {
+        int lg = 1;
+        while (lg < 24 && ((size_t)1 << lg) < len) {
+            lg++;
+        }
+        int nibbles = lg < 16 ? 4 : (lg + 3) / 4;
+
+        nbits += 1;                                 // ISLAST = 0
+        bits |= (uint64_t)(nibbles - 4) << nbits;   // MNIBBLES
+        nbits += 2;
+        bits |= (uint64_t)(len - 1) << nbits;       // MLEN - 1
+        nbits += nibbles * 4;
+        bits |= (uint64_t)1 << nbits;               // ISUNCOMPRESSED
+        nbits += 1;
+    }
+
+    ctx->hdr_len = (nbits + 7) / 8;
+    ctx->hdr_pos = 0;
+    for (size_t i = 0; i < ctx->hdr_len; i++) {
+        ctx->hdr[i] = (uint8_t)(bits >> (8 * i));
+    }
+}
+
+// Stored output: input is copied out as uncompressed meta-blocks, which are always byte aligned
+static void stored_process(codec_t *codec, brotli_enc_ctx_t *ctx, const uint8_t **in, size_t *in_len,
+                           uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    while (*out_len > 0) {
+        if (ctx->hdr_pos < ctx->hdr_len) {
+            size_t n = ctx->hdr_len - ctx->hdr_pos < *out_len ? ctx->hdr_len - ctx->hdr_pos : *out_len;
+            memcpy(*out, ctx->hdr + ctx->hdr_pos, n);
+            ctx->hdr_pos += n;
+            *out += n;
+            *out_len -= n;
+        } else if (ctx->raw_left > 0) {
+            size_t n = ctx->raw_left < *in_len ? ctx->raw_left : *in_len;
+            if (n > *out_len) {
+                n = *out_len;
+            }
+            if (n == 0) {
+                break;
+            }
+            memcpy(*out, *in, n);
+            ctx->raw_left -= n;
+            *in += n;
+            *in_len -= n;
+            *out += n;
+            *out_len -= n;
+        } else if (*in_len > 0) {
+            ctx->raw_left = *in_len < STORED_MAX_BLOCK ? *in_len : STORED_MAX_BLOCK;
+            stored_header(codec, ctx, ctx->raw_left);
+        } else if (flush == CODEC_FLUSH_FINISH && !ctx->finished) {
+            stored_header(codec, ctx, 0);
+            ctx->finished = true;
+        } else {
+            break;
+        }
+    }
+
+    bool drained = ctx->hdr_pos == ctx->hdr_len && ctx->raw_left == 0 && *in_len == 0;
+    if (flush == CODEC_FLUSH_FINISH) {
+        *complete = ctx->finished && drained;
+    } else if (flush == CODEC_FLUSH_SYNC) {
+        *complete = drained;
+    }
+}
+#endif
+
+static esp_err_t brotli_process(codec_t *codec, const uint8_t **in, size_t *in_len,
+                                uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    if (codec->mode == CODEC_COMPRESS) {
+#if CONFIG_BROTLI_ENCODER
+        brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec->ctx;
+        BrotliEncoderState *enc = ctx->enc;
+
+        if (enc == NULL) {
+            stored_process(codec, ctx, in, in_len, out, out_len, flush, complete);
+            return ESP_OK;
+        }
+
+        BrotliEncoderOperation op = flush == CODEC_FLUSH_FINISH ? BROTLI_OPERATION_FINISH :
+                                    flush == CODEC_FLUSH_SYNC ? BROTLI_OPERATION_FLUSH :
+                                    BROTLI_OPERATION_PROCESS;
+
+        if (!BrotliEncoderCompressStream(enc, op, in_len, in, out_len, out, NULL)) {
+            return ESP_ERR_NO_MEM;
+        }
+
+        if (flush == CODEC_FLUSH_FINISH) {
+            *complete = BrotliEncoderIsFinished(enc);
+        } else if (flush == CODEC_FLUSH_SYNC) {
+            *complete = *in_len == 0 && !BrotliEncoderHasMoreOutput(enc);
+        }
+        return ESP_OK;
+#else
+        return ESP_ERR_NOT_SUPPORTED;
+#endif
+    }
+
+#if CONFIG_BROTLI_DECODER
+    BrotliDecoderResult res = BrotliDecoderDecompressStream((BrotliDecoderState *)codec->ctx,
+                              in_len, in, out_len, out, NULL);
+    switch (res) {
+    case BROTLI_DECODER_RESULT_SUCCESS:
+        *complete = true;
+        return ESP_OK;
+    case BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT:
+        return flush == CODEC_FLUSH_FINISH ? ESP_ERR_INVALID_SIZE : ESP_OK;
+    case BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT:
+        return ESP_OK;
+    default:
+        return ESP_ERR_INVALID_CRC;
+    }
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static esp_err_t brotli_downgrade(codec_t *codec, probe_verdict_t verdict)
+{
+#if CONFIG_BROTLI_ENCODER
+    brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec->ctx;
+
+    if (verdict == PROBE_STORE) {
+        // The encoder has not been fed, its memory can go right away
+        BrotliEncoderDestroyInstance(ctx->enc);
+        ctx->enc = NULL;
+        codec->stats.stored = true;
+        return ESP_OK;
+    }
+    if (codec->params.level > FAST_QUALITY) {
+        BrotliEncoderSetParameter(ctx->enc, BROTLI_PARAM_QUALITY, FAST_QUALITY);
+        codec->params.level = FAST_QUALITY;
+    }
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// Flush to a byte boundary, then drop the encoder and go on with stored meta-blocks
+static esp_err_t brotli_degrade(codec_t *codec, uint8_t **out, size_t *out_len, bool *complete)
+{
+#if CONFIG_BROTLI_ENCODER
+    brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec->ctx;
+    const uint8_t *next_in = NULL;
+    size_t avail_in = 0;
+
+    if (ctx->enc == NULL) {
+        *complete = true;
+        return ESP_OK;
+    }
+
+    if (!BrotliEncoderCompressStream(ctx->enc, BROTLI_OPERATION_FLUSH, &avail_in, &next_in,
+                                     out_len, out, NULL)) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (BrotliEncoderHasMoreOutput(ctx->enc)) {
+        return ESP_OK;
+    }
+
+    BrotliEncoderDestroyInstance(ctx->enc);
+    ctx->enc = NULL;
+    ctx->started = true;
+    *complete = true;
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+static void brotli_deinit(codec_t *codec)
+{
+#if CONFIG_BROTLI_ENCODER
+    if (codec->mode == CODEC_COMPRESS) {
+        brotli_enc_ctx_t *ctx = (brotli_enc_ctx_t *)codec->ctx;
+        if (ctx->enc != NULL) {
+            BrotliEncoderDestroyInstance(ctx->enc);
+        }
+        codec_free(codec, ctx);
+    }
+#endif
+#if CONFIG_BROTLI_DECODER
+    if (codec->mode == CODEC_DECOMPRESS) {
+        BrotliDecoderDestroyInstance((BrotliDecoderState *)codec->ctx);
+    }
+#endif
+}
+
+const codec_ops_t codec_brotli_ops = {
+    .default_params = brotli_default_params,
+    .mem_estimate = brotli_mem_estimate,
+    .shrink = brotli_shrink,
+    .init = brotli_init,
+    .reset = brotli_reset,
+    .process = brotli_process,
+    .deinit = brotli_deinit,
+    .downgrade = brotli_downgrade,
+    .degrade = brotli_degrade,
+    .can_flush = true,
+};
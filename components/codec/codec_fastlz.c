@@ -0,0 +1,219 @@
+#include <string.h>
+
+#include "fastlz.h"
+#include "fastlz_utils.h"
+
+#include "codec_priv.h"
+
+#define FRAME_SIZE (FASTLZ_HEADER_SIZE + FASTLZ_BOUND(FASTLZ_BLOCK_SIZE))
+
+typedef struct {
+    uint8_t *block;             // Raw block being filled (compress) or drained (decompress)
+    size_t block_len;
+    size_t block_pos;
+    uint8_t *frame;             // Framed block being drained (compress) or filled (decompress)
+    size_t frame_len;
+    size_t frame_pos;
+    uint16_t *htab;
+    size_t raw;                 // Header of the block being received
+    size_t comp;
+    bool magic_done;
+} fastlz_ctx_t;
+
+static void fastlz_default_params(codec_params_t *params)
+{
+    (void)params;
+}
+
+static size_t fastlz_mem_estimate(codec_mode_t mode, const codec_params_t *params)
+{
+    (void)params;
+    size_t size = sizeof(fastlz_ctx_t) + FASTLZ_BLOCK_SIZE + FRAME_SIZE;
+
+    if (mode == CODEC_COMPRESS) {
+        size += FASTLZ_HASH_SIZE * sizeof(uint16_t);
+    }
+    return size;
+}
+
+static bool fastlz_shrink(codec_params_t *params)
+{
+    (void)params;
+    return false;
+}
+
+static esp_err_t fastlz_init(codec_t *codec)
+{
+    fastlz_ctx_t *ctx = (fastlz_ctx_t *)codec_alloc(codec, sizeof(fastlz_ctx_t));
+    if (ctx == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(ctx, 0, sizeof(fastlz_ctx_t));
+    codec->ctx = ctx;
+
+    ctx->block = (uint8_t *)codec_alloc(codec, FASTLZ_BLOCK_SIZE);
+    ctx->frame = (uint8_t *)codec_alloc(codec, FRAME_SIZE);
+    if (codec->mode == CODEC_COMPRESS) {
+        ctx->htab = (uint16_t *)codec_alloc(codec, FASTLZ_HASH_SIZE * sizeof(uint16_t));
+    }
+
+    if (ctx->block == NULL || ctx->frame == NULL || (codec->mode == CODEC_COMPRESS && ctx->htab == NULL)) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+static inline size_t copy_out(const uint8_t *src, size_t *pos, size_t len, uint8_t **out, size_t *out_len)
+{
+    size_t n = len - *pos < *out_len ? len - *pos : *out_len;
+    memcpy(*out, src + *pos, n);
+    *pos += n;
+    *out += n;
+    *out_len -= n;
+    return n;
+}
+
+static inline size_t copy_in(uint8_t *dst, size_t *fill, size_t want, const uint8_t **in, size_t *in_len)
+{
+    size_t n = want - *fill < *in_len ? want - *fill : *in_len;
+    memcpy(dst + *fill, *in, n);
+    *fill += n;
+    *in += n;
+    *in_len -= n;
+    return n;
+}
+
+static esp_err_t fastlz_compress_process(fastlz_ctx_t *ctx, const uint8_t **in, size_t *in_len,
+                                         uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    for (;;) {
+        copy_out(ctx->frame, &ctx->frame_pos, ctx->frame_len, out, out_len);
+        if (ctx->frame_pos < ctx->frame_len) {
+            return ESP_OK;
+        }
+
+        if (!ctx->magic_done) {
+            memcpy(ctx->frame, FASTLZ_MAGIC, FASTLZ_MAGIC_SIZE);
+            ctx->frame_len = FASTLZ_MAGIC_SIZE;
+            ctx->frame_pos = 0;
+            ctx->magic_done = true;
+            continue;
+        }
+
+        copy_in(ctx->block, &ctx->block_len, FASTLZ_BLOCK_SIZE, in, in_len);
+
+        // Full blocks go out immediately, a partial one only on flush or finish
+        if (ctx->block_len == FASTLZ_BLOCK_SIZE || (flush != CODEC_FLUSH_NONE && ctx->block_len > 0)) {
+            ctx->frame_len = fastlz_compress_block(ctx->block, ctx->block_len, ctx->frame, ctx->htab);
+            ctx->frame_pos = 0;
+            ctx->block_len = 0;
+            continue;
+        }
+
+        *complete = flush != CODEC_FLUSH_NONE;
+        return ESP_OK;
+    }
+}
+
+static esp_err_t fastlz_decompress_process(fastlz_ctx_t *ctx, const uint8_t **in, size_t *in_len,
+                                           uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    for (;;) {
+        copy_out(ctx->block, &ctx->block_pos, ctx->block_len, out, out_len);
+        if (ctx->block_pos < ctx->block_len) {
+            return ESP_OK;
+        }
+
+        if (*in_len == 0) {
+            // Stream may only end on a block boundary
+            if (flush == CODEC_FLUSH_FINISH) {
+                if (!ctx->magic_done || ctx->frame_len > 0) {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+                *complete = true;
+            }
+            return ESP_OK;
+        }
+
+        if (!ctx->magic_done) {
+            copy_in(ctx->frame, &ctx->frame_len, FASTLZ_MAGIC_SIZE, in, in_len);
+            if (ctx->frame_len == FASTLZ_MAGIC_SIZE) {
+                if (memcmp(ctx->frame, FASTLZ_MAGIC, FASTLZ_MAGIC_SIZE) != 0) {
+                    return ESP_ERR_INVALID_ARG;
+                }
+                ctx->magic_done = true;
+                ctx->frame_len = 0;
+            }
+            continue;
+        }
+
+        if (ctx->frame_len < FASTLZ_HEADER_SIZE) {
+            copy_in(ctx->frame, &ctx->frame_len, FASTLZ_HEADER_SIZE, in, in_len);
+            if (ctx->frame_len == FASTLZ_HEADER_SIZE) {
+                ctx->raw = ctx->frame[0] | (ctx->frame[1] << 8);
+                ctx->comp = ctx->frame[2] | (ctx->frame[3] << 8);
+                if (ctx->raw == 0 || ctx->raw > FASTLZ_BLOCK_SIZE || ctx->comp > ctx->raw) {
+                    return ESP_ERR_INVALID_SIZE;
+                }
+            }
+            continue;
+        }
+
+        copy_in(ctx->frame, &ctx->frame_len, FASTLZ_HEADER_SIZE + ctx->comp, in, in_len);
+        if (ctx->frame_len == FASTLZ_HEADER_SIZE + ctx->comp) {
+            esp_err_t ret = fastlz_decompress_block(ctx->frame + FASTLZ_HEADER_SIZE, ctx->raw, ctx->comp, ctx->block);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            ctx->block_len = ctx->raw;
+            ctx->block_pos = 0;
+            ctx->frame_len = 0;
+        }
+    }
+}
+
+static esp_err_t fastlz_process(codec_t *codec, const uint8_t **in, size_t *in_len,
+                                uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    if (codec->mode == CODEC_COMPRESS) {
+        return fastlz_compress_process((fastlz_ctx_t *)codec->ctx, in, in_len, out, out_len, flush, complete);
+    }
+    return fastlz_decompress_process((fastlz_ctx_t *)codec->ctx, in, in_len, out, out_len, flush, complete);
+}
+
+static esp_err_t fastlz_downgrade(codec_t *codec, probe_verdict_t verdict)
+{
+    fastlz_ctx_t *ctx = (fastlz_ctx_t *)codec->ctx;
+
+    // Already the fastest level; without a hash table every block is written stored
+    if (verdict == PROBE_STORE) {
+        codec_free(codec, ctx->htab);
+        ctx->htab = NULL;
+        codec->stats.stored = true;
+    }
+    return ESP_OK;
+}
+
+static void fastlz_deinit(codec_t *codec)
+{
+    fastlz_ctx_t *ctx = (fastlz_ctx_t *)codec->ctx;
+
+    if (ctx == NULL) {
+        return;
+    }
+    codec_free(codec, ctx->block);
+    codec_free(codec, ctx->frame);
+    codec_free(codec, ctx->htab);
+    codec_free(codec, ctx);
+}
+
+const codec_ops_t codec_fastlz_ops = {
+    .default_params = fastlz_default_params,
+    .mem_estimate = fastlz_mem_estimate,
+    .shrink = fastlz_shrink,
+    .init = fastlz_init,
+    .process = fastlz_process,
+    .deinit = fastlz_deinit,
+    .downgrade = fastlz_downgrade,
+    .can_flush = true,
+};
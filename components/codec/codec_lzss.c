@@ -0,0 +1,106 @@
+#include <string.h>
+
+#include "lzss.h"
+
+#include "codec_priv.h"
+
+static void lzss_default_params(codec_params_t *params)
+{
+    params->window_bits = LZSS_WINDOW_BITS;
+}
+
+static size_t lzss_mem_estimate(codec_mode_t mode, const codec_params_t *params)
+{
+    (void)params;
+    return mode == CODEC_COMPRESS ? sizeof(lzss_encoder_t) : sizeof(lzss_decoder_t);
+}
+
+static bool lzss_shrink(codec_params_t *params)
+{
+    (void)params;
+    return false;
+}
+
+static esp_err_t lzss_init(codec_t *codec)
+{
+    if (codec->mode == CODEC_COMPRESS) {
+        lzss_encoder_t *enc = (lzss_encoder_t *)codec_alloc(codec, sizeof(lzss_encoder_t));
+        if (enc == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        lzss_encoder_reset(enc);
+        codec->ctx = enc;
+    } else {
+        lzss_decoder_t *dec = (lzss_decoder_t *)codec_alloc(codec, sizeof(lzss_decoder_t));
+        if (dec == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        lzss_decoder_reset(dec);
+        codec->ctx = dec;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t lzss_process(codec_t *codec, const uint8_t **in, size_t *in_len,
+                              uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    size_t taken, have;
+    lzss_res_t res;
+    bool compress = codec->mode == CODEC_COMPRESS;
+
+    for (;;) {
+        if (*in_len > 0) {
+            if (compress) {
+                lzss_encoder_sink((lzss_encoder_t *)codec->ctx, *in, *in_len, &taken);
+            } else {
+                lzss_decoder_sink((lzss_decoder_t *)codec->ctx, *in, *in_len, &taken);
+            }
+            *in += taken;
+            *in_len -= taken;
+        }
+
+        if (compress) {
+            res = lzss_encoder_poll((lzss_encoder_t *)codec->ctx, *out, *out_len, &have);
+        } else {
+            res = lzss_decoder_poll((lzss_decoder_t *)codec->ctx, *out, *out_len, &have);
+        }
+        *out += have;
+        *out_len -= have;
+
+        if (res == LZSS_MORE) {
+            return ESP_OK;
+        }
+        if (*in_len > 0) {
+            continue;
+        }
+
+        // LZSS has no end marker: the stream ends when the caller finishes it
+        if (flush == CODEC_FLUSH_FINISH) {
+            res = compress ? lzss_encoder_finish((lzss_encoder_t *)codec->ctx)
+                           : lzss_decoder_finish((lzss_decoder_t *)codec->ctx);
+            if (res == LZSS_DONE) {
+                *complete = true;
+                return ESP_OK;
+            }
+            if (*out_len > 0) {
+                continue;
+            }
+        }
+        return ESP_OK;
+    }
+}
+
+static void lzss_deinit(codec_t *codec)
+{
+    codec_free(codec, codec->ctx);
+}
+
+const codec_ops_t codec_lzss_ops = {
+    .default_params = lzss_default_params,
+    .mem_estimate = lzss_mem_estimate,
+    .shrink = lzss_shrink,
+    .init = lzss_init,
+    .process = lzss_process,
+    .deinit = lzss_deinit,
+    .can_flush = false,
+};
@@ -0,0 +1,131 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "esp_log.h"
+
+#include "codec_pool.h"
+
+static const char *TAG = "codec_pool";
+
+struct codec_pool {
+    pthread_mutex_t lock;
+    codec_type_t type;
+    codec_mode_t mode;
+    codec_params_t params;
+    size_t mem_budget;
+    size_t size;                // Codecs the pool may hold
+    size_t created;             // Codecs alive, idle or taken
+    size_t idle_count;
+    codec_t **idle;
+};
+
+esp_err_t codec_pool_create(codec_type_t type, codec_mode_t mode, const codec_params_t *params,
+                            size_t mem_budget, size_t count, codec_pool_t **out)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (count == 0 || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    codec_pool_t *pool = (codec_pool_t *)calloc(1, sizeof(codec_pool_t));
+    if (pool == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    pool->idle = (codec_t **)calloc(count, sizeof(codec_t *));
+    if (pool->idle == NULL) {
+        free(pool);
+        return ESP_ERR_NO_MEM;
+    }
+
+    pthread_mutex_init(&pool->lock, NULL);
+    pool->type = type;
+    pool->mode = mode;
+    if (params != NULL) {
+        pool->params = *params;
+    } else {
+        codec_default_params(type, &pool->params);
+    }
+    pool->mem_budget = mem_budget;
+    pool->size = count;
+
+    for (size_t i = 0; i < count; i++) {
+        ret = codec_create(type, mode, &pool->params, mem_budget, &pool->idle[i]);
+        if (ret != ESP_OK) {
+            goto CLEANUP;
+        }
+        pool->idle_count++;
+        pool->created++;
+    }
+
+    *out = pool;
+    return ESP_OK;
+
+CLEANUP:
+    codec_pool_destroy(pool);
+    return ret;
+}
+
+esp_err_t codec_pool_get(codec_pool_t *pool, codec_t **out)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (pool == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->idle_count > 0) {
+        *out = pool->idle[--pool->idle_count];
+    } else if (pool->created < pool->size) {
+        // Replaces a codec that failed to reset
+        ret = codec_create(pool->type, pool->mode, &pool->params, pool->mem_budget, out);
+        if (ret == ESP_OK) {
+            pool->created++;
+        }
+    } else {
+        ret = ESP_ERR_NOT_FOUND;
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return ret;
+}
+
+void codec_pool_put(codec_pool_t *pool, codec_t *codec)
+{
+    if (pool == NULL || codec == NULL) {
+        return;
+    }
+
+    // Reset outside the lock, it can take a while for codecs that re-init
+    esp_err_t ret = codec_reset(codec);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "%s: reset failed (%s), dropping codec", codec_name(pool->type), esp_err_to_name(ret));
+        codec_destroy(codec);
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    if (ret == ESP_OK) {
+        pool->idle[pool->idle_count++] = codec;
+    } else {
+        pool->created--;
+    }
+    pthread_mutex_unlock(&pool->lock);
+}
+
+void codec_pool_destroy(codec_pool_t *pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    if (pool->idle_count < pool->created) {
+        ESP_LOGE(TAG, "%d codecs still taken", (int)(pool->created - pool->idle_count));
+    }
+    for (size_t i = 0; i < pool->idle_count; i++) {
+        codec_destroy(pool->idle[i]);
+    }
+    pthread_mutex_destroy(&pool->lock);
+    free(pool->idle);
+    free(pool);
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "codec.h"
+#include "probe.h"
+
+#define CODEC_BUFFER_SIZE (CONFIG_CODEC_BUFFER_SIZE)
+
+typedef enum {
+    CODEC_FLUSH_NONE,
+    CODEC_FLUSH_SYNC,
+    CODEC_FLUSH_FINISH,
+} codec_flush_t;
+
+typedef struct {
+    void (*default_params)(codec_params_t *params);
+    size_t (*mem_estimate)(codec_mode_t mode, const codec_params_t *params);
+    // Lower the memory needs of params one step; false when already minimal
+    bool (*shrink)(codec_params_t *params);
+    esp_err_t (*init)(codec_t *codec);
+    // Start a new stream with codec->params, keeping allocations; NULL or ESP_ERR_NOT_SUPPORTED: re-init
+    esp_err_t (*reset)(codec_t *codec);
+    /*
+        Consume from *in and produce into *out, advancing both, until input runs out or output is full.
+        Sets *complete once the requested flush, finish or (decompression) end of stream is reached.
+    */
+    esp_err_t (*process)(codec_t *codec, const uint8_t **in, size_t *in_len,
+                         uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete);
+    void (*deinit)(codec_t *codec);
+    // Switch a compressor that has not seen input yet to a cheaper mode; NULL if not supported
+    esp_err_t (*downgrade)(codec_t *codec, probe_verdict_t verdict);
+    /*
+        Memory pressure: end the current block into *out, then continue the stream in the lightest
+        configuration and release the current one. Called until *complete; NULL if not supported.
+    */
+    esp_err_t (*degrade)(codec_t *codec, uint8_t **out, size_t *out_len, bool *complete);
+    bool can_flush;
+} codec_ops_t;
+
+struct codec {
+    const codec_ops_t *ops;
+    codec_type_t type;
+    codec_mode_t mode;
+    codec_params_t params;
+    codec_params_t base_params; // As created, before probe or memory pressure changed them
+    void *ctx;                  // Codec specific state
+    uint8_t *buf;               // Staged input
+    size_t buf_pos;
+    size_t buf_len;
+    size_t buf_filtered;        // Staged input up to here has been through the filter
+    filter_t filter;
+    uint8_t *block;             // Decompressed SHUFFLE block being collected or handed out
+    size_t block_pos;
+    size_t block_len;
+    codec_flush_t pending;
+    bool auto_flush;            // pending was set by the auto flush limits
+    size_t flush_bytes;         // Auto flush limits, 0 if unset
+    uint32_t flush_age_us;
+    size_t unflushed;           // Pushed since the last flush
+    int64_t unflushed_since;    // When the first of them was pushed
+    size_t low_water;           // Free heap watermark for degrade(), 0 if unset
+    codec_low_mem_cb_t low_mem_cb;
+    void *low_mem_arg;
+    bool degrading;             // degrade() started, not complete yet
+    bool probed;
+    bool done;
+    size_t mem_budget;
+    codec_stats_t stats;
+};
+
+extern const codec_ops_t codec_zlib_ops;
+extern const codec_ops_t codec_brotli_ops;
+extern const codec_ops_t codec_fastlz_ops;
+extern const codec_ops_t codec_lzss_ops;
+
+// Tracked allocation: counts towards the stats and the memory budget
+void *codec_alloc(codec_t *codec, size_t size);
+
+void codec_free(codec_t *codec, void *ptr);
@@ -0,0 +1,311 @@
+#include <string.h>
+
+#include "zlib.h"
+#include "sdkconfig.h"
+
+#include "codec_priv.h"
+
+// Matches zlib_utils: zlib rejects a window of 8 with gzip and writes 9 into zlib headers for it
+#define WINDOW_BITS(bits) ((bits) == 8 ? 9 : (bits))
+
+// Raw deflate continuation under memory pressure: the smallest window and hash zlib allows
+#define LIGHT_WINDOW_BITS (9)
+#define LIGHT_MEM_LEVEL (1)
+
+typedef struct {
+    z_stream strm;
+    /*
+        Degraded: the stream goes on as raw deflate after a full flush, so the header already
+        written stays valid and the check value and trailer are kept here instead of by zlib.
+    */
+    bool raw;
+    uLong check;                // crc32 (gzip) / adler32 (zlib) of all input
+    uLong total_in;
+    uint8_t trailer[8];
+    size_t trailer_len;
+    size_t trailer_pos;
+} zlib_ctx_t;
+
+static voidpf zlib_alloc(voidpf opaque, uInt items, uInt size)
+{
+    return codec_alloc((codec_t *)opaque, (size_t)items * size);
+}
+
+static void zlib_free(voidpf opaque, voidpf ptr)
+{
+    codec_free((codec_t *)opaque, ptr);
+}
+
+static void zlib_default_params(codec_params_t *params)
+{
+    params->level = CONFIG_COMPRESSION_LEVEL;
+    params->window_bits = CONFIG_WINDOW_SIZE;
+    params->mem_level = CONFIG_MEM_LEVEL;
+    params->strategy = CONFIG_COMPRESSION_STRATEGY;
+}
+
+// From zconf.h: deflate needs (1 << (windowBits+2)) + (1 << (memLevel+9)), inflate 1 << windowBits
+static size_t zlib_mem_estimate(codec_mode_t mode, const codec_params_t *params)
+{
+    int bits = WINDOW_BITS(params->window_bits);
+
+    if (mode == CODEC_COMPRESS) {
+        return sizeof(zlib_ctx_t) + (1 << (bits + 2)) + (1 << (params->mem_level + 9)) + 6 * 1024;
+    }
+    return sizeof(zlib_ctx_t) + (1 << bits) + 7 * 1024;
+}
+
+static bool zlib_shrink(codec_params_t *params)
+{
+    if (params->mem_level > 1) {
+        params->mem_level--;
+        return true;
+    }
+    if (params->window_bits > 9) {
+        params->window_bits--;
+        return true;
+    }
+    return false;
+}
+
+static void zlib_stream_init(codec_t *codec, z_stream *strm)
+{
+    memset(strm, 0, sizeof(z_stream));
+    strm->zalloc = zlib_alloc;
+    strm->zfree = zlib_free;
+    strm->opaque = codec;
+}
+
+static esp_err_t zlib_init(codec_t *codec)
+{
+    int ret;
+    int bits = WINDOW_BITS(codec->params.window_bits);
+
+    if (codec->type == CODEC_GZIP) {
+        bits |= 16;
+    }
+
+    zlib_ctx_t *ctx = (zlib_ctx_t *)codec_alloc(codec, sizeof(zlib_ctx_t));
+    if (ctx == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    memset(ctx, 0, sizeof(zlib_ctx_t));
+    zlib_stream_init(codec, &ctx->strm);
+
+    if (codec->mode == CODEC_COMPRESS) {
+        ret = deflateInit2(&ctx->strm, codec->params.level, Z_DEFLATED, bits,
+                           codec->params.mem_level, codec->params.strategy);
+    } else {
+        ret = inflateInit2(&ctx->strm, bits);
+    }
+
+    if (ret != Z_OK) {
+        codec_free(codec, ctx);
+        return ret == Z_MEM_ERROR ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_ARG;
+    }
+
+    codec->ctx = ctx;
+    return ESP_OK;
+}
+
+// A degraded stream has a smaller window and hash than params ask for and is re-created instead
+static esp_err_t zlib_reset(codec_t *codec)
+{
+    zlib_ctx_t *ctx = (zlib_ctx_t *)codec->ctx;
+
+    if (codec->mode == CODEC_DECOMPRESS) {
+        return inflateReset(&ctx->strm) == Z_OK ? ESP_OK : ESP_FAIL;
+    }
+    if (ctx->raw) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // The probe may have lowered the level; no block is emitted on a fresh stream
+    if (deflateReset(&ctx->strm) != Z_OK ||
+        deflateParams(&ctx->strm, codec->params.level, codec->params.strategy) != Z_OK) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// gzip: CRC-32 and ISIZE little endian, zlib: Adler-32 big endian
+static void zlib_trailer(codec_t *codec, zlib_ctx_t *ctx)
+{
+    if (codec->type == CODEC_GZIP) {
+        for (int i = 0; i < 4; i++) {
+            ctx->trailer[i] = (uint8_t)(ctx->check >> (8 * i));
+            ctx->trailer[4 + i] = (uint8_t)(ctx->total_in >> (8 * i));
+        }
+        ctx->trailer_len = 8;
+    } else {
+        for (int i = 0; i < 4; i++) {
+            ctx->trailer[i] = (uint8_t)(ctx->check >> (24 - 8 * i));
+        }
+        ctx->trailer_len = 4;
+    }
+}
+
+// Raw deflate after degrade(): account the consumed input and append the trailer at the end
+static bool zlib_raw_done(codec_t *codec, zlib_ctx_t *ctx, const uint8_t *in, size_t used, int ret)
+{
+    z_stream *strm = &ctx->strm;
+
+    if (codec->type == CODEC_GZIP) {
+        ctx->check = crc32(ctx->check, in, used);
+    } else {
+        ctx->check = adler32(ctx->check, in, used);
+    }
+    ctx->total_in += used;
+
+    if (ret != Z_STREAM_END) {
+        return false;
+    }
+    if (ctx->trailer_len == 0) {
+        zlib_trailer(codec, ctx);
+    }
+    size_t n = ctx->trailer_len - ctx->trailer_pos;
+    n = n < strm->avail_out ? n : strm->avail_out;
+    memcpy(strm->next_out, ctx->trailer + ctx->trailer_pos, n);
+    strm->next_out += n;
+    strm->avail_out -= n;
+    ctx->trailer_pos += n;
+    return ctx->trailer_pos == ctx->trailer_len;
+}
+
+static esp_err_t zlib_process(codec_t *codec, const uint8_t **in, size_t *in_len,
+                              uint8_t **out, size_t *out_len, codec_flush_t flush, bool *complete)
+{
+    int ret;
+    zlib_ctx_t *ctx = (zlib_ctx_t *)codec->ctx;
+    z_stream *strm = &ctx->strm;
+
+    strm->next_in = (z_const Bytef *)*in;
+    strm->avail_in = *in_len;
+    strm->next_out = *out;
+    strm->avail_out = *out_len;
+
+    if (codec->mode == CODEC_COMPRESS) {
+        int zflush = flush == CODEC_FLUSH_FINISH ? Z_FINISH :
+                     flush == CODEC_FLUSH_SYNC ? Z_SYNC_FLUSH : Z_NO_FLUSH;
+        // Raw deflate is at its end while the trailer is still going out
+        ret = ctx->trailer_len > 0 ? Z_STREAM_END : deflate(strm, zflush);
+        bool ended = ret == Z_STREAM_END;
+        if (ctx->raw) {
+            ended = zlib_raw_done(codec, ctx, *in, *in_len - strm->avail_in, ret);
+        }
+        // A flush is complete once deflate leaves output space unused
+        *complete = (flush == CODEC_FLUSH_FINISH && ended) ||
+                    (flush == CODEC_FLUSH_SYNC && strm->avail_in == 0 && strm->avail_out != 0);
+    } else {
+        ret = inflate(strm, Z_NO_FLUSH);
+        *complete = ret == Z_STREAM_END;
+    }
+
+    *in = strm->next_in;
+    *in_len = strm->avail_in;
+    *out = strm->next_out;
+    *out_len = strm->avail_out;
+
+    switch (ret) {
+    case Z_OK:
+    case Z_STREAM_END:
+        return ESP_OK;
+    case Z_BUF_ERROR:
+        // No progress possible; only an error when the compressed stream ended early
+        if (codec->mode == CODEC_DECOMPRESS && flush == CODEC_FLUSH_FINISH && *in_len == 0 && *out_len > 0) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        return ESP_OK;
+    case Z_MEM_ERROR:
+        return ESP_ERR_NO_MEM;
+    default:
+        return ESP_ERR_INVALID_CRC;
+    }
+}
+
+static esp_err_t zlib_downgrade(codec_t *codec, probe_verdict_t verdict)
+{
+    int level = verdict == PROBE_STORE ? Z_NO_COMPRESSION : Z_BEST_SPEED;
+
+    if (codec->params.level == Z_NO_COMPRESSION) {
+        return ESP_OK;
+    }
+    // No input has been deflated yet, so this changes the level without emitting a block
+    if (deflateParams(&((zlib_ctx_t *)codec->ctx)->strm, level, codec->params.strategy) != Z_OK) {
+        return ESP_FAIL;
+    }
+
+    codec->params.level = level;
+    codec->stats.stored = level == Z_NO_COMPRESSION;
+    return ESP_OK;
+}
+
+/*
+    A full flush ends the block byte aligned and leaves nothing referring back into the window,
+    so a new raw deflate stream can carry on where it stopped, under the same header.
+*/
+static esp_err_t zlib_degrade(codec_t *codec, uint8_t **out, size_t *out_len, bool *complete)
+{
+    zlib_ctx_t *ctx = (zlib_ctx_t *)codec->ctx;
+    z_stream *strm = &ctx->strm;
+
+    if (ctx->raw) {
+        *complete = true;
+        return ESP_OK;
+    }
+
+    strm->next_in = NULL;
+    strm->avail_in = 0;
+    strm->next_out = *out;
+    strm->avail_out = *out_len;
+    int ret = deflate(strm, Z_FULL_FLUSH);
+    *out = strm->next_out;
+    *out_len = strm->avail_out;
+    if (ret != Z_OK && ret != Z_BUF_ERROR) {
+        return ESP_FAIL;
+    }
+    if (strm->avail_out == 0) {
+        return ESP_OK;
+    }
+
+    ctx->check = strm->adler;
+    ctx->total_in = strm->total_in;
+    (void)deflateEnd(strm);
+    zlib_stream_init(codec, strm);
+    ctx->raw = true;
+
+    codec->params.window_bits = LIGHT_WINDOW_BITS;
+    codec->params.mem_level = LIGHT_MEM_LEVEL;
+    ret = deflateInit2(strm, codec->params.level, Z_DEFLATED, -LIGHT_WINDOW_BITS,
+                       LIGHT_MEM_LEVEL, codec->params.strategy);
+    if (ret != Z_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    *complete = true;
+    return ESP_OK;
+}
+
+static void zlib_deinit(codec_t *codec)
+{
+    zlib_ctx_t *ctx = (zlib_ctx_t *)codec->ctx;
+
+    if (codec->mode == CODEC_COMPRESS) {
+        (void)deflateEnd(&ctx->strm);
+    } else {
+        (void)inflateEnd(&ctx->strm);
+    }
+    codec_free(codec, ctx);
+}
+
+const codec_ops_t codec_zlib_ops = {
+    .default_params = zlib_default_params,
+    .mem_estimate = zlib_mem_estimate,
+    .shrink = zlib_shrink,
+    .init = zlib_init,
+    .reset = zlib_reset,
+    .process = zlib_process,
+    .deinit = zlib_deinit,
+    .downgrade = zlib_downgrade,
+    .degrade = zlib_degrade,
+    .can_flush = true,
+};
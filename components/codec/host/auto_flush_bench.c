@@ -0,0 +1,139 @@
+/*
+    Host benchmark for codec_set_auto_flush(): 2000 JSON telemetry records of about 50 bytes,
+    one per millisecond, compressed with gzip and Brotli at the Kconfig defaults without
+    flushing, with a flush after every record and with auto flush age limits. Prints the
+    README table (flushes and worst latency from the gzip run); every stream is decompressed
+    and compared with the records.
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/codec/include -I$C/codec -I$C/filter/include -I$C/probe/include -I$C/zlib_utils/include -I$C/zlib/include -I$C/brotli/include -I$C/fastlz/include -I$C/lzss/include -o auto_flush_bench $C/codec/host/auto_flush_bench.c $C/codec/codec.c $C/codec/codec_zlib.c $C/codec/codec_brotli.c $C/codec/codec_fastlz.c $C/codec/codec_lzss.c $C/filter/filter.c $C/probe/probe.c $C/zlib_utils/zlib_utils.c $C/zlib/src/*.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c $C/fastlz/*.c $C/lzss/*.c -lm -lpthread
+//   ./auto_flush_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sdkconfig.h"
+
+#include "codec.h"
+
+#define RECORDS (2000)
+#define RECORD_INTERVAL_US (1000)
+#define BUF_SIZE (256 * 1024)
+#define PULL_SIZE (1024)
+
+typedef enum {
+    FLUSH_NONE,
+    FLUSH_EVERY_RECORD,
+    FLUSH_AUTO,
+} flush_mode_t;
+
+static const struct {
+    const char *name;
+    flush_mode_t mode;
+    uint32_t max_age_us;
+} s_rows[] = {
+    { "No flush", FLUSH_NONE, 0 },
+    { "Flush every record", FLUSH_EVERY_RECORD, 0 },
+    { "Auto, 20 ms", FLUSH_AUTO, 20000 },
+    { "Auto, 100 ms", FLUSH_AUTO, 100000 },
+    { "Auto, 500 ms", FLUSH_AUTO, 500000 },
+};
+
+static uint8_t s_records[BUF_SIZE];
+static uint8_t s_comp[BUF_SIZE];
+static uint8_t s_back[BUF_SIZE];
+
+static esp_err_t drain(codec_t *codec, size_t *comp_len)
+{
+    esp_err_t ret;
+    size_t produced;
+
+    do {
+        if (*comp_len + PULL_SIZE > BUF_SIZE) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        ret = codec_pull(codec, s_comp + *comp_len, PULL_SIZE, &produced);
+        *comp_len += produced;
+    } while (ret == ESP_OK && produced == PULL_SIZE);
+    return ret;
+}
+
+// Ratio of one run, 0 on failure or mismatch
+static double run(codec_type_t type, flush_mode_t mode, uint32_t max_age_us, codec_stats_t *st)
+{
+    codec_t *codec;
+    size_t raw_len = 0, comp_len = 0, back_len = BUF_SIZE, consumed;
+    esp_err_t ret = ESP_OK;
+
+    if (codec_create(type, CODEC_COMPRESS, NULL, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    if (mode == FLUSH_AUTO && codec_set_auto_flush(codec, 0, max_age_us) != ESP_OK) {
+        codec_destroy(codec);
+        return 0;
+    }
+
+    srand(1);
+    for (int i = 0; i < RECORDS && ret == ESP_OK; i++) {
+        char *rec = (char *)s_records + raw_len;
+        int n = snprintf(rec, BUF_SIZE - raw_len, "{\"t\":%d,\"temp\":%.2f,\"rh\":%d,\"state\":\"%s\"}\n",
+                         1700000000 + i, 21.5 + (rand() % 100) / 100.0, 40 + rand() % 5, rand() % 10 ? "ok" : "warn");
+        raw_len += n;
+        for (int off = 0; off < n && ret == ESP_OK; off += consumed) {
+            codec_push(codec, (uint8_t *)rec + off, n - off, &consumed);
+            ret = drain(codec, &comp_len);
+        }
+        if (mode == FLUSH_EVERY_RECORD && ret == ESP_OK) {
+            codec_flush(codec);
+            ret = drain(codec, &comp_len);
+        }
+        usleep(RECORD_INTERVAL_US);
+    }
+    codec_finish(codec);
+    while (ret == ESP_OK && !codec_is_done(codec)) {
+        ret = drain(codec, &comp_len);
+    }
+    codec_get_stats(codec, st);
+    codec_destroy(codec);
+    if (ret != ESP_OK || codec_create(type, CODEC_DECOMPRESS, NULL, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    ret = codec_buf(codec, s_comp, comp_len, s_back, &back_len);
+    codec_destroy(codec);
+    if (ret != ESP_OK || back_len != raw_len || memcmp(s_back, s_records, raw_len) != 0) {
+        return 0;
+    }
+    return (double)raw_len / comp_len;
+}
+
+int main(void)
+{
+    codec_stats_t st, st_brotli;
+    int fail = 0;
+
+    printf("| %dK of 50 byte telemetry records, 1 per ms (host) | gzip ratio | Brotli q%d ratio | Flushes | Worst latency |\n",
+           RECORDS * 50 / 1000, CONFIG_CODEC_BROTLI_QUALITY);
+    printf("| --- | --- | --- | --- | --- |\n");
+    for (size_t i = 0; i < sizeof(s_rows) / sizeof(s_rows[0]); i++) {
+        double gzip = run(CODEC_GZIP, s_rows[i].mode, s_rows[i].max_age_us, &st);
+        double brotli = run(CODEC_BROTLI, s_rows[i].mode, s_rows[i].max_age_us, &st_brotli);
+        if (gzip == 0 || brotli == 0) {
+            printf("| %s | FAILED |\n", s_rows[i].name);
+            fail = 1;
+            continue;
+        }
+        printf("| %s | %.2f | %.2f | %u | ", s_rows[i].name, gzip, brotli, (unsigned)st.flushes);
+        if (st.flushes == 0) {
+            printf("- |\n");
+        } else if (st.max_flush_latency_us < 1000) {
+            printf("< 1 ms |\n");
+        } else {
+            printf("%lld ms |\n", (long long)(st.max_flush_latency_us / 1000));
+        }
+    }
+    return fail;
+}
@@ -0,0 +1,223 @@
+/*
+    Host benchmark for codec_pool.h: messages of 100 bytes to 4K compressed by a codec created
+    and destroyed per message against one taken from a pool. Prints the README tables:
+    messages/s for gzip (window 15, memLevel 8), mallocs per message for Brotli q1 and q5 and
+    messages/s for Brotli q9 (window 18).
+
+    First checks, for every codec type, that pooled output is byte identical to a fresh codec's
+    and that a pooled decompressor restores each message.
+
+    Messages are slices of assets/hello-world.bin followed by copies of assets/demo.txt. Run
+    from the repository root. malloc is wrapped to count allocations.
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/codec/include -I$C/codec -I$C/filter/include -I$C/probe/include -I$C/zlib_utils/include -I$C/zlib/include -I$C/brotli/include -I$C/fastlz/include -I$C/lzss/include -Wl,--wrap=malloc -o pool_bench $C/codec/host/pool_bench.c $C/codec/codec.c $C/codec/codec_pool.c $C/codec/codec_zlib.c $C/codec/codec_brotli.c $C/codec/codec_fastlz.c $C/codec/codec_lzss.c $C/filter/filter.c $C/probe/probe.c $C/zlib_utils/zlib_utils.c $C/zlib/src/*.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c $C/fastlz/*.c $C/lzss/*.c -lm -lpthread
+//   ./pool_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_timer.h"
+
+#include "codec.h"
+#include "codec_pool.h"
+
+#define BINARY_PATH "assets/hello-world.bin"
+#define TEXT_PATH "assets/demo.txt"
+#define TEXT_COPIES (16)
+#define DATA_MAX (300 * 1024)
+#define MSG_MAX (4096)
+#define OUT_SIZE (2 * MSG_MAX + 1024)
+#define CHECK_MESSAGES (40)
+
+static uint8_t s_data[DATA_MAX];
+static size_t s_data_len;
+static long s_mallocs;
+
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size)
+{
+    s_mallocs++;
+    return __real_malloc(size);
+}
+
+static bool append_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        printf("cannot open %s, run from the repository root\n", path);
+        return false;
+    }
+    s_data_len += fread(s_data + s_data_len, 1, DATA_MAX - s_data_len, f);
+    fclose(f);
+    return true;
+}
+
+static const uint8_t *message(int i, size_t len)
+{
+    return s_data + (i * 977) % (s_data_len - len);
+}
+
+// Compressed length, 0 on failure
+static size_t compress_msg(codec_t *codec, const uint8_t *in, size_t len, uint8_t *out)
+{
+    size_t out_len = OUT_SIZE;
+    return codec_buf(codec, in, len, out, &out_len) == ESP_OK ? out_len : 0;
+}
+
+static int check_identical(void)
+{
+    static uint8_t pooled[OUT_SIZE], fresh[OUT_SIZE], back[OUT_SIZE];
+    int fail = 0;
+
+    for (codec_type_t type = 0; type < CODEC_MAX; type++) {
+        codec_pool_t *pool, *dpool;
+        int bad = 0;
+
+        if (codec_pool_create(type, CODEC_COMPRESS, NULL, 0, 1, &pool) != ESP_OK) {
+            return 1;
+        }
+        if (codec_pool_create(type, CODEC_DECOMPRESS, NULL, 0, 1, &dpool) != ESP_OK) {
+            codec_pool_destroy(pool);
+            return 1;
+        }
+        for (int m = 0; m < CHECK_MESSAGES; m++) {
+            codec_t *pc, *fc, *dc;
+            size_t len = (m * 131) % (MSG_MAX - 50) + 50, back_len = OUT_SIZE;
+            const uint8_t *in = message(m, len);
+
+            codec_pool_get(pool, &pc);
+            size_t pooled_len = compress_msg(pc, in, len, pooled);
+            codec_pool_put(pool, pc);
+            if (codec_create(type, CODEC_COMPRESS, NULL, 0, &fc) != ESP_OK) {
+                bad++;
+                continue;
+            }
+            size_t fresh_len = compress_msg(fc, in, len, fresh);
+            codec_destroy(fc);
+            if (pooled_len == 0 || pooled_len != fresh_len || memcmp(pooled, fresh, pooled_len) != 0) {
+                bad++;
+            }
+
+            codec_pool_get(dpool, &dc);
+            esp_err_t ret = codec_buf(dc, pooled, pooled_len, back, &back_len);
+            codec_pool_put(dpool, dc);
+            if (ret != ESP_OK || back_len != len || memcmp(back, in, len) != 0) {
+                bad++;
+            }
+        }
+        printf("%-7s pooled output identical to a fresh codec, pooled decode: %s\n", codec_name(type), bad ? "FAILED" : "ok");
+        fail |= bad != 0;
+        codec_pool_destroy(pool);
+        codec_pool_destroy(dpool);
+    }
+    return fail;
+}
+
+typedef struct {
+    double msgs_per_s;
+    double mallocs;
+} msg_rate_t;
+
+// count messages of len bytes through per message codecs (create[0]) and a pool (create[1])
+static int run(codec_type_t type, const codec_params_t *params, size_t len, int count, msg_rate_t rate[2])
+{
+    static uint8_t out[OUT_SIZE];
+    codec_pool_t *pool;
+    codec_t *codec;
+    int fail = 0;
+
+    long mallocs = s_mallocs;
+    int64_t start = esp_timer_get_time();
+    for (int m = 0; m < count; m++) {
+        if (codec_create(type, CODEC_COMPRESS, params, 0, &codec) != ESP_OK) {
+            return 1;
+        }
+        fail |= compress_msg(codec, message(m, len), len, out) == 0;
+        codec_destroy(codec);
+    }
+    rate[0].msgs_per_s = count * 1e6 / (esp_timer_get_time() - start);
+    rate[0].mallocs = (double)(s_mallocs - mallocs) / count;
+
+    if (codec_pool_create(type, CODEC_COMPRESS, params, 0, 1, &pool) != ESP_OK) {
+        return 1;
+    }
+    mallocs = s_mallocs;
+    start = esp_timer_get_time();
+    for (int m = 0; m < count; m++) {
+        codec_pool_get(pool, &codec);
+        fail |= compress_msg(codec, message(m, len), len, out) == 0;
+        codec_pool_put(pool, codec);
+    }
+    rate[1].msgs_per_s = count * 1e6 / (esp_timer_get_time() - start);
+    rate[1].mallocs = (double)(s_mallocs - mallocs) / count;
+    codec_pool_destroy(pool);
+    return fail;
+}
+
+int main(void)
+{
+    const size_t gzip_sizes[] = { 100, 500, 1024, 4096 };
+    const size_t brotli_sizes[] = { 100, 1024, 4096 };
+    const int brotli_quality[] = { 1, 5, 9 };
+    codec_params_t params;
+    msg_rate_t rate[4][2];
+    int fail = 0;
+
+    bool ok = append_file(BINARY_PATH);
+    for (int i = 0; ok && i < TEXT_COPIES; i++) {
+        ok = append_file(TEXT_PATH);
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    fail |= check_identical();
+
+    codec_default_params(CODEC_GZIP, &params);
+    params.window_bits = 15;
+    params.mem_level = 8;
+    for (int s = 0; s < 4; s++) {
+        fail |= run(CODEC_GZIP, &params, gzip_sizes[s], 20000 / (s + 1), rate[s]);
+    }
+    printf("\n| Messages/s, gzip, window 15, memLevel 8 (host) | 100 B | 500 B | 1K | 4K |\n| --- | --- | --- | --- | --- |\n");
+    printf("| `codec_create` / `codec_destroy` per message |");
+    for (int s = 0; s < 4; s++) {
+        printf(" %.0f |", rate[s][0].msgs_per_s);
+    }
+    printf("\n| Pool |");
+    for (int s = 0; s < 4; s++) {
+        printf(" %.0f |", rate[s][1].msgs_per_s);
+    }
+
+    printf("\n\n| Brotli, window 18 (host), create -> pool | 100 B | 1K | 4K |\n| --- | --- | --- | --- |\n");
+    for (int q = 0; q < 3; q++) {
+        codec_default_params(CODEC_BROTLI, &params);
+        params.level = brotli_quality[q];
+        params.window_bits = 18;
+        for (int s = 0; s < 3; s++) {
+            fail |= run(CODEC_BROTLI, &params, brotli_sizes[s], brotli_quality[q] == 9 ? 300 : 3000, rate[s]);
+        }
+        if (brotli_quality[q] == 9) {
+            printf("| Quality %d, messages/s |", brotli_quality[q]);
+            for (int s = 0; s < 3; s++) {
+                printf(" %.0f -> %.0f |", rate[s][0].msgs_per_s, rate[s][1].msgs_per_s);
+            }
+        } else {
+            printf("| Quality %d, mallocs per message |", brotli_quality[q]);
+            for (int s = 0; s < 3; s++) {
+                printf(" %.1f -> %.1f |", rate[s][0].mallocs, rate[s][1].mallocs);
+            }
+        }
+        printf("\n");
+    }
+    if (fail) {
+        printf("compression FAILED\n");
+    }
+    return fail;
+}
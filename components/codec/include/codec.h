@@ -0,0 +1,146 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#include "filter.h"
+
+/*
+    Common streaming interface over the compression components.
+    Input is pushed into a small staging buffer and compressed output is pulled,
+    so call sites do not change when the codec is picked at runtime.
+*/
+
+typedef enum {
+    CODEC_DEFLATE,      // zlib format (RFC 1950)
+    CODEC_GZIP,         // gzip format (RFC 1952), extractable on host platforms
+    CODEC_BROTLI,
+    CODEC_FASTLZ,       // fastlz_utils framing
+    CODEC_LZSS,
+    CODEC_MAX,
+} codec_type_t;
+
+typedef enum {
+    CODEC_COMPRESS,
+    CODEC_DECOMPRESS,
+} codec_mode_t;
+
+typedef struct {
+    int level;          // deflate 0-9 / Brotli quality 0-11
+    int window_bits;    // deflate 8-15 / Brotli 10-24
+    int mem_level;      // deflate 1-9
+    int strategy;       // deflate Z_DEFAULT_STRATEGY, Z_FILTERED, ...
+    filter_params_t filter; // Applied before compression / after decompression, FILTER_NONE by default
+} codec_params_t;
+
+typedef struct {
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    int64_t time_us;        // Time spent inside the codec
+    size_t mem_current;     // Heap held by the codec
+    size_t mem_peak;
+    uint32_t flushes;
+    uint32_t auto_flushes;  // Of which issued by the auto flush limits
+    int64_t max_flush_latency_us;   // Longest a pushed byte waited for the flush that emitted it
+    unsigned probe_ratio;   // Predicted ratio (percent) of the first staged block, 0 if not probed
+    bool stored;            // Compression skipped: the probe found the input incompressible
+    bool degraded;          // Switched to the lightest configuration under memory pressure
+} codec_stats_t;
+
+typedef struct codec codec_t;
+
+// Kconfig defaults (zlib_utils settings for deflate/gzip)
+void codec_default_params(codec_type_t type, codec_params_t *params);
+
+// Estimated heap use of a codec instance, staging buffer included
+size_t codec_mem_estimate(codec_type_t type, codec_mode_t mode, const codec_params_t *params);
+
+/*
+    Create a codec; params may be NULL for defaults.
+    With a non-zero mem_budget, compression parameters are scaled down until the estimate fits
+    and allocations beyond the budget fail. Returns ESP_ERR_NO_MEM if nothing fits.
+    Compressors probe the first full staging buffer and drop to the fastest level, or store
+    raw data in the codec's own format, when little or nothing would be gained. The sample is
+    CONFIG_CODEC_BUFFER_SIZE bytes (1K by default), not the 4K deflate_file() probes, and the
+    verdict holds for the rest of the stream.
+*/
+esp_err_t codec_create(codec_type_t type, codec_mode_t mode, const codec_params_t *params,
+                       size_t mem_budget, codec_t **out);
+
+// Stage input; *consumed is less than len when the staging buffer is full, pull to drain it
+esp_err_t codec_push(codec_t *codec, const uint8_t *in, size_t len, size_t *consumed);
+
+// Run the codec on staged input; *produced == len means more output may be pending
+esp_err_t codec_pull(codec_t *codec, uint8_t *out, size_t len, size_t *produced);
+
+/*
+    Make all pushed input decodable by the receiver; completes over the following pulls.
+    ESP_ERR_NOT_SUPPORTED with a SHUFFLE or BITSHUFFLE filter, which only work on whole blocks.
+*/
+esp_err_t codec_flush(codec_t *codec);
+
+// Return true while memory is short
+typedef bool (*codec_low_mem_cb_t)(void *arg);
+
+/*
+    Memory pressure handling for compressors. Once free heap drops below low_water bytes (0: not
+    checked) or cb returns true, the stream ends its current block and carries on in the lightest
+    configuration, freeing most of its memory: deflate/gzip restart with memLevel 1 and a 512 byte
+    window, Brotli continues with uncompressed meta-blocks. The output stays one valid stream.
+    Checked before every pull, acted on once. ESP_ERR_NOT_SUPPORTED for FastLZ and LZSS.
+*/
+esp_err_t codec_set_low_memory(codec_t *codec, size_t low_water, codec_low_mem_cb_t cb, void *arg);
+
+/*
+    Flush automatically for live streams: a pull issues a sync flush once max_bytes of input have
+    been pushed since the last flush, or the oldest of them is max_age_us old (0 disables either).
+    Flushes cost ratio, so none is made before a limit is reached. The age is only checked on pulls:
+    keep pulling at the granularity the deadline needs even when there is nothing to push.
+    ESP_ERR_NOT_SUPPORTED where codec_flush() is.
+*/
+esp_err_t codec_set_auto_flush(codec_t *codec, size_t max_bytes, uint32_t max_age_us);
+
+// Signal end of input; pull until codec_is_done()
+esp_err_t codec_finish(codec_t *codec);
+
+bool codec_is_done(const codec_t *codec);
+
+void codec_get_stats(const codec_t *codec, codec_stats_t *stats);
+
+// Effective parameters after budget scaling
+void codec_get_params(const codec_t *codec, codec_params_t *params);
+
+codec_type_t codec_get_type(const codec_t *codec);
+
+const char *codec_name(codec_type_t type);
+
+void codec_destroy(codec_t *codec);
+
+/*
+    Ready the codec for a new stream with the parameters it was created with, keeping its
+    allocations where the codec allows (deflate, inflate). Stats restart, except for heap use.
+    On failure the codec can only be destroyed.
+*/
+esp_err_t codec_reset(codec_t *codec);
+
+// Run a whole file / buffer through a freshly created codec
+esp_err_t codec_file(codec_t *codec, FILE *source, FILE *dest);
+
+esp_err_t codec_buf(codec_t *codec, const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len);
+
+/*
+    codec_file() in slices, for tasks that cannot block for a whole file: every codec_step()
+    call reads at most max_in bytes of source or runs for about max_us (0: no limit), then
+    returns with *more set while the file is not done. source and dest must stay open in between.
+*/
+typedef struct codec_step codec_step_t;
+
+esp_err_t codec_step_begin(codec_t *codec, FILE *source, FILE *dest, codec_step_t **out);
+
+esp_err_t codec_step(codec_step_t *step, size_t max_in, uint32_t max_us, bool *more);
+
+void codec_step_end(codec_step_t *step);
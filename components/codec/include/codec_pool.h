@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "codec.h"
+
+/*
+    Pool of identical codecs for many short streams (messages). Codecs are created up front and
+    reset when they come back, so taking one costs no allocation or codec init. Thread safe.
+*/
+
+typedef struct codec_pool codec_pool_t;
+
+// count codecs as codec_create(type, mode, params, mem_budget) would make them
+esp_err_t codec_pool_create(codec_type_t type, codec_mode_t mode, const codec_params_t *params,
+                            size_t mem_budget, size_t count, codec_pool_t **out);
+
+// A codec ready for a new stream; ESP_ERR_NOT_FOUND when all are taken
+esp_err_t codec_pool_get(codec_pool_t *pool, codec_t **out);
+
+// Give a codec back, finished or not; it is reset before the next get
+void codec_pool_put(codec_pool_t *pool, codec_t *codec);
+
+// All codecs must have been put back
+void codec_pool_destroy(codec_pool_t *pool);
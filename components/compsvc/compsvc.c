@@ -0,0 +1,278 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "esp_timer.h"
+#include "compsvc.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_pthread.h"
+#endif
+
+#define FILE_BUFFERS (2 * CONFIG_CODEC_BUFFER_SIZE)     // codec_file() in and out buffers
+
+static const char *TAG = "compsvc";
+
+typedef struct {
+    compsvc_job_t job;
+    codec_params_t params;
+    bool has_params;
+    bool used;
+    uint32_t id;
+    size_t reserve;             // Budget taken while the job runs
+    int64_t submitted_us;
+} compsvc_slot_t;
+
+struct compsvc {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    pthread_t *workers;
+    int n_workers;
+    bool stopping;
+    size_t mem_budget;
+    uint32_t next_id;
+    compsvc_slot_t slots[COMPSVC_QUEUE_SIZE];
+    compsvc_stats_t stats;
+};
+
+// Highest priority, oldest first; NULL if nothing is queued
+static compsvc_slot_t *compsvc_next(compsvc_t *svc)
+{
+    compsvc_slot_t *best = NULL;
+
+    for (int i = 0; i < COMPSVC_QUEUE_SIZE; i++) {
+        compsvc_slot_t *s = &svc->slots[i];
+        if (!s->used) {
+            continue;
+        }
+        if (best == NULL || s->job.priority > best->job.priority ||
+            (s->job.priority == best->job.priority && (int32_t)(s->id - best->id) < 0)) {
+            best = s;
+        }
+    }
+    return best;
+}
+
+static void compsvc_run(compsvc_t *svc, compsvc_slot_t *slot)
+{
+    codec_t *codec = NULL;
+    codec_stats_t stats = { 0 };
+    const codec_params_t *params = slot->has_params ? &slot->params : NULL;
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = codec_create(slot->job.type, slot->job.mode, params, slot->reserve - FILE_BUFFERS, &codec);
+    if (ret == ESP_OK) {
+        ret = codec_file(codec, slot->job.source, slot->job.dest);
+        codec_get_stats(codec, &stats);
+        codec_destroy(codec);
+    }
+    int64_t end = esp_timer_get_time();
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Job %u (%s) failed: %s", (unsigned)slot->id, codec_name(slot->job.type), esp_err_to_name(ret));
+    }
+    // Still counted as running, so compsvc_wait_idle() returns after the callback
+    if (slot->job.done != NULL) {
+        slot->job.done(slot->id, ret, &stats, slot->job.arg);
+    }
+
+    pthread_mutex_lock(&svc->lock);
+    svc->stats.running--;
+    svc->stats.mem_reserved -= slot->reserve;
+    svc->stats.run_us += end - start;
+    svc->stats.bytes_in += stats.bytes_in;
+    svc->stats.bytes_out += stats.bytes_out;
+    if (ret == ESP_OK) {
+        svc->stats.completed++;
+    } else {
+        svc->stats.failed++;
+    }
+    pthread_cond_broadcast(&svc->cond);
+    pthread_mutex_unlock(&svc->lock);
+}
+
+static void *compsvc_worker(void *arg)
+{
+    compsvc_t *svc = (compsvc_t *)arg;
+    compsvc_slot_t slot;
+
+    pthread_mutex_lock(&svc->lock);
+    for (;;) {
+        compsvc_slot_t *next = compsvc_next(svc);
+        if (next == NULL && svc->stopping) {
+            break;
+        }
+        // The head of the queue waits for memory, nothing overtakes it
+        if (next == NULL || svc->stats.mem_reserved + next->reserve > svc->mem_budget) {
+            pthread_cond_wait(&svc->cond, &svc->lock);
+            continue;
+        }
+
+        slot = *next;
+        next->used = false;
+
+        int64_t waited = esp_timer_get_time() - slot.submitted_us;
+        svc->stats.queued--;
+        svc->stats.running++;
+        svc->stats.queue_us += waited;
+        if (waited > svc->stats.max_queue_us) {
+            svc->stats.max_queue_us = waited;
+        }
+        svc->stats.mem_reserved += slot.reserve;
+        if (svc->stats.mem_reserved > svc->stats.max_mem_reserved) {
+            svc->stats.max_mem_reserved = svc->stats.mem_reserved;
+        }
+        pthread_cond_broadcast(&svc->cond);
+        pthread_mutex_unlock(&svc->lock);
+
+        compsvc_run(svc, &slot);
+
+        pthread_mutex_lock(&svc->lock);
+    }
+    pthread_mutex_unlock(&svc->lock);
+    return NULL;
+}
+
+esp_err_t compsvc_create(int workers, size_t mem_budget, compsvc_t **out)
+{
+    if (workers < 1 || mem_budget <= FILE_BUFFERS || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    compsvc_t *svc = (compsvc_t *)calloc(1, sizeof(compsvc_t));
+    if (svc == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    svc->workers = (pthread_t *)calloc(workers, sizeof(pthread_t));
+    if (svc->workers == NULL) {
+        free(svc);
+        return ESP_ERR_NO_MEM;
+    }
+    svc->mem_budget = mem_budget;
+    pthread_mutex_init(&svc->lock, NULL);
+    pthread_cond_init(&svc->cond, NULL);
+
+#ifdef ESP_PLATFORM
+    esp_pthread_cfg_t prev;
+    bool restore = esp_pthread_get_cfg(&prev) == ESP_OK;
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+    cfg.stack_size = CONFIG_COMPSVC_STACK_SIZE;
+    esp_pthread_set_cfg(&cfg);
+#endif
+    for (; svc->n_workers < workers; svc->n_workers++) {
+        if (pthread_create(&svc->workers[svc->n_workers], NULL, compsvc_worker, svc) != 0) {
+            break;
+        }
+    }
+#ifdef ESP_PLATFORM
+    if (!restore) {
+        prev = esp_pthread_get_default_config();
+    }
+    esp_pthread_set_cfg(&prev);
+#endif
+
+    if (svc->n_workers == 0) {
+        compsvc_destroy(svc);
+        return ESP_ERR_NO_MEM;
+    }
+    if (svc->n_workers < workers) {
+        ESP_LOGW(TAG, "Started %d of %d workers", svc->n_workers, workers);
+    }
+
+    *out = svc;
+    return ESP_OK;
+}
+
+esp_err_t compsvc_submit(compsvc_t *svc, const compsvc_job_t *job, uint32_t *id)
+{
+    if (svc == NULL || job == NULL || job->source == NULL || job->dest == NULL || job->type >= CODEC_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // Compressors shrink to whatever the budget allows, decompressors need what the stream needs
+    size_t reserve = codec_mem_estimate(job->type, job->mode, job->params) + FILE_BUFFERS;
+    if (reserve > svc->mem_budget) {
+        if (job->mode == CODEC_DECOMPRESS) {
+            ESP_LOGE(TAG, "%s decompression needs ~%u bytes, budget is %u", codec_name(job->type),
+                     (unsigned)reserve, (unsigned)svc->mem_budget);
+            return ESP_ERR_NO_MEM;
+        }
+        reserve = svc->mem_budget;
+    }
+
+    pthread_mutex_lock(&svc->lock);
+
+    compsvc_slot_t *slot = NULL;
+    for (int i = 0; i < COMPSVC_QUEUE_SIZE && slot == NULL; i++) {
+        if (!svc->slots[i].used) {
+            slot = &svc->slots[i];
+        }
+    }
+    if (slot == NULL || svc->stopping) {
+        pthread_mutex_unlock(&svc->lock);
+        return slot == NULL ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_STATE;
+    }
+
+    memset(slot, 0, sizeof(compsvc_slot_t));
+    slot->job = *job;
+    if (job->params != NULL) {
+        slot->params = *job->params;
+        slot->has_params = true;
+    }
+    slot->job.params = NULL;
+    slot->used = true;
+    slot->id = svc->next_id++;
+    slot->reserve = reserve;
+    slot->submitted_us = esp_timer_get_time();
+
+    svc->stats.submitted++;
+    svc->stats.queued++;
+    if (svc->stats.queued > svc->stats.max_queued) {
+        svc->stats.max_queued = svc->stats.queued;
+    }
+    if (id != NULL) {
+        *id = slot->id;
+    }
+
+    pthread_cond_broadcast(&svc->cond);
+    pthread_mutex_unlock(&svc->lock);
+    return ESP_OK;
+}
+
+void compsvc_wait_idle(compsvc_t *svc)
+{
+    pthread_mutex_lock(&svc->lock);
+    while (svc->stats.queued > 0 || svc->stats.running > 0) {
+        pthread_cond_wait(&svc->cond, &svc->lock);
+    }
+    pthread_mutex_unlock(&svc->lock);
+}
+
+void compsvc_get_stats(compsvc_t *svc, compsvc_stats_t *stats)
+{
+    pthread_mutex_lock(&svc->lock);
+    *stats = svc->stats;
+    pthread_mutex_unlock(&svc->lock);
+}
+
+void compsvc_destroy(compsvc_t *svc)
+{
+    if (svc == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&svc->lock);
+    svc->stopping = true;
+    pthread_cond_broadcast(&svc->cond);
+    pthread_mutex_unlock(&svc->lock);
+
+    for (int i = 0; i < svc->n_workers; i++) {
+        pthread_join(svc->workers[i], NULL);
+    }
+
+    pthread_mutex_destroy(&svc->lock);
+    pthread_cond_destroy(&svc->cond);
+    free(svc->workers);
+    free(svc);
+}
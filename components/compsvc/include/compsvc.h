@@ -0,0 +1,73 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "codec.h"
+
+/*
+    Compression service: tasks submit file jobs instead of running codecs themselves, and a
+    fixed pool of workers runs them one codec_file() each. Every job reserves its estimated
+    heap (codec_mem_estimate() plus the file buffers) from one budget before it starts and
+    its codec is created with that reservation as its own budget, so jobs together never go
+    over it. Compression jobs larger than the budget are scaled down (smaller window / memory
+    level) to fit.
+
+    Jobs start by priority, then in submission order. A job that does not fit yet holds back
+    the ones behind it, so large jobs are not starved by a stream of small ones.
+*/
+
+#define COMPSVC_QUEUE_SIZE (CONFIG_COMPSVC_QUEUE_SIZE)
+
+typedef struct compsvc compsvc_t;
+
+// Called on the worker once a job has run; source and dest are left open
+typedef void (*compsvc_done_cb_t)(uint32_t id, esp_err_t result, const codec_stats_t *stats, void *arg);
+
+typedef struct {
+    FILE *source;
+    FILE *dest;
+    codec_type_t type;
+    codec_mode_t mode;
+    const codec_params_t *params;   // NULL for defaults; copied on submit
+    int priority;                   // Higher starts first
+    compsvc_done_cb_t done;         // May be NULL
+    void *arg;
+} compsvc_job_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t completed;
+    uint32_t failed;
+    uint32_t queued;                // Waiting now
+    uint32_t running;
+    uint32_t max_queued;
+    int64_t queue_us;               // Total and worst time from submit to start
+    int64_t max_queue_us;
+    int64_t run_us;                 // Total time jobs spent running
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    size_t mem_reserved;            // Budget held by running jobs now, and at most
+    size_t max_mem_reserved;
+} compsvc_stats_t;
+
+esp_err_t compsvc_create(int workers, size_t mem_budget, compsvc_t **out);
+
+/*
+    Queue a job; *id (optional) identifies it in the callback.
+    ESP_ERR_NO_MEM when the queue is full, or for a decompression job whose codec cannot fit the budget.
+*/
+esp_err_t compsvc_submit(compsvc_t *svc, const compsvc_job_t *job, uint32_t *id);
+
+// Block until no job is queued or running
+void compsvc_wait_idle(compsvc_t *svc);
+
+void compsvc_get_stats(compsvc_t *svc, compsvc_stats_t *stats);
+
+// Run what is queued, then stop the workers and free the service
+void compsvc_destroy(compsvc_t *svc);
@@ -0,0 +1,407 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+
+#if CONFIG_CRING_CODEC_DEFLATE
+#include "zlib.h"
+#else
+#include "fastlz.h"
+#endif
+
+#include "cring.h"
+
+#if CONFIG_CRING_CODEC_DEFLATE
+// Tiny raw deflate stream: 512 byte window (zlib rejects 256), smallest hash and pending buffers
+#define DEFLATE_WINDOW_BITS (9)
+#define DEFLATE_MEM_LEVEL (1)
+#define SCRATCH_SIZE (CRING_PAGE_SIZE)
+#else
+#define SCRATCH_SIZE (FASTLZ_BOUND(CRING_PAGE_SIZE))
+#endif
+
+// Page table entries per arena byte: enough for pages compressed down to 1/16
+#define MAX_RATIO (16)
+
+static const char *TAG = "cring";
+
+typedef struct {
+    uint32_t off;               // Arena offset
+    uint16_t len;               // Stored bytes
+    uint16_t raw;               // Stored uncompressed
+} cring_page_t;
+
+typedef struct {
+    uint32_t no;                // Page number
+    uint32_t used;              // LRU clock
+    bool valid;
+    uint8_t *data;
+} cring_slot_t;
+
+struct cring {
+    uint8_t *arena;
+    size_t capacity;
+    cring_page_t *pages;        // Circular, oldest first
+    size_t max_pages;
+    size_t first;
+    size_t count;
+    uint32_t next_no;           // Number of the open page; page n holds bytes [n * page size, (n + 1) * page size)
+    uint8_t *open;
+    size_t open_len;
+    uint64_t read_pos;          // Oldest readable byte
+    uint8_t *scratch;
+    uint32_t clock;
+    cring_slot_t cache[CRING_CACHE_PAGES];
+#if CONFIG_CRING_CODEC_DEFLATE
+    z_stream def;
+    z_stream inf;
+#else
+    uint16_t *htab;
+#endif
+    cring_stats_t stats;
+};
+
+static inline cring_page_t *page_at(cring_t *ring, size_t i)
+{
+    return &ring->pages[(ring->first + i) % ring->max_pages];
+}
+
+static inline uint64_t written(const cring_t *ring)
+{
+    return (uint64_t)ring->next_no * CRING_PAGE_SIZE + ring->open_len;
+}
+
+// Size of the compressed page in scratch, 0 if it does not compress
+static size_t compress_page(cring_t *ring)
+{
+#if CONFIG_CRING_CODEC_DEFLATE
+    deflateReset(&ring->def);
+    ring->def.next_in = ring->open;
+    ring->def.avail_in = CRING_PAGE_SIZE;
+    ring->def.next_out = ring->scratch;
+    ring->def.avail_out = CRING_PAGE_SIZE - 1;
+    return deflate(&ring->def, Z_FINISH) == Z_STREAM_END ? ring->def.total_out : 0;
+#else
+    size_t n = fastlz_compress(ring->open, CRING_PAGE_SIZE, ring->scratch, ring->htab);
+    return n < CRING_PAGE_SIZE ? n : 0;
+#endif
+}
+
+static esp_err_t decompress_page(cring_t *ring, const cring_page_t *page, uint8_t *out)
+{
+#if CONFIG_CRING_CODEC_DEFLATE
+    inflateReset(&ring->inf);
+    ring->inf.next_in = ring->arena + page->off;
+    ring->inf.avail_in = page->len;
+    ring->inf.next_out = out;
+    ring->inf.avail_out = CRING_PAGE_SIZE;
+    return inflate(&ring->inf, Z_FINISH) == Z_STREAM_END && ring->inf.avail_out == 0 ? ESP_OK : ESP_ERR_INVALID_CRC;
+#else
+    return fastlz_decompress(ring->arena + page->off, page->len, out, CRING_PAGE_SIZE) == CRING_PAGE_SIZE ?
+           ESP_OK : ESP_ERR_INVALID_CRC;
+#endif
+}
+
+// Drop the oldest page to make room, whether it was read or not
+static void drop_oldest(cring_t *ring)
+{
+    ring->first = (ring->first + 1) % ring->max_pages;
+    ring->count--;
+    ring->stats.dropped_pages++;
+
+    uint64_t start = (uint64_t)(ring->next_no - ring->count) * CRING_PAGE_SIZE;
+    if (ring->read_pos < start) {
+        ring->read_pos = start;
+    }
+}
+
+// Arena offset for len bytes after the newest page, dropping old pages until they fit
+static size_t alloc(cring_t *ring, size_t len)
+{
+    for (;;) {
+        if (ring->count == ring->max_pages) {
+            drop_oldest(ring);
+            continue;
+        }
+        if (ring->count == 0) {
+            return 0;
+        }
+
+        const cring_page_t *last = page_at(ring, ring->count - 1);
+        size_t head = page_at(ring, 0)->off;
+        size_t tail = last->off + last->len;
+
+        if (tail > head) {
+            if (ring->capacity - tail >= len) {
+                return tail;
+            }
+            if (head >= len) {
+                return 0;
+            }
+        } else if (head - tail >= len) {
+            return tail;
+        }
+        drop_oldest(ring);
+    }
+}
+
+static void store_page(cring_t *ring)
+{
+    // Already consumed while it was being filled
+    if (ring->read_pos >= written(ring)) {
+        ring->next_no++;
+        ring->open_len = 0;
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    size_t len = compress_page(ring);
+    int64_t elapsed = esp_timer_get_time() - start;
+
+    ring->stats.compress_us += elapsed;
+    if (elapsed > ring->stats.max_compress_us) {
+        ring->stats.max_compress_us = elapsed;
+    }
+
+    const uint8_t *src = len ? ring->scratch : ring->open;
+    if (len == 0) {
+        len = CRING_PAGE_SIZE;
+    }
+
+    size_t off = alloc(ring, len);
+    memcpy(ring->arena + off, src, len);
+
+    cring_page_t *page = page_at(ring, ring->count++);
+    page->off = off;
+    page->len = len;
+    page->raw = src == ring->open;
+
+    ring->next_no++;
+    ring->open_len = 0;
+}
+
+esp_err_t cring_create(size_t capacity, cring_t **out)
+{
+    if (capacity < CRING_PAGE_SIZE || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    cring_t *ring = (cring_t *)calloc(1, sizeof(cring_t));
+    if (ring == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ring->capacity = capacity;
+    ring->max_pages = capacity * MAX_RATIO / CRING_PAGE_SIZE;
+    ring->arena = (uint8_t *)malloc(capacity);
+    ring->pages = (cring_page_t *)malloc(ring->max_pages * sizeof(cring_page_t));
+    ring->open = (uint8_t *)malloc(CRING_PAGE_SIZE);
+    ring->scratch = (uint8_t *)malloc(SCRATCH_SIZE);
+    if (ring->arena == NULL || ring->pages == NULL || ring->open == NULL || ring->scratch == NULL) {
+        goto FAIL;
+    }
+
+    for (int i = 0; i < CRING_CACHE_PAGES; i++) {
+        ring->cache[i].data = (uint8_t *)malloc(CRING_PAGE_SIZE);
+        if (ring->cache[i].data == NULL) {
+            goto FAIL;
+        }
+    }
+
+#if CONFIG_CRING_CODEC_DEFLATE
+    if (deflateInit2(&ring->def, Z_BEST_SPEED, Z_DEFLATED, -DEFLATE_WINDOW_BITS, DEFLATE_MEM_LEVEL,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+        goto FAIL;
+    }
+    if (inflateInit2(&ring->inf, -DEFLATE_WINDOW_BITS) != Z_OK) {
+        (void)deflateEnd(&ring->def);
+        goto FAIL;
+    }
+#else
+    ring->htab = (uint16_t *)malloc(FASTLZ_HASH_SIZE * sizeof(uint16_t));
+    if (ring->htab == NULL) {
+        goto FAIL;
+    }
+#endif
+
+    ESP_LOGI(TAG, "%d byte arena, %d byte pages", capacity, CRING_PAGE_SIZE);
+    *out = ring;
+    return ESP_OK;
+
+FAIL:
+    for (int i = 0; i < CRING_CACHE_PAGES; i++) {
+        free(ring->cache[i].data);
+    }
+#if !CONFIG_CRING_CODEC_DEFLATE
+    free(ring->htab);
+#endif
+    free(ring->arena);
+    free(ring->pages);
+    free(ring->open);
+    free(ring->scratch);
+    free(ring);
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t cring_write(cring_t *ring, const void *data, size_t len)
+{
+    const uint8_t *p = (const uint8_t *)data;
+
+    if (ring == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (len > 0) {
+        size_t n = CRING_PAGE_SIZE - ring->open_len < len ? CRING_PAGE_SIZE - ring->open_len : len;
+        memcpy(ring->open + ring->open_len, p, n);
+        ring->open_len += n;
+        p += n;
+        len -= n;
+
+        if (ring->open_len == CRING_PAGE_SIZE) {
+            store_page(ring);
+        }
+    }
+    return ESP_OK;
+}
+
+size_t cring_size(const cring_t *ring)
+{
+    return written(ring) - ring->read_pos;
+}
+
+// Decompressed contents of page i of the table, through the cache
+static esp_err_t get_page(cring_t *ring, size_t i, const uint8_t **data)
+{
+    const cring_page_t *page = page_at(ring, i);
+    uint32_t no = ring->next_no - ring->count + i;
+    cring_slot_t *slot = &ring->cache[0];
+
+    if (page->raw) {
+        *data = ring->arena + page->off;
+        return ESP_OK;
+    }
+
+    for (int s = 0; s < CRING_CACHE_PAGES; s++) {
+        if (ring->cache[s].valid && ring->cache[s].no == no) {
+            ring->cache[s].used = ++ring->clock;
+            ring->stats.cache_hits++;
+            *data = ring->cache[s].data;
+            return ESP_OK;
+        }
+        if (!ring->cache[s].valid || (slot->valid && ring->cache[s].used < slot->used)) {
+            slot = &ring->cache[s];
+        }
+    }
+
+    ring->stats.cache_misses++;
+    slot->valid = false;
+    esp_err_t ret = decompress_page(ring, page, slot->data);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    slot->valid = true;
+    slot->no = no;
+    slot->used = ++ring->clock;
+    *data = slot->data;
+    return ESP_OK;
+}
+
+esp_err_t cring_read(cring_t *ring, size_t offset, void *out, size_t len, size_t *out_len)
+{
+    esp_err_t ret;
+    uint8_t *dst = (uint8_t *)out;
+    size_t done = 0;
+
+    if (ring == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out_len = 0;
+    if (offset >= cring_size(ring)) {
+        return ESP_OK;
+    }
+    if (len > cring_size(ring) - offset) {
+        len = cring_size(ring) - offset;
+    }
+
+    uint64_t pos = ring->read_pos + offset;
+    uint64_t open_start = (uint64_t)ring->next_no * CRING_PAGE_SIZE;
+    uint32_t first_no = ring->next_no - ring->count;
+
+    while (done < len) {
+        size_t in_page = pos % CRING_PAGE_SIZE;
+        size_t n = CRING_PAGE_SIZE - in_page < len - done ? CRING_PAGE_SIZE - in_page : len - done;
+        const uint8_t *data;
+
+        if (pos >= open_start) {
+            data = ring->open;
+        } else {
+            ret = get_page(ring, pos / CRING_PAGE_SIZE - first_no, &data);
+            if (ret != ESP_OK) {
+                *out_len = done;
+                return ret;
+            }
+        }
+
+        memcpy(dst + done, data + in_page, n);
+        done += n;
+        pos += n;
+    }
+
+    *out_len = done;
+    return ESP_OK;
+}
+
+esp_err_t cring_consume(cring_t *ring, size_t len)
+{
+    if (ring == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len > cring_size(ring)) {
+        len = cring_size(ring);
+    }
+    ring->read_pos += len;
+
+    // Free pages that are now entirely behind the read position
+    while (ring->count > 0 && (uint64_t)(ring->next_no - ring->count + 1) * CRING_PAGE_SIZE <= ring->read_pos) {
+        ring->first = (ring->first + 1) % ring->max_pages;
+        ring->count--;
+    }
+    return ESP_OK;
+}
+
+void cring_get_stats(const cring_t *ring, cring_stats_t *stats)
+{
+    *stats = ring->stats;
+    stats->pages = ring->count;
+    stats->raw_bytes = cring_size(ring);
+    stats->stored_bytes = 0;
+    for (size_t i = 0; i < ring->count; i++) {
+        stats->stored_bytes += ring->pages[(ring->first + i) % ring->max_pages].len;
+    }
+}
+
+void cring_destroy(cring_t *ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+#if CONFIG_CRING_CODEC_DEFLATE
+    (void)deflateEnd(&ring->def);
+    (void)inflateEnd(&ring->inf);
+#else
+    free(ring->htab);
+#endif
+    for (int i = 0; i < CRING_CACHE_PAGES; i++) {
+        free(ring->cache[i].data);
+    }
+    free(ring->arena);
+    free(ring->pages);
+    free(ring->open);
+    free(ring->scratch);
+    free(ring);
+}
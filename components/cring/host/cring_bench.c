@@ -0,0 +1,133 @@
+/*
+    Host benchmark for cring.h: fills a 32K arena with synthetic 12 byte samples at 100 Hz,
+    checks random and sequential reads against a copy of everything written, and prints the
+    ratio held in the arena and the page compression time (README table).
+
+    Traces:
+        environmental: slow temperature, humidity and pressure steps, rare one count flicker
+        accelerometer: sine waves with a few counts of noise on each axis
+*/
+
+// Build from the repository root (FastLZ pages; add -DCONFIG_CRING_CODEC_DEFLATE for deflate):
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/cring/include -I$C/fastlz/include -I$C/zlib/include -o cring_bench $C/cring/host/cring_bench.c $C/cring/cring.c $C/fastlz/*.c $C/zlib/src/*.c -lm
+//   ./cring_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "esp_timer.h"
+
+#include "cring.h"
+
+#define ARENA_SIZE (32 * 1024)
+#define SAMPLES (250000)
+#define READ_BUF (5000)
+
+typedef struct __attribute__((packed)) {
+    uint32_t ts;                // ms
+    int16_t a, b, c;
+    uint16_t temp;
+} sample_t;
+
+typedef enum {
+    TRACE_ENVIRONMENTAL,
+    TRACE_ACCELEROMETER,
+} trace_t;
+
+static const char *s_trace_names[] = { "environmental", "accelerometer" };
+
+static void make_sample(trace_t trace, uint32_t i, sample_t *s)
+{
+    s->ts = i * 10;
+    s->temp = (uint16_t)(2500 + (i / 1000) % 10);
+    if (trace == TRACE_ENVIRONMENTAL) {
+        s->a = (int16_t)(2150 + (i / 700) % 5);
+        s->b = (int16_t)(455 + (rand() % 50 == 0));
+        s->c = (int16_t)(10132 - (i / 5000) % 3);
+    } else {
+        s->a = (int16_t)(1000 * sin(i / 50.0) + rand() % 9 - 4);
+        s->b = (int16_t)(300 * cos(i / 80.0) + rand() % 5 - 2);
+        s->c = (int16_t)(16384 + rand() % 7 - 3);
+    }
+}
+
+static int run(trace_t trace)
+{
+    cring_t *ring;
+    cring_stats_t st;
+    size_t written = 0, got;
+    int bad = 0;
+    static uint8_t buf[READ_BUF];
+
+    uint8_t *ref = (uint8_t *)malloc(SAMPLES * sizeof(sample_t));
+    if (ref == NULL || cring_create(ARENA_SIZE, &ring) != ESP_OK) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    srand(5);
+    for (uint32_t i = 0; i < SAMPLES; i++) {
+        sample_t s;
+        make_sample(trace, i, &s);
+        if (cring_write(ring, &s, sizeof(s)) != ESP_OK) {
+            bad++;
+        }
+        memcpy(ref + written, &s, sizeof(s));
+        written += sizeof(s);
+
+        // Random reads of what is held, and now and then a consumer catching up
+        if (i % 20000 == 19999) {
+            size_t size = cring_size(ring);
+            size_t base = written - size;
+            for (int k = 0; k < 50; k++) {
+                size_t off = rand() % size, len = rand() % READ_BUF;
+                size_t expect = len < size - off ? len : size - off;
+                cring_read(ring, off, buf, len, &got);
+                if (got != expect || memcmp(buf, ref + base + off, got) != 0) {
+                    bad++;
+                }
+            }
+            if (i % 100000 == 99999) {
+                cring_consume(ring, size / 3);
+            }
+        }
+    }
+
+    size_t size = cring_size(ring);
+    size_t base = written - size;
+    uint8_t *all = (uint8_t *)malloc(size);
+    int64_t start = esp_timer_get_time();
+    for (size_t off = 0; off < size; off += 100) {
+        cring_read(ring, off, all + off, size - off < 100 ? size - off : 100, &got);
+    }
+    int64_t read_us = esp_timer_get_time() - start;
+    if (memcmp(all, ref + base, size) != 0) {
+        bad++;
+    }
+
+    cring_get_stats(ring, &st);
+    printf("%-13s %.2fx (%u K held), %.1f us/page (max %lld us), sequential read %lld us, cache %u/%u, %s\n",
+           s_trace_names[trace], (double)st.raw_bytes / ARENA_SIZE, (unsigned)(st.raw_bytes / 1024),
+           (double)st.compress_us / (st.pages + st.dropped_pages), (long long)st.max_compress_us,
+           (long long)read_us, st.cache_hits, st.cache_hits + st.cache_misses, bad ? "MISMATCH" : "reads ok");
+
+    free(all);
+    free(ref);
+    cring_destroy(ring);
+    return bad != 0;
+}
+
+int main(void)
+{
+#if CONFIG_CRING_CODEC_DEFLATE
+    printf("deflate pages, %d byte page, %d K arena\n", CRING_PAGE_SIZE, ARENA_SIZE / 1024);
+#else
+    printf("FastLZ pages, %d byte page, %d K arena\n", CRING_PAGE_SIZE, ARENA_SIZE / 1024);
+#endif
+    int fail = run(TRACE_ENVIRONMENTAL);
+    fail |= run(TRACE_ACCELEROMETER);
+    return fail;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Compressed ring buffer for capture data. Writes fill a raw page of CONFIG_CRING_PAGE_SIZE bytes;
+    full pages are compressed (FastLZ or tiny-window deflate) into a fixed arena, where the oldest
+    pages are dropped when a new one does not fit. Reads see everything still held, oldest byte
+    first, through a small LRU cache of decompressed pages.
+
+    Pages that do not compress are kept raw, so no page takes more arena than its raw size.
+*/
+
+#define CRING_PAGE_SIZE (CONFIG_CRING_PAGE_SIZE)
+#define CRING_CACHE_PAGES (CONFIG_CRING_CACHE_PAGES)
+
+typedef struct cring cring_t;
+
+typedef struct {
+    uint32_t pages;             // Compressed pages held
+    size_t raw_bytes;           // Readable bytes (cring_size())
+    size_t stored_bytes;        // Arena bytes used by them
+    uint32_t dropped_pages;     // Overwritten before being consumed
+    uint32_t cache_hits;
+    uint32_t cache_misses;
+    int64_t compress_us;        // Total and worst page compression time
+    int64_t max_compress_us;
+} cring_stats_t;
+
+// capacity is the arena size for compressed pages; the open page and the cache come on top
+esp_err_t cring_create(size_t capacity, cring_t **out);
+
+esp_err_t cring_write(cring_t *ring, const void *data, size_t len);
+
+// Readable bytes
+size_t cring_size(const cring_t *ring);
+
+// Read at an offset from the oldest readable byte; *out_len is short only at the end of the data
+esp_err_t cring_read(cring_t *ring, size_t offset, void *out, size_t len, size_t *out_len);
+
+// Discard the oldest len bytes (e.g. once uploaded)
+esp_err_t cring_consume(cring_t *ring, size_t len);
+
+void cring_get_stats(const cring_t *ring, cring_stats_t *stats);
+
+void cring_destroy(cring_t *ring);
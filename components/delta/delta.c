@@ -0,0 +1,353 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "zlib.h"
+#include "brotli/decode.h"
+
+#include "delta.h"
+
+static const char *TAG = "delta";
+
+struct delta {
+    delta_read_fn read_old;
+    void *old_ctx;
+    delta_write_fn write_new;
+    void *new_ctx;
+    BrotliDecoderState *dec;
+    uint8_t header[DELTA_HEADER_SIZE];
+    size_t header_len;
+    uint32_t old_size;
+    uint32_t old_crc;
+    uint32_t old_checked;               // Old image bytes in old_crc_run
+    uint32_t old_crc_run;
+    bool old_ok;                        // Old image CRC matched
+    uint32_t new_size;
+    uint32_t new_crc;
+    uint8_t record[DELTA_RECORD_SIZE];  // Record header being received
+    size_t record_len;
+    uint32_t add_left;
+    uint32_t copy_left;
+    int64_t add_pos;                    // Old image offset of the next added byte
+    int64_t old_pos;                    // Old image offset for the next record
+    uint32_t new_pos;
+    uint32_t crc;
+    bool finished;                      // Brotli stream complete
+    uint8_t buf[DELTA_BUFFER_SIZE];     // Decoded patch
+    uint8_t old[DELTA_BUFFER_SIZE];     // Old image bytes of an add run
+};
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+esp_err_t delta_begin(delta_read_fn read_old, void *old_ctx, delta_write_fn write_new, void *new_ctx,
+                      delta_t **out)
+{
+    if (read_old == NULL || write_new == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    delta_t *delta = (delta_t *)calloc(1, sizeof(delta_t));
+    if (delta == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    delta->dec = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+    if (delta->dec == NULL) {
+        free(delta);
+        return ESP_ERR_NO_MEM;
+    }
+
+    delta->read_old = read_old;
+    delta->old_ctx = old_ctx;
+    delta->write_new = write_new;
+    delta->new_ctx = new_ctx;
+    *out = delta;
+    return ESP_OK;
+}
+
+static esp_err_t parse_header(delta_t *delta)
+{
+    if (memcmp(delta->header, DELTA_MAGIC, DELTA_MAGIC_SIZE) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    delta->old_size = get_u32(delta->header + 4);
+    delta->old_crc = get_u32(delta->header + 8);
+    delta->new_size = get_u32(delta->header + 12);
+    delta->new_crc = get_u32(delta->header + 16);
+    return ESP_OK;
+}
+
+// CRC up to max_bytes more of the old image (0: the rest); rejects patches made against another image
+static esp_err_t check_old(delta_t *delta, size_t max_bytes)
+{
+    esp_err_t ret;
+    uint32_t end = delta->old_size;
+
+    if (max_bytes > 0 && max_bytes < end - delta->old_checked) {
+        end = delta->old_checked + max_bytes;
+    }
+
+    while (delta->old_checked < end) {
+        size_t n = end - delta->old_checked < DELTA_BUFFER_SIZE ? end - delta->old_checked : DELTA_BUFFER_SIZE;
+        ret = delta->read_old(delta->old_ctx, delta->old_checked, delta->old, n);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        delta->old_crc_run = crc32(delta->old_crc_run, delta->old, n);
+        delta->old_checked += n;
+    }
+    if (delta->old_checked < delta->old_size) {
+        return ESP_OK;
+    }
+
+    if (delta->old_crc_run != delta->old_crc) {
+        ESP_LOGE(TAG, "Patch was made for another image");
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    delta->old_ok = true;
+    ESP_LOGI(TAG, "Patching %u byte image into %u bytes", (unsigned)delta->old_size, (unsigned)delta->new_size);
+    return ESP_OK;
+}
+
+esp_err_t delta_verify(delta_t *delta, size_t max_bytes, bool *more)
+{
+    if (delta == NULL || more == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (delta->header_len < DELTA_HEADER_SIZE) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t ret = delta->old_ok ? ESP_OK : check_old(delta, max_bytes);
+    *more = ret == ESP_OK && !delta->old_ok;
+    return ret;
+}
+
+static esp_err_t emit(delta_t *delta, const uint8_t *data, size_t len)
+{
+    delta->crc = crc32(delta->crc, data, len);
+    delta->new_pos += len;
+    return delta->write_new(delta->new_ctx, data, len);
+}
+
+// Run decoded patch bytes through the record state machine
+static esp_err_t apply(delta_t *delta, const uint8_t *data, size_t len)
+{
+    esp_err_t ret;
+
+    while (len > 0) {
+        if (delta->add_left == 0 && delta->copy_left == 0) {
+            size_t n = DELTA_RECORD_SIZE - delta->record_len < len ? DELTA_RECORD_SIZE - delta->record_len : len;
+            memcpy(delta->record + delta->record_len, data, n);
+            delta->record_len += n;
+            data += n;
+            len -= n;
+            if (delta->record_len < DELTA_RECORD_SIZE) {
+                return ESP_OK;
+            }
+
+            delta->record_len = 0;
+            delta->add_left = get_u32(delta->record);
+            delta->copy_left = get_u32(delta->record + 4);
+            delta->add_pos = delta->old_pos;
+            delta->old_pos += (int64_t)delta->add_left + (int32_t)get_u32(delta->record + 8);
+
+            if ((uint64_t)delta->new_pos + delta->add_left + delta->copy_left > delta->new_size ||
+                    (delta->add_left > 0 && (delta->add_pos < 0 || delta->add_pos + delta->add_left > delta->old_size))) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            continue;
+        }
+
+        size_t n;
+        if (delta->add_left > 0) {
+            n = delta->add_left < len ? delta->add_left : len;
+            ret = delta->read_old(delta->old_ctx, delta->add_pos, delta->old, n);
+            if (ret != ESP_OK) {
+                return ret;
+            }
+            for (size_t i = 0; i < n; i++) {
+                delta->old[i] += data[i];
+            }
+            ret = emit(delta, delta->old, n);
+            delta->add_pos += n;
+            delta->add_left -= n;
+        } else {
+            n = delta->copy_left < len ? delta->copy_left : len;
+            ret = emit(delta, data, n);
+            delta->copy_left -= n;
+        }
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        data += n;
+        len -= n;
+    }
+    return ESP_OK;
+}
+
+esp_err_t delta_feed(delta_t *delta, const uint8_t *patch, size_t len)
+{
+    esp_err_t ret;
+
+    if (delta == NULL || (patch == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (delta->finished) {
+        return len == 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+    }
+
+    if (delta->header_len < DELTA_HEADER_SIZE) {
+        size_t n = DELTA_HEADER_SIZE - delta->header_len < len ? DELTA_HEADER_SIZE - delta->header_len : len;
+        memcpy(delta->header + delta->header_len, patch, n);
+        delta->header_len += n;
+        patch += n;
+        len -= n;
+        if (delta->header_len < DELTA_HEADER_SIZE) {
+            return ESP_OK;
+        }
+        ret = parse_header(delta);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    // Nothing is written before the old image is known to match
+    if (!delta->old_ok) {
+        if (len == 0) {
+            return ESP_OK;
+        }
+        ret = check_old(delta, 0);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    for (;;) {
+        uint8_t *next_out = delta->buf;
+        size_t avail_out = DELTA_BUFFER_SIZE;
+
+        BrotliDecoderResult res = BrotliDecoderDecompressStream(delta->dec, &len, &patch, &avail_out, &next_out, NULL);
+        if (res == BROTLI_DECODER_RESULT_ERROR) {
+            ESP_LOGE(TAG, "Corrupt patch (%s)", BrotliDecoderErrorString(BrotliDecoderGetErrorCode(delta->dec)));
+            return ESP_ERR_INVALID_CRC;
+        }
+
+        ret = apply(delta, delta->buf, DELTA_BUFFER_SIZE - avail_out);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+
+        if (res == BROTLI_DECODER_RESULT_SUCCESS) {
+            delta->finished = true;
+            return len == 0 ? ESP_OK : ESP_ERR_INVALID_SIZE;
+        }
+        if (res == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) {
+            return ESP_OK;
+        }
+    }
+}
+
+void delta_abort(delta_t *delta)
+{
+    if (delta == NULL) {
+        return;
+    }
+    BrotliDecoderDestroyInstance(delta->dec);
+    free(delta);
+}
+
+esp_err_t delta_end(delta_t *delta)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (delta == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!delta->finished || delta->new_pos != delta->new_size || delta->add_left || delta->copy_left) {
+        ESP_LOGE(TAG, "Patch truncated at %u of %u bytes", (unsigned)delta->new_pos, (unsigned)delta->new_size);
+        ret = ESP_ERR_INVALID_SIZE;
+    } else if (delta->crc != delta->new_crc) {
+        ESP_LOGE(TAG, "New image CRC mismatch");
+        ret = ESP_ERR_INVALID_CRC;
+    }
+
+    delta_abort(delta);
+    return ret;
+}
+
+esp_err_t delta_apply_file(FILE *patch, delta_read_fn read_old, void *old_ctx,
+                           delta_write_fn write_new, void *new_ctx)
+{
+    esp_err_t ret;
+    size_t have;
+    delta_t *delta;
+
+    uint8_t *in = (uint8_t *)malloc(DELTA_BUFFER_SIZE);
+    if (in == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ret = delta_begin(read_old, old_ctx, write_new, new_ctx, &delta);
+    if (ret != ESP_OK) {
+        free(in);
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "Initiated Patching");
+
+    while ((have = fread(in, 1, DELTA_BUFFER_SIZE, patch)) > 0) {
+        ret = delta_feed(delta, in, have);
+        if (ret != ESP_OK) {
+            delta_abort(delta);
+            goto CLEANUP;
+        }
+    }
+    if (ferror(patch)) {
+        delta_abort(delta);
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+
+    ret = delta_end(delta);
+
+CLEANUP:
+    free(in);
+    return ret;
+}
+
+esp_err_t delta_file_read(void *ctx, size_t offset, void *buf, size_t len)
+{
+    FILE *file = (FILE *)ctx;
+
+    if (fseek(file, offset, SEEK_SET) != 0 || fread(buf, 1, len, file) != len) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t delta_file_write(void *ctx, const void *buf, size_t len)
+{
+    FILE *file = (FILE *)ctx;
+
+    return fwrite(buf, 1, len, file) == len ? ESP_OK : ESP_FAIL;
+}
+
+#ifdef ESP_PLATFORM
+esp_err_t delta_partition_read(void *ctx, size_t offset, void *buf, size_t len)
+{
+    return esp_partition_read((const esp_partition_t *)ctx, offset, buf, len);
+}
+
+esp_err_t delta_ota_write(void *ctx, const void *buf, size_t len)
+{
+    return esp_ota_write(*(esp_ota_handle_t *)ctx, buf, len);
+}
+#endif
@@ -0,0 +1,438 @@
+/*
+    Host tool: make a delta patch (see delta.h) turning old.bin into new.bin.
+
+    Usage: delta_diff [-q quality] [-w window_bits] old.bin new.bin patch.dlt
+
+    The window sets the device decoder's ring buffer (2^window bytes), pick it to fit the target's RAM.
+    Suffix sorting and the match scan follow bsdiff 4.3 (Colin Percival, BSD 2-clause):
+    the old image is suffix sorted, long approximate matches become "add" runs of byte differences
+    (mostly zeros after a rebuild, which Brotli squeezes well) and the rest is copied literally.
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -o delta_diff $C/delta/host/delta_diff.c -I$C/brotli/include -I$C/zlib/include $C/brotli/common/*.c $C/brotli/enc/*.c $C/zlib/src/crc32.c -lm
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "zlib.h"
+#include "brotli/encode.h"
+
+#define MAGIC "DLT1"
+#define DEFAULT_QUALITY (11)
+#define DEFAULT_WINDOW (16)
+
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+
+typedef struct {
+    uint8_t *data;
+    size_t len;
+    size_t cap;
+} buf_t;
+
+static void buf_put(buf_t *b, const void *data, size_t len)
+{
+    if (b->len + len > b->cap) {
+        b->cap = (b->len + len) * 2;
+        b->data = (uint8_t *)realloc(b->data, b->cap);
+        if (b->data == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+    }
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = (v >> 24) & 0xFF;
+}
+
+static void split(int64_t *I, int64_t *V, int64_t start, int64_t len, int64_t h)
+{
+    int64_t i, j, k, x, tmp, jj, kk;
+
+    if (len < 16) {
+        for (k = start; k < start + len; k += j) {
+            j = 1;
+            x = V[I[k] + h];
+            for (i = 1; k + i < start + len; i++) {
+                if (V[I[k + i] + h] < x) {
+                    x = V[I[k + i] + h];
+                    j = 0;
+                }
+                if (V[I[k + i] + h] == x) {
+                    tmp = I[k + j];
+                    I[k + j] = I[k + i];
+                    I[k + i] = tmp;
+                    j++;
+                }
+            }
+            for (i = 0; i < j; i++) {
+                V[I[k + i]] = k + j - 1;
+            }
+            if (j == 1) {
+                I[k] = -1;
+            }
+        }
+        return;
+    }
+
+    x = V[I[start + len / 2] + h];
+    jj = 0;
+    kk = 0;
+    for (i = start; i < start + len; i++) {
+        if (V[I[i] + h] < x) {
+            jj++;
+        }
+        if (V[I[i] + h] == x) {
+            kk++;
+        }
+    }
+    jj += start;
+    kk += jj;
+
+    i = start;
+    j = 0;
+    k = 0;
+    while (i < jj) {
+        if (V[I[i] + h] < x) {
+            i++;
+        } else if (V[I[i] + h] == x) {
+            tmp = I[i];
+            I[i] = I[jj + j];
+            I[jj + j] = tmp;
+            j++;
+        } else {
+            tmp = I[i];
+            I[i] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+    while (jj + j < kk) {
+        if (V[I[jj + j] + h] == x) {
+            j++;
+        } else {
+            tmp = I[jj + j];
+            I[jj + j] = I[kk + k];
+            I[kk + k] = tmp;
+            k++;
+        }
+    }
+
+    if (jj > start) {
+        split(I, V, start, jj - start, h);
+    }
+    for (i = 0; i < kk - jj; i++) {
+        V[I[jj + i]] = kk - 1;
+    }
+    if (jj == kk - 1) {
+        I[jj] = -1;
+    }
+    if (start + len > kk) {
+        split(I, V, kk, start + len - kk, h);
+    }
+}
+
+// Larsson-Sadakane suffix sort
+static void qsufsort(int64_t *I, int64_t *V, const uint8_t *old, int64_t oldsize)
+{
+    int64_t buckets[256];
+    int64_t i, h, len;
+
+    memset(buckets, 0, sizeof(buckets));
+    for (i = 0; i < oldsize; i++) {
+        buckets[old[i]]++;
+    }
+    for (i = 1; i < 256; i++) {
+        buckets[i] += buckets[i - 1];
+    }
+    for (i = 255; i > 0; i--) {
+        buckets[i] = buckets[i - 1];
+    }
+    buckets[0] = 0;
+
+    for (i = 0; i < oldsize; i++) {
+        I[++buckets[old[i]]] = i;
+    }
+    I[0] = oldsize;
+    for (i = 0; i < oldsize; i++) {
+        V[i] = buckets[old[i]];
+    }
+    V[oldsize] = 0;
+    for (i = 1; i < 256; i++) {
+        if (buckets[i] == buckets[i - 1] + 1) {
+            I[buckets[i]] = -1;
+        }
+    }
+    I[0] = -1;
+
+    for (h = 1; I[0] != -(oldsize + 1); h += h) {
+        len = 0;
+        for (i = 0; i < oldsize + 1;) {
+            if (I[i] < 0) {
+                len -= I[i];
+                i -= I[i];
+            } else {
+                if (len) {
+                    I[i - len] = -len;
+                }
+                len = V[I[i]] + 1 - i;
+                split(I, V, i, len, h);
+                i += len;
+                len = 0;
+            }
+        }
+        if (len) {
+            I[i - len] = -len;
+        }
+    }
+
+    for (i = 0; i < oldsize + 1; i++) {
+        I[V[i]] = i;
+    }
+}
+
+static int64_t matchlen(const uint8_t *old, int64_t oldsize, const uint8_t *new, int64_t newsize)
+{
+    int64_t i;
+
+    for (i = 0; i < oldsize && i < newsize; i++) {
+        if (old[i] != new[i]) {
+            break;
+        }
+    }
+    return i;
+}
+
+// Longest match of new in old, by binary search over the suffix array
+static int64_t search(const int64_t *I, const uint8_t *old, int64_t oldsize,
+                      const uint8_t *new, int64_t newsize, int64_t st, int64_t en, int64_t *pos)
+{
+    while (en - st >= 2) {
+        int64_t x = st + (en - st) / 2;
+        if (memcmp(old + I[x], new, MIN(oldsize - I[x], newsize)) < 0) {
+            st = x;
+        } else {
+            en = x;
+        }
+    }
+
+    int64_t x = matchlen(old + I[st], oldsize - I[st], new, newsize);
+    int64_t y = matchlen(old + I[en], oldsize - I[en], new, newsize);
+    if (x > y) {
+        *pos = I[st];
+        return x;
+    }
+    *pos = I[en];
+    return y;
+}
+
+static void put_record(buf_t *out, const uint8_t *old, const uint8_t *new,
+                       int64_t lastscan, int64_t lastpos, int64_t lenf, int64_t extra, int64_t seek)
+{
+    uint8_t rec[12];
+
+    put_u32(rec, (uint32_t)lenf);
+    put_u32(rec + 4, (uint32_t)extra);
+    put_u32(rec + 8, (uint32_t)(int32_t)seek);
+    buf_put(out, rec, sizeof(rec));
+
+    for (int64_t i = 0; i < lenf; i++) {
+        uint8_t d = new[lastscan + i] - old[lastpos + i];
+        buf_put(out, &d, 1);
+    }
+    buf_put(out, new + lastscan + lenf, extra);
+}
+
+static void diff(const uint8_t *old, int64_t oldsize, const uint8_t *new, int64_t newsize, buf_t *out)
+{
+    int64_t *I = (int64_t *)malloc((oldsize + 1) * sizeof(int64_t));
+    int64_t *V = (int64_t *)malloc((oldsize + 1) * sizeof(int64_t));
+    int64_t scan = 0, len = 0, pos = 0;
+    int64_t lastscan = 0, lastpos = 0, lastoffset = 0;
+    int64_t oldscore, scsc;
+    int64_t s, Sf, lenf, Sb, lenb, overlap, Ss, lens, i;
+
+    if (I == NULL || V == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    qsufsort(I, V, old, oldsize);
+    free(V);
+
+    while (scan < newsize) {
+        oldscore = 0;
+
+        for (scsc = scan += len; scan < newsize; scan++) {
+            len = search(I, old, oldsize, new + scan, newsize - scan, 0, oldsize, &pos);
+
+            for (; scsc < scan + len; scsc++) {
+                if (scsc + lastoffset < oldsize && old[scsc + lastoffset] == new[scsc]) {
+                    oldscore++;
+                }
+            }
+            if ((len == oldscore && len != 0) || len > oldscore + 8) {
+                break;
+            }
+            if (scan + lastoffset < oldsize && old[scan + lastoffset] == new[scan]) {
+                oldscore--;
+            }
+        }
+
+        if (len != oldscore || scan == newsize) {
+            s = 0;
+            Sf = 0;
+            lenf = 0;
+            for (i = 0; lastscan + i < scan && lastpos + i < oldsize;) {
+                if (old[lastpos + i] == new[lastscan + i]) {
+                    s++;
+                }
+                i++;
+                if (s * 2 - i > Sf * 2 - lenf) {
+                    Sf = s;
+                    lenf = i;
+                }
+            }
+
+            lenb = 0;
+            if (scan < newsize) {
+                s = 0;
+                Sb = 0;
+                for (i = 1; scan >= lastscan + i && pos >= i; i++) {
+                    if (old[pos - i] == new[scan - i]) {
+                        s++;
+                    }
+                    if (s * 2 - i > Sb * 2 - lenb) {
+                        Sb = s;
+                        lenb = i;
+                    }
+                }
+            }
+
+            if (lastscan + lenf > scan - lenb) {
+                overlap = (lastscan + lenf) - (scan - lenb);
+                s = 0;
+                Ss = 0;
+                lens = 0;
+                for (i = 0; i < overlap; i++) {
+                    if (new[lastscan + lenf - overlap + i] == old[lastpos + lenf - overlap + i]) {
+                        s++;
+                    }
+                    if (new[scan - lenb + i] == old[pos - lenb + i]) {
+                        s--;
+                    }
+                    if (s > Ss) {
+                        Ss = s;
+                        lens = i + 1;
+                    }
+                }
+                lenf += lens - overlap;
+                lenb -= lens;
+            }
+
+            put_record(out, old, new, lastscan, lastpos, lenf,
+                       (scan - lenb) - (lastscan + lenf), (pos - lenb) - (lastpos + lenf));
+
+            lastscan = scan - lenb;
+            lastpos = pos - lenb;
+            lastoffset = pos - scan;
+        }
+    }
+
+    free(I);
+}
+
+static uint8_t *load(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    uint8_t *data;
+
+    if (f == NULL) {
+        perror(path);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    rewind(f);
+
+    data = (uint8_t *)malloc(*len + 1);
+    if (data == NULL || fread(data, 1, *len, f) != *len) {
+        fprintf(stderr, "Could not read %s\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return data;
+}
+
+int main(int argc, char **argv)
+{
+    int quality = DEFAULT_QUALITY;
+    int window = DEFAULT_WINDOW;
+    int arg = 1;
+    size_t old_len, new_len;
+    buf_t records = { 0 };
+
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2) {
+        if (strcmp(argv[arg], "-q") == 0) {
+            quality = atoi(argv[arg + 1]);
+        } else if (strcmp(argv[arg], "-w") == 0) {
+            window = atoi(argv[arg + 1]);
+        } else {
+            break;
+        }
+    }
+    if (argc - arg != 3 || quality < BROTLI_MIN_QUALITY || quality > BROTLI_MAX_QUALITY ||
+            window < BROTLI_MIN_WINDOW_BITS || window > BROTLI_MAX_WINDOW_BITS) {
+        fprintf(stderr, "Usage: %s [-q quality 0-11] [-w window_bits 10-24] old.bin new.bin patch.dlt\n", argv[0]);
+        return 1;
+    }
+
+    uint8_t *old = load(argv[arg], &old_len);
+    uint8_t *new = load(argv[arg + 1], &new_len);
+    if (old_len > INT32_MAX || new_len > INT32_MAX) {
+        fprintf(stderr, "Images larger than 2G are not supported\n");
+        return 1;
+    }
+
+    diff(old, old_len, new, new_len, &records);
+
+    size_t comp_len = BrotliEncoderMaxCompressedSize(records.len);
+    uint8_t *comp = (uint8_t *)malloc(comp_len ? comp_len : 1);
+    if (comp == NULL || !BrotliEncoderCompress(quality, window, BROTLI_MODE_GENERIC,
+                                               records.len, records.data, &comp_len, comp)) {
+        fprintf(stderr, "Brotli compression failed\n");
+        return 1;
+    }
+
+    uint8_t header[20];
+    memcpy(header, MAGIC, 4);
+    put_u32(header + 4, old_len);
+    put_u32(header + 8, crc32(0, old, old_len));
+    put_u32(header + 12, new_len);
+    put_u32(header + 16, crc32(0, new, new_len));
+
+    FILE *f = fopen(argv[arg + 2], "wb");
+    if (f == NULL || fwrite(header, 1, sizeof(header), f) != sizeof(header) ||
+            fwrite(comp, 1, comp_len, f) != comp_len || fclose(f) != 0) {
+        fprintf(stderr, "Could not write %s\n", argv[arg + 2]);
+        return 1;
+    }
+
+    printf("%s: %zu -> %zu bytes patch (%.1f%% of new image, records %zu bytes)\n",
+           argv[arg + 2], new_len, comp_len + sizeof(header), 100.0 * (comp_len + sizeof(header)) / new_len, records.len);
+
+    free(old);
+    free(new);
+    free(records.data);
+    free(comp);
+    return 0;
+}
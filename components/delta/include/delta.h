@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_partition.h"
+#include "esp_ota_ops.h"
+#endif
+
+/*
+    Firmware delta updates: a patch describes the new image in terms of the installed one.
+    Patches are made on the host with host/delta_diff.c (bsdiff-style matching, Brotli-compressed)
+    and applied on the device while they stream in; the old image is read back through a callback
+    (e.g. straight from its flash partition) so RAM use is the Brotli decoder plus two buffers.
+
+    Patch layout (little endian):
+        "DLT1", u32 old_size, u32 old_crc, u32 new_size, u32 new_crc (CRC-32)
+        Brotli stream of records:
+            u32 add_len, u32 copy_len, i32 seek
+            add_len bytes added to old[pos..], then pos += add_len + seek
+            copy_len bytes copied as is
+*/
+
+#define DELTA_MAGIC "DLT1"
+#define DELTA_MAGIC_SIZE (4)
+#define DELTA_HEADER_SIZE (20)
+#define DELTA_RECORD_SIZE (12)
+#define DELTA_BUFFER_SIZE (CONFIG_DELTA_BUFFER_SIZE)
+
+// Read len bytes of the old image at offset
+typedef esp_err_t (*delta_read_fn)(void *ctx, size_t offset, void *buf, size_t len);
+
+// Consume the next len bytes of the new image
+typedef esp_err_t (*delta_write_fn)(void *ctx, const void *buf, size_t len);
+
+typedef struct delta delta_t;
+
+esp_err_t delta_begin(delta_read_fn read_old, void *old_ctx, delta_write_fn write_new, void *new_ctx,
+                      delta_t **out);
+
+/*
+    Apply the next chunk of the patch, in whatever pieces it arrives.
+    The old image CRC is checked before the first record is applied: ESP_ERR_INVALID_VERSION
+    if the patch was made against a different image. Unless delta_verify() has finished it,
+    the feed that passes the end of the header reads the whole old image through read_old
+    before returning, which takes as long as reading old_size bytes from its partition.
+*/
+esp_err_t delta_feed(delta_t *delta, const uint8_t *patch, size_t len);
+
+/*
+    Check the old image CRC in steps of up to max_bytes (0: the rest), e.g. between
+    watchdog resets, once the header (DELTA_HEADER_SIZE bytes) has been fed; *more is set
+    while there is more to read. ESP_ERR_INVALID_STATE before the header is complete.
+*/
+esp_err_t delta_verify(delta_t *delta, size_t max_bytes, bool *more);
+
+// Check that the whole new image was produced and matches its CRC, then free the state
+esp_err_t delta_end(delta_t *delta);
+
+// Free the state without checks (aborted update)
+void delta_abort(delta_t *delta);
+
+// Whole patch from a file
+esp_err_t delta_apply_file(FILE *patch, delta_read_fn read_old, void *old_ctx,
+                           delta_write_fn write_new, void *new_ctx);
+
+// Callbacks for FILE * contexts
+esp_err_t delta_file_read(void *ctx, size_t offset, void *buf, size_t len);
+
+esp_err_t delta_file_write(void *ctx, const void *buf, size_t len);
+
+#ifdef ESP_PLATFORM
+// ctx is a const esp_partition_t *, e.g. esp_ota_get_running_partition()
+esp_err_t delta_partition_read(void *ctx, size_t offset, void *buf, size_t len);
+
+// ctx is an esp_ota_handle_t * from esp_ota_begin()
+esp_err_t delta_ota_write(void *ctx, const void *buf, size_t len);
+#endif
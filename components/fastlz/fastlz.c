@@ -0,0 +1,156 @@
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "fastlz.h"
+
+#define MAX_COPY (32)           // Literal run length per control byte
+#define MAX_LEN (264)           // 256 + 8, longest match
+#define MAX_DISTANCE (8192)     // 13-bit match offset
+#define MIN_MATCH (3)
+
+static inline uint32_t read24(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16);
+}
+
+static inline uint32_t hash24(uint32_t v)
+{
+    return (v * 2654435769u) >> (32 - FASTLZ_HASH_LOG);
+}
+
+static uint8_t *emit_literals(uint8_t *op, const uint8_t *src, size_t n)
+{
+    while (n > 0) {
+        size_t run = n < MAX_COPY ? n : MAX_COPY;
+        *op++ = (uint8_t)(run - 1);
+        memcpy(op, src, run);
+        op += run;
+        src += run;
+        n -= run;
+    }
+    return op;
+}
+
+static uint8_t *emit_match(uint8_t *op, size_t len, size_t distance)
+{
+    // Encoded length is len - 2; lengths above 8 spill into an extra byte
+    len -= 2;
+    if (len < 7) {
+        *op++ = (uint8_t)((len << 5) + (distance >> 8));
+    } else {
+        *op++ = (uint8_t)((7 << 5) + (distance >> 8));
+        *op++ = (uint8_t)(len - 7);
+    }
+    *op++ = (uint8_t)(distance & 255);
+    return op;
+}
+
+size_t fastlz_compress(const void *in, size_t len, void *out, uint16_t *htab)
+{
+    const uint8_t *base = (const uint8_t *)in;
+    const uint8_t *ip = base;
+    const uint8_t *anchor = base;
+    // Stop matching a few bytes short of the end; the tail is emitted as literals
+    const uint8_t *ip_limit = base + (len > 12 ? len - 12 : 0);
+    const uint8_t *ip_bound = base + (len > 4 ? len - 4 : 0);
+    uint8_t *op = (uint8_t *)out;
+
+    if (in == NULL || out == NULL || htab == NULL || len == 0 || len > FASTLZ_MAX_BLOCK) {
+        return 0;
+    }
+
+    memset(htab, 0, FASTLZ_HASH_SIZE * sizeof(uint16_t));
+
+    while (ip < ip_limit) {
+        uint32_t seq = read24(ip);
+        uint32_t h = hash24(seq);
+        const uint8_t *ref = base + htab[h];
+        size_t distance = ip - ref;
+
+        htab[h] = (uint16_t)(ip - base);
+
+        if (distance == 0 || distance > MAX_DISTANCE || read24(ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        const uint8_t *start = ip;
+        const uint8_t *max = ip + MAX_LEN < ip_bound ? ip + MAX_LEN : ip_bound;
+        ip += MIN_MATCH;
+        ref += MIN_MATCH;
+        while (ip < max && *ip == *ref) {
+            ip++;
+            ref++;
+        }
+
+        op = emit_literals(op, anchor, start - anchor);
+        op = emit_match(op, ip - start, distance - 1);
+        anchor = ip;
+
+        // Index the last position of the match so the next one can chain onto it
+        if (ip < ip_limit) {
+            htab[hash24(read24(ip - 1))] = (uint16_t)(ip - 1 - base);
+        }
+    }
+
+    op = emit_literals(op, anchor, base + len - anchor);
+    return op - (uint8_t *)out;
+}
+
+size_t fastlz_decompress(const void *in, size_t len, void *out, size_t max_out)
+{
+    const uint8_t *ip = (const uint8_t *)in;
+    const uint8_t *ip_end = ip + len;
+    uint8_t *op = (uint8_t *)out;
+    uint8_t *op_end = op + max_out;
+
+    if (in == NULL || out == NULL || len == 0) {
+        return 0;
+    }
+
+    // Upper 3 bits of the first byte carry the FastLZ level, 0 for level 1
+    if ((*ip >> 5) != 0) {
+        return 0;
+    }
+
+    while (ip < ip_end) {
+        uint32_t ctrl = *ip++;
+
+        if (ctrl < 32) {
+            size_t run = ctrl + 1;
+            if (ip + run > ip_end || op + run > op_end) {
+                return 0;
+            }
+            memcpy(op, ip, run);
+            ip += run;
+            op += run;
+        } else {
+            size_t n = (ctrl >> 5) - 1;
+            size_t distance = (ctrl & 31) << 8;
+
+            if (n == 6) {
+                if (ip >= ip_end) {
+                    return 0;
+                }
+                n += *ip++;
+            }
+            if (ip >= ip_end) {
+                return 0;
+            }
+            distance += *ip++;
+            n += MIN_MATCH;
+
+            if ((size_t)(op - (uint8_t *)out) < distance + 1 || op + n > op_end) {
+                return 0;
+            }
+
+            // Byte-wise copy: the match may overlap the bytes being produced
+            const uint8_t *ref = op - distance - 1;
+            while (n--) {
+                *op++ = *ref++;
+            }
+        }
+    }
+
+    return op - (uint8_t *)out;
+}
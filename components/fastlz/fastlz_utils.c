@@ -0,0 +1,200 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fastlz.h"
+#include "fastlz_utils.h"
+
+#define HEADER_SIZE (FASTLZ_HEADER_SIZE)
+#define MAGIC (FASTLZ_MAGIC)
+#define MAGIC_SIZE (FASTLZ_MAGIC_SIZE)
+
+static const char *TAG = "fastlz_utils";
+
+static inline void put_u16(uint8_t *p, size_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static inline size_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+size_t fastlz_compress_block(const uint8_t *in, size_t len, uint8_t *out, uint16_t *htab)
+{
+    size_t comp = fastlz_compress(in, len, out + HEADER_SIZE, htab);
+
+    if (comp == 0 || comp >= len) {
+        memcpy(out + HEADER_SIZE, in, len);
+        comp = len;
+    }
+
+    put_u16(out, len);
+    put_u16(out + 2, comp);
+    return HEADER_SIZE + comp;
+}
+
+esp_err_t fastlz_decompress_block(const uint8_t *in, size_t raw, size_t comp, uint8_t *out)
+{
+    if (comp == raw) {
+        memcpy(out, in, raw);
+        return ESP_OK;
+    }
+    return fastlz_decompress(in, comp, out, raw) == raw ? ESP_OK : ESP_ERR_INVALID_CRC;
+}
+
+esp_err_t fastlz_compress_file(FILE *source, FILE *dest)
+{
+    esp_err_t ret = ESP_OK;
+    size_t have;
+
+    uint8_t *in = (uint8_t *)malloc(FASTLZ_BLOCK_SIZE);
+    uint8_t *out = (uint8_t *)malloc(HEADER_SIZE + FASTLZ_BOUND(FASTLZ_BLOCK_SIZE));
+    uint16_t *htab = (uint16_t *)malloc(FASTLZ_HASH_SIZE * sizeof(uint16_t));
+
+    if (in == NULL || out == NULL || htab == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "Initiated Compression");
+
+    if (fwrite(MAGIC, 1, MAGIC_SIZE, dest) != MAGIC_SIZE) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+
+    while ((have = fread(in, 1, FASTLZ_BLOCK_SIZE, source)) > 0) {
+        size_t len = fastlz_compress_block(in, have, out, htab);
+        if (fwrite(out, 1, len, dest) != len || ferror(dest)) {
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+    }
+    if (ferror(source)) {
+        ret = ESP_FAIL;
+    }
+
+CLEANUP:
+    free(in);
+    free(out);
+    free(htab);
+    return ret;
+}
+
+esp_err_t fastlz_decompress_file(FILE *source, FILE *dest)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t header[HEADER_SIZE];
+
+    uint8_t *in = (uint8_t *)malloc(FASTLZ_BLOCK_SIZE);
+    uint8_t *out = (uint8_t *)malloc(FASTLZ_BLOCK_SIZE);
+
+    if (in == NULL || out == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "Initiated Decompression");
+
+    if (fread(header, 1, MAGIC_SIZE, source) != MAGIC_SIZE || memcmp(header, MAGIC, MAGIC_SIZE) != 0) {
+        ret = ESP_ERR_INVALID_ARG;
+        goto CLEANUP;
+    }
+
+    while (fread(header, 1, HEADER_SIZE, source) == HEADER_SIZE) {
+        size_t raw = get_u16(header);
+        size_t comp = get_u16(header + 2);
+
+        if (raw == 0 || raw > FASTLZ_BLOCK_SIZE || comp > raw) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+        if (fread(in, 1, comp, source) != comp) {
+            ret = ESP_ERR_INVALID_SIZE;
+            goto CLEANUP;
+        }
+
+        ret = fastlz_decompress_block(in, raw, comp, out);
+        if (ret != ESP_OK) {
+            goto CLEANUP;
+        }
+        if (fwrite(out, 1, raw, dest) != raw || ferror(dest)) {
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+    }
+    if (ferror(source)) {
+        ret = ESP_FAIL;
+    }
+
+CLEANUP:
+    free(in);
+    free(out);
+    return ret;
+}
+
+esp_err_t fastlz_compress_buf(const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len)
+{
+    size_t pos = 0, op = MAGIC_SIZE;
+
+    if (in == NULL || out == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (*out_len < FASTLZ_FRAMED_BOUND(in_len)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint16_t *htab = (uint16_t *)malloc(FASTLZ_HASH_SIZE * sizeof(uint16_t));
+    if (htab == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    memcpy(out, MAGIC, MAGIC_SIZE);
+    while (pos < in_len) {
+        size_t len = in_len - pos < FASTLZ_BLOCK_SIZE ? in_len - pos : FASTLZ_BLOCK_SIZE;
+        op += fastlz_compress_block(in + pos, len, out + op, htab);
+        pos += len;
+    }
+
+    free(htab);
+    *out_len = op;
+    return ESP_OK;
+}
+
+esp_err_t fastlz_decompress_buf(const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len)
+{
+    size_t ip = MAGIC_SIZE, op = 0;
+
+    if (in == NULL || out == NULL || out_len == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (in_len < MAGIC_SIZE || memcmp(in, MAGIC, MAGIC_SIZE) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (ip + HEADER_SIZE <= in_len) {
+        size_t raw = get_u16(in + ip);
+        size_t comp = get_u16(in + ip + 2);
+        ip += HEADER_SIZE;
+
+        if (raw == 0 || comp > raw || ip + comp > in_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (op + raw > *out_len) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+
+        esp_err_t ret = fastlz_decompress_block(in + ip, raw, comp, out + op);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+        ip += comp;
+        op += raw;
+    }
+
+    *out_len = op;
+    return ip == in_len ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    FastLZ level 1 block codec (format compatible with FastLZ 0.5 level 1).
+    Byte-aligned LZ77 with an 8K window: no entropy coding, tens of MB/s,
+    and a hash table of 2^CONFIG_FASTLZ_HASH_LOG 16-bit entries as the only state.
+*/
+
+#define FASTLZ_HASH_LOG (CONFIG_FASTLZ_HASH_LOG)
+#define FASTLZ_HASH_SIZE (1 << FASTLZ_HASH_LOG)
+
+// Largest block accepted by fastlz_compress(); positions are kept as 16-bit
+#define FASTLZ_MAX_BLOCK (65535)
+
+// Worst-case compressed size of a block of n bytes (incompressible data)
+#define FASTLZ_BOUND(n) ((n) + (n) / 32 + 1)
+
+/*
+    Compress one block of at most FASTLZ_MAX_BLOCK bytes.
+    out must hold FASTLZ_BOUND(len) bytes; htab must hold FASTLZ_HASH_SIZE entries.
+    Returns the compressed size, 0 on invalid arguments.
+*/
+size_t fastlz_compress(const void *in, size_t len, void *out, uint16_t *htab);
+
+/*
+    Decompress one block into at most max_out bytes.
+    Returns the decompressed size, 0 on corrupt input or insufficient space.
+*/
+size_t fastlz_decompress(const void *in, size_t len, void *out, size_t max_out);
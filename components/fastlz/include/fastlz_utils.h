@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Framed FastLZ stream: "FLZ1" magic, then blocks of CONFIG_FASTLZ_BLOCK_SIZE input bytes,
+    each prefixed by its raw and compressed length (16-bit LE).
+    Blocks that do not shrink are stored with compressed length == raw length.
+*/
+
+#define FASTLZ_BLOCK_SIZE (CONFIG_FASTLZ_BLOCK_SIZE)
+#define FASTLZ_MAGIC "FLZ1"
+#define FASTLZ_MAGIC_SIZE (4)
+#define FASTLZ_HEADER_SIZE (4)
+
+// Worst-case framed size for n input bytes
+#define FASTLZ_FRAMED_BOUND(n) (4 + (n) + 4 * (((n) + FASTLZ_BLOCK_SIZE - 1) / FASTLZ_BLOCK_SIZE))
+
+esp_err_t fastlz_compress_file(FILE *source, FILE *dest);
+
+esp_err_t fastlz_decompress_file(FILE *source, FILE *dest);
+
+esp_err_t fastlz_compress_buf(const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len);
+
+esp_err_t fastlz_decompress_buf(const uint8_t *in, size_t in_len, uint8_t *out, size_t *out_len);
+
+/*
+    Frame one block (header included) into out, which must hold FASTLZ_HEADER_SIZE + FASTLZ_BOUND(len).
+    Falls back to a stored block when compression does not pay off. Returns the framed size.
+*/
+size_t fastlz_compress_block(const uint8_t *in, size_t len, uint8_t *out, uint16_t *htab);
+
+// Decode the payload of one block given the raw and compressed lengths from its header
+esp_err_t fastlz_decompress_block(const uint8_t *in, size_t raw, size_t comp, uint8_t *out);
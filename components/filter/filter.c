@@ -0,0 +1,361 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "filter.h"
+
+/*
+    Whole strides go through fixed-width loops over elements of one type, which compilers
+    unroll (and vectorize on hosts); a stride that is split between calls is finished one byte
+    at a time, carrying the borrow between the bytes of an element. The ESP32, S2 and C3 have
+    no vector unit. The S3's PIE extension is only reachable from assembly or esp-dsp, not
+    from GCC's vectorizer, so these loops are scalar there too.
+*/
+
+#define OP_SUB(a, b) ((a) - (b))
+#define OP_ADD(a, b) ((a) + (b))
+#define OP_XOR(a, b) ((a) ^ (b))
+
+#define LOAD(T, p, i, v) memcpy(&(v), (p) + (i) * sizeof(T), sizeof(T))
+#define STORE(T, p, i, v) memcpy((p) + (i) * sizeof(T), &(v), sizeof(T))
+
+// Encode n bytes (whole strides) in place, back to front so every element still sees raw data
+#define DEFINE_ENCODE(NAME, T, OP)                                                  \
+static void NAME(uint8_t *p, size_t n, size_t s, const uint8_t *prev)               \
+{                                                                                   \
+    const size_t k = s / sizeof(T);                                                 \
+    T a, b, r;                                                                      \
+    for (size_t i = n / sizeof(T); i-- > k;) {                                      \
+        LOAD(T, p, i, a);                                                           \
+        LOAD(T, p, i - k, b);                                                       \
+        r = (T)OP(a, b);                                                            \
+        STORE(T, p, i, r);                                                          \
+    }                                                                               \
+    for (size_t i = 0; i < k; i++) {                                                \
+        LOAD(T, p, i, a);                                                           \
+        LOAD(T, prev, i, b);                                                        \
+        r = (T)OP(a, b);                                                            \
+        STORE(T, p, i, r);                                                          \
+    }                                                                               \
+}
+
+// Decode front to back, every element adds the already decoded one a stride earlier
+#define DEFINE_DECODE(NAME, T, OP)                                                  \
+static void NAME(uint8_t *p, size_t n, size_t s, const uint8_t *prev)               \
+{                                                                                   \
+    const size_t k = s / sizeof(T);                                                 \
+    T a, b, r;                                                                      \
+    for (size_t i = 0; i < k; i++) {                                                \
+        LOAD(T, p, i, a);                                                           \
+        LOAD(T, prev, i, b);                                                        \
+        r = (T)OP(a, b);                                                            \
+        STORE(T, p, i, r);                                                          \
+    }                                                                               \
+    for (size_t i = k; i < n / sizeof(T); i++) {                                    \
+        LOAD(T, p, i, a);                                                           \
+        LOAD(T, p, i - k, b);                                                       \
+        r = (T)OP(a, b);                                                            \
+        STORE(T, p, i, r);                                                          \
+    }                                                                               \
+}
+
+DEFINE_ENCODE(delta_enc_8, uint8_t, OP_SUB)
+DEFINE_ENCODE(delta_enc_16, uint16_t, OP_SUB)
+DEFINE_ENCODE(delta_enc_32, uint32_t, OP_SUB)
+DEFINE_ENCODE(delta_enc_64, uint64_t, OP_SUB)
+DEFINE_DECODE(delta_dec_8, uint8_t, OP_ADD)
+DEFINE_DECODE(delta_dec_16, uint16_t, OP_ADD)
+DEFINE_DECODE(delta_dec_32, uint32_t, OP_ADD)
+DEFINE_DECODE(delta_dec_64, uint64_t, OP_ADD)
+DEFINE_ENCODE(xor_enc_32, uint32_t, OP_XOR)
+DEFINE_ENCODE(xor_enc_8, uint8_t, OP_XOR)
+DEFINE_DECODE(xor_dec_32, uint32_t, OP_XOR)
+DEFINE_DECODE(xor_dec_8, uint8_t, OP_XOR)
+
+typedef void (*kernel_t)(uint8_t *p, size_t n, size_t s, const uint8_t *prev);
+
+static kernel_t delta_kernel(const filter_params_t *params, bool encode)
+{
+    switch (params->elem_size) {
+    case 2:
+        return encode ? delta_enc_16 : delta_dec_16;
+    case 4:
+        return encode ? delta_enc_32 : delta_dec_32;
+    case 8:
+        return encode ? delta_enc_64 : delta_dec_64;
+    default:
+        return encode ? delta_enc_8 : delta_dec_8;
+    }
+}
+
+// XOR does not care about element boundaries, only whether words fit the stride
+static kernel_t xor_kernel(const filter_params_t *params, bool encode)
+{
+    if (params->stride % 4 == 0) {
+        return encode ? xor_enc_32 : xor_dec_32;
+    }
+    return encode ? xor_enc_8 : xor_dec_8;
+}
+
+static void run_bytes(filter_t *filter, uint8_t *p, size_t len, bool encode)
+{
+    const size_t s = filter->params.stride;
+    const size_t e = filter->params.elem_size;
+
+    for (size_t i = 0; i < len; i++) {
+        size_t h = filter->pos % s;
+        unsigned cur = p[i];
+        unsigned prev = filter->hist[h];
+        unsigned res;
+
+        if (filter->pos % e == 0) {
+            filter->carry = 0;
+        }
+        if (filter->params.type == FILTER_XOR) {
+            res = cur ^ prev;
+        } else if (encode) {
+            prev += filter->carry;
+            res = cur - prev;
+            filter->carry = cur < prev;
+        } else {
+            res = cur + prev + filter->carry;
+            filter->carry = res > 0xFF;
+        }
+
+        p[i] = (uint8_t)res;
+        filter->hist[h] = encode ? (uint8_t)cur : (uint8_t)res;
+        filter->pos++;
+    }
+}
+
+static void run_history(filter_t *filter, uint8_t *p, size_t len, bool encode)
+{
+    const size_t s = filter->params.stride;
+    uint8_t *scratch = filter->hist + s;
+
+    // Finish a stride split by the previous call
+    size_t head = (s - filter->pos % s) % s;
+    if (head > len) {
+        head = len;
+    }
+    run_bytes(filter, p, head, encode);
+    p += head;
+    len -= head;
+
+    size_t n = len - len % s;
+    if (n > 0) {
+        kernel_t kernel = filter->params.type == FILTER_XOR ? xor_kernel(&filter->params, encode)
+                                                            : delta_kernel(&filter->params, encode);
+        if (encode) {
+            memcpy(scratch, p + n - s, s);
+            kernel(p, n, s, filter->hist);
+            memcpy(filter->hist, scratch, s);
+        } else {
+            kernel(p, n, s, filter->hist);
+            memcpy(filter->hist, p + n - s, s);
+        }
+        filter->pos += n;
+    }
+
+    run_bytes(filter, p + n, len - n, encode);
+}
+
+static inline void shuffle(uint8_t *dst, const uint8_t *src, size_t n, size_t e)
+{
+    for (size_t b = 0; b < e; b++) {
+        for (size_t j = 0; j < n; j++) {
+            dst[b * n + j] = src[j * e + b];
+        }
+    }
+}
+
+static inline void unshuffle(uint8_t *dst, const uint8_t *src, size_t n, size_t e)
+{
+    for (size_t b = 0; b < e; b++) {
+        for (size_t j = 0; j < n; j++) {
+            dst[j * e + b] = src[b * n + j];
+        }
+    }
+}
+
+// Constant element sizes let the compiler unroll the plane loop
+static void transpose(uint8_t *dst, const uint8_t *src, size_t n, size_t e, bool encode)
+{
+    switch (e) {
+    case 2:
+        encode ? shuffle(dst, src, n, 2) : unshuffle(dst, src, n, 2);
+        break;
+    case 4:
+        encode ? shuffle(dst, src, n, 4) : unshuffle(dst, src, n, 4);
+        break;
+    case 8:
+        encode ? shuffle(dst, src, n, 8) : unshuffle(dst, src, n, 8);
+        break;
+    default:
+        memcpy(dst, src, n * e);
+        break;
+    }
+}
+
+/*
+    8x8 bit matrix transpose of the bytes of x (Hacker's Delight 7-3), its own inverse.
+    Plain 64-bit shifts and masks: the same code on every target, S3 included (no PIE path).
+*/
+static inline uint64_t transpose_bits(uint64_t x)
+{
+    uint64_t t;
+
+    t = (x ^ (x >> 7)) & 0x00AA00AA00AA00AAULL;
+    x = x ^ t ^ (t << 7);
+    t = (x ^ (x >> 14)) & 0x0000CCCC0000CCCCULL;
+    x = x ^ t ^ (t << 14);
+    t = (x ^ (x >> 28)) & 0x00000000F0F0F0F0ULL;
+    x = x ^ t ^ (t << 28);
+    return x;
+}
+
+/*
+    Byte planes of n bytes (n a multiple of 8) <-> bit planes of n / 8 bytes.
+    Every 8 bytes of a byte plane become one byte in each of its 8 bit planes.
+*/
+static void transpose_planes(uint8_t *dst, const uint8_t *src, size_t n, size_t e, bool encode)
+{
+    const size_t m = n / 8;
+    uint64_t x;
+
+    for (size_t b = 0; b < e; b++) {
+        for (size_t g = 0; g < m; g++) {
+            if (encode) {
+                memcpy(&x, src + b * n + g * 8, 8);
+                x = transpose_bits(x);
+                for (size_t k = 0; k < 8; k++) {
+                    dst[(b * 8 + k) * m + g] = (uint8_t)(x >> (8 * k));
+                }
+            } else {
+                x = 0;
+                for (size_t k = 0; k < 8; k++) {
+                    x |= (uint64_t)src[(b * 8 + k) * m + g] << (8 * k);
+                }
+                x = transpose_bits(x);
+                memcpy(dst + b * n + g * 8, &x, 8);
+            }
+        }
+    }
+}
+
+static esp_err_t run_shuffle(filter_t *filter, uint8_t *p, size_t len, bool encode)
+{
+    const size_t s = filter->params.stride;
+    const size_t e = filter->params.elem_size;
+
+    if (filter->ended && len > 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    while (len > 0) {
+        size_t block = len < s ? len : s;
+        size_t n = block / e;
+
+        if (filter->params.type == FILTER_BITSHUFFLE && block == s) {
+            if (encode) {
+                transpose(filter->hist, p, n, e, true);
+                transpose_planes(p, filter->hist, n, e, true);
+            } else {
+                transpose_planes(filter->hist, p, n, e, false);
+                transpose(p, filter->hist, n, e, false);
+            }
+        } else {
+            transpose(filter->hist, p, n, e, encode);
+            memcpy(p, filter->hist, n * e);
+        }
+
+        filter->pos += block;
+        filter->ended = block < s;
+        p += block;
+        len -= block;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t run(filter_t *filter, uint8_t *data, size_t len, bool encode)
+{
+    if (filter == NULL || (data == NULL && len > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    switch (filter->params.type) {
+    case FILTER_DELTA:
+    case FILTER_XOR:
+        run_history(filter, data, len, encode);
+        return ESP_OK;
+    case FILTER_SHUFFLE:
+    case FILTER_BITSHUFFLE:
+        return run_shuffle(filter, data, len, encode);
+    default:
+        return ESP_OK;
+    }
+}
+
+size_t filter_mem_estimate(const filter_params_t *params)
+{
+    if (params == NULL || params->type == FILTER_NONE) {
+        return 0;
+    }
+    return filter_is_blocked(params) ? params->stride : 2 * params->stride;
+}
+
+esp_err_t filter_init(filter_t *filter, const filter_params_t *params)
+{
+    if (filter == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memset(filter, 0, sizeof(filter_t));
+    if (params == NULL || params->type == FILTER_NONE) {
+        return ESP_OK;
+    }
+
+    size_t e = params->elem_size;
+    if (params->type >= FILTER_MAX || (e != 1 && e != 2 && e != 4 && e != 8) ||
+        params->stride == 0 || params->stride % e != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (params->type == FILTER_BITSHUFFLE && params->stride % (8 * e) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    filter->hist = (uint8_t *)calloc(1, filter_mem_estimate(params));
+    if (filter->hist == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    filter->params = *params;
+    return ESP_OK;
+}
+
+esp_err_t filter_encode(filter_t *filter, uint8_t *data, size_t len)
+{
+    return run(filter, data, len, true);
+}
+
+esp_err_t filter_decode(filter_t *filter, uint8_t *data, size_t len)
+{
+    return run(filter, data, len, false);
+}
+
+void filter_reset(filter_t *filter)
+{
+    if (filter->hist != NULL) {
+        memset(filter->hist, 0, filter->params.stride);
+    }
+    filter->pos = 0;
+    filter->carry = 0;
+    filter->ended = false;
+}
+
+void filter_deinit(filter_t *filter)
+{
+    if (filter == NULL) {
+        return;
+    }
+    free(filter->hist);
+    filter->hist = NULL;
+    filter->params.type = FILTER_NONE;
+}
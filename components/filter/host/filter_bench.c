@@ -0,0 +1,150 @@
+/*
+    Host benchmark for filter.h: 240K of synthetic 12 byte records compressed through a codec
+    with each filter, deflate and Brotli at their Kconfig defaults, plus the speed of the filter
+    alone (encode and decode in place). Prints the README table; every stream is decompressed
+    and compared.
+
+    Record: int32 timestamp (10 ms steps), int16 temperature (slow sine, a count or two of noise),
+    int16 humidity (a few counts of noise), float pressure (slow sine).
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/codec/include -I$C/codec -I$C/filter/include -I$C/probe/include -I$C/zlib_utils/include -I$C/zlib/include -I$C/brotli/include -I$C/fastlz/include -I$C/lzss/include -o filter_bench $C/filter/host/filter_bench.c $C/codec/codec.c $C/codec/codec_zlib.c $C/codec/codec_brotli.c $C/codec/codec_fastlz.c $C/codec/codec_lzss.c $C/filter/filter.c $C/probe/probe.c $C/zlib_utils/zlib_utils.c $C/zlib/src/*.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c $C/fastlz/*.c $C/lzss/*.c -lm -lpthread
+//   ./filter_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+
+#include "codec.h"
+#include "filter.h"
+
+#define RECORD_SIZE (12)
+#define DATA_SIZE (240000)
+#define SPEED_ROUNDS (50)
+
+static const struct {
+    const char *name;
+    filter_params_t params;
+} s_filters[] = {
+    { "None", { FILTER_NONE, 1, 1 } },
+    { "DELTA, 2 byte elements, stride 12", { FILTER_DELTA, 2, RECORD_SIZE } },
+    { "XOR, stride 12", { FILTER_XOR, 4, RECORD_SIZE } },
+    { "SHUFFLE, 4 byte elements, 960 byte blocks", { FILTER_SHUFFLE, 4, 80 * RECORD_SIZE } },
+};
+
+static void make_records(uint8_t *data)
+{
+    srand(7);
+    for (size_t i = 0; i < DATA_SIZE / RECORD_SIZE; i++) {
+        int32_t ts = 1000000 + (int32_t)i * 10;
+        int16_t temp = (int16_t)(2000 + (int)(50 * sin(i / 500.0)) + rand() % 3);
+        int16_t hum = (int16_t)(4500 + rand() % 5);
+        float pressure = 1013.25f + 0.5f * (float)sin(i / 3000.0);
+        uint8_t *r = data + i * RECORD_SIZE;
+        memcpy(r, &ts, 4);
+        memcpy(r + 4, &temp, 2);
+        memcpy(r + 6, &hum, 2);
+        memcpy(r + 8, &pressure, 4);
+    }
+}
+
+// Compressed size, 0 on failure or mismatch
+static size_t round_trip(codec_type_t type, const filter_params_t *filter, const uint8_t *data,
+                         uint8_t *comp, uint8_t *back)
+{
+    codec_params_t params;
+    codec_t *codec;
+    size_t comp_len = 2 * DATA_SIZE, back_len = 2 * DATA_SIZE;
+
+    codec_default_params(type, &params);
+    params.filter = *filter;
+    if (codec_create(type, CODEC_COMPRESS, &params, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t ret = codec_buf(codec, data, DATA_SIZE, comp, &comp_len);
+    codec_destroy(codec);
+    if (ret != ESP_OK || codec_create(type, CODEC_DECOMPRESS, &params, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    ret = codec_buf(codec, comp, comp_len, back, &back_len);
+    codec_destroy(codec);
+    if (ret != ESP_OK || back_len != DATA_SIZE || memcmp(back, data, DATA_SIZE) != 0) {
+        return 0;
+    }
+    return comp_len;
+}
+
+// Filter speed in MB/s over encode and decode, 0 on failure
+static double filter_speed(const filter_params_t *params, const uint8_t *data, uint8_t *work)
+{
+    filter_t filter;
+
+    if (filter_init(&filter, params) != ESP_OK) {
+        return 0;
+    }
+    memcpy(work, data, DATA_SIZE);
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < SPEED_ROUNDS; i++) {
+        filter_reset(&filter);
+        filter_encode(&filter, work, DATA_SIZE);
+        filter_reset(&filter);
+        filter_decode(&filter, work, DATA_SIZE);
+    }
+    int64_t us = esp_timer_get_time() - start;
+    filter_deinit(&filter);
+    if (memcmp(work, data, DATA_SIZE) != 0) {
+        return 0;
+    }
+    return (double)DATA_SIZE * SPEED_ROUNDS / (us > 0 ? us : 1);
+}
+
+int main(void)
+{
+    uint8_t *data = (uint8_t *)malloc(DATA_SIZE);
+    uint8_t *comp = (uint8_t *)malloc(2 * DATA_SIZE);
+    uint8_t *back = (uint8_t *)malloc(2 * DATA_SIZE);
+    int fail = 0;
+
+    if (data == NULL || comp == NULL || back == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+    make_records(data);
+
+    printf("| Filter | deflate C/R | Brotli q%d C/R | Filter speed (enc + dec) |\n", CONFIG_CODEC_BROTLI_QUALITY);
+    printf("| --- | --- | --- | --- |\n");
+    for (size_t i = 0; i < sizeof(s_filters) / sizeof(s_filters[0]); i++) {
+        const filter_params_t *fp = &s_filters[i].params;
+        size_t deflated = round_trip(CODEC_DEFLATE, fp, data, comp, back);
+        size_t brotli = round_trip(CODEC_BROTLI, fp, data, comp, back);
+        if (deflated == 0 || brotli == 0) {
+            printf("%s: round trip FAILED\n", s_filters[i].name);
+            fail = 1;
+            continue;
+        }
+        printf("| %s | %.2f | %.2f | ", s_filters[i].name,
+               (double)DATA_SIZE / deflated, (double)DATA_SIZE / brotli);
+        if (fp->type == FILTER_NONE) {
+            printf("- |\n");
+            continue;
+        }
+        double mbs = filter_speed(fp, data, back);
+        if (mbs == 0) {
+            printf("FAILED |\n");
+            fail = 1;
+        } else {
+            printf("%.0f MB/s |\n", mbs);
+        }
+    }
+
+    free(data);
+    free(comp);
+    free(back);
+    return fail;
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+/*
+    Reversible pre-compression filters for fixed-width numeric data (sensor samples, records
+    of int16/int32/float fields). They do not shrink anything themselves; they turn slowly
+    changing values into runs of small or repeated bytes that LZ77 and entropy coding handle
+    much better.
+
+    DELTA and XOR compare every element with the one stride bytes earlier, so a stride equal to
+    the record size matches each field with the same field of the previous record. Both are
+    streaming: calls may split the data anywhere. Elements are little-endian.
+
+    SHUFFLE transposes each block of stride bytes into elem_size byte planes (all first bytes,
+    then all second bytes, ...). BITSHUFFLE goes on to split every byte plane into 8 bit planes,
+    which suits floats whose low mantissa bits are noise; its stride must hold a multiple of
+    8 elements. Calls must pass whole blocks; a final short block is allowed and ends the
+    stream (it is only byte shuffled, and its trailing partial element is left as is).
+
+    Encoder and decoder must use the same parameters, they are not stored anywhere.
+*/
+
+typedef enum {
+    FILTER_NONE,
+    FILTER_DELTA,       // Element minus the element stride bytes earlier
+    FILTER_XOR,         // Byte XOR the byte stride bytes earlier
+    FILTER_SHUFFLE,     // Byte planes of stride byte blocks
+    FILTER_BITSHUFFLE,  // Bit planes of stride byte blocks
+    FILTER_MAX,
+} filter_type_t;
+
+typedef struct {
+    filter_type_t type;
+    uint8_t elem_size;      // 1, 2, 4 or 8
+    uint16_t stride;        // Multiple of elem_size: record size (DELTA, XOR) or block size (SHUFFLE)
+} filter_params_t;
+
+typedef struct {
+    filter_params_t params;
+    uint8_t *hist;          // Previous stride bytes, then stride bytes of scratch
+    uint64_t pos;           // Bytes filtered so far
+    unsigned carry;         // DELTA: borrow / carry into the next byte of the element
+    bool ended;             // SHUFFLE, BITSHUFFLE: a short block was filtered
+} filter_t;
+
+// SHUFFLE and BITSHUFFLE only work on whole blocks of stride bytes
+static inline bool filter_is_blocked(const filter_params_t *params)
+{
+    return params->type == FILTER_SHUFFLE || params->type == FILTER_BITSHUFFLE;
+}
+
+// Heap used by a filter with these parameters
+size_t filter_mem_estimate(const filter_params_t *params);
+
+esp_err_t filter_init(filter_t *filter, const filter_params_t *params);
+
+// Filter / unfilter in place
+esp_err_t filter_encode(filter_t *filter, uint8_t *data, size_t len);
+
+esp_err_t filter_decode(filter_t *filter, uint8_t *data, size_t len);
+
+// Start a new stream with the same parameters
+void filter_reset(filter_t *filter);
+
+void filter_deinit(filter_t *filter);
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    LSB-first bit writer and reader, after brotli's enc/write_bits.h. Bits collect in a 64-bit
+    accumulator and leave as whole bytes rather than through unaligned 64-bit stores, which
+    Xtensa does not have. At most 32 bits per call; the writer's caller makes sure they fit.
+*/
+
+typedef struct {
+    uint8_t *buf;
+    size_t pos;
+    uint64_t acc;
+    unsigned n;
+} bit_writer_t;
+
+typedef struct {
+    const uint8_t *buf;
+    size_t pos;
+    size_t size;
+    uint64_t acc;
+    unsigned n;
+    bool overrun;       // Read past the end of the buffer
+} bit_reader_t;
+
+static inline void bw_init(bit_writer_t *bw, uint8_t *buf)
+{
+    bw->buf = buf;
+    bw->pos = 0;
+    bw->acc = 0;
+    bw->n = 0;
+}
+
+static inline void bw_put(bit_writer_t *bw, unsigned n_bits, uint32_t bits)
+{
+    bw->acc |= (uint64_t)(bits & (uint32_t)((1ULL << n_bits) - 1)) << bw->n;
+    bw->n += n_bits;
+    while (bw->n >= 8) {
+        bw->buf[bw->pos++] = (uint8_t)bw->acc;
+        bw->acc >>= 8;
+        bw->n -= 8;
+    }
+}
+
+static inline void bw_put64(bit_writer_t *bw, unsigned n_bits, uint64_t bits)
+{
+    if (n_bits > 32) {
+        bw_put(bw, 32, (uint32_t)bits);
+        bw_put(bw, n_bits - 32, (uint32_t)(bits >> 32));
+    } else {
+        bw_put(bw, n_bits, (uint32_t)bits);
+    }
+}
+
+// Pad to a byte boundary; returns the bytes written
+static inline size_t bw_finish(bit_writer_t *bw)
+{
+    if (bw->n > 0) {
+        bw->buf[bw->pos++] = (uint8_t)bw->acc;
+        bw->acc = 0;
+        bw->n = 0;
+    }
+    return bw->pos;
+}
+
+static inline void br_init(bit_reader_t *br, const uint8_t *buf, size_t size)
+{
+    br->buf = buf;
+    br->pos = 0;
+    br->size = size;
+    br->acc = 0;
+    br->n = 0;
+    br->overrun = false;
+}
+
+static inline uint32_t br_get(bit_reader_t *br, unsigned n_bits)
+{
+    while (br->n < n_bits) {
+        if (br->pos < br->size) {
+            br->acc |= (uint64_t)br->buf[br->pos++] << br->n;
+        } else {
+            br->overrun = true;
+        }
+        br->n += 8;
+    }
+
+    uint32_t bits = (uint32_t)(br->acc & ((1ULL << n_bits) - 1));
+    br->acc >>= n_bits;
+    br->n -= n_bits;
+    return bits;
+}
+
+static inline uint64_t br_get64(bit_reader_t *br, unsigned n_bits)
+{
+    if (n_bits > 32) {
+        uint64_t lo = br_get(br, 32);
+        return lo | (uint64_t)br_get(br, n_bits - 32) << 32;
+    }
+    return br_get(br, n_bits);
+}
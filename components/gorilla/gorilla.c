@@ -0,0 +1,525 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+#include "sdkconfig.h"
+
+#include "gorilla.h"
+#include "bits.h"
+
+static const char *TAG = "gorilla";
+
+#define MAGIC "GRL1"
+#define HEADER_SIZE (7)             // Magic, flags, block size
+#define FLAG_DEFLATE (0x01)
+#define BLOCK_HEADER_SIZE (4)       // Sample count, payload bytes
+#define MAX_SAMPLE_BYTES (20)       // 68 + 77 bits, and the partial byte left in the accumulator
+#define MAX_BLOCK_SAMPLES (0xFFFF)
+#define IO_SIZE (1024)
+#define NO_WINDOW (64)              // No changed bit window yet: the next value sets one
+// Matches zlib_utils: zlib writes 9 into zlib headers for a window of 8
+#define WINDOW_BITS (CONFIG_WINDOW_SIZE == 8 ? 9 : CONFIG_WINDOW_SIZE)
+
+/*
+    Interval changes by size: a '0' bit for none, otherwise 1-4 '1' bits (a '0' after the
+    first three classes) and the change plus a bias in a fixed number of bits.
+*/
+static const struct {
+    unsigned bits;
+    int64_t bias;
+} dod_codes[] = {
+    { 0, 0 },
+    { 7, 63 },          // -63 .. 64
+    { 9, 255 },         // -255 .. 256
+    { 12, 2047 },       // -2047 .. 2048
+    { 64, 0 },
+};
+
+typedef struct {
+    int64_t ts;
+    int64_t delta;
+    uint64_t value;
+    unsigned leading;       // Changed bit window of the last value that set one
+    unsigned trailing;
+} series_t;
+
+struct gorilla_writer {
+    FILE *dest;
+    z_stream *strm;         // Deflate stage, NULL without
+    uint8_t *out;
+    uint8_t *block;         // Block header, then the bit stream
+    bit_writer_t bw;
+    series_t series;
+    uint16_t count;
+    gorilla_stats_t stats;
+};
+
+struct gorilla_reader {
+    FILE *source;
+    z_stream *strm;         // Inflate stage, NULL without
+    uint8_t *in;
+    bool ended;             // Inflate reached the end of the zlib stream
+    uint8_t *block;
+    size_t block_size;
+    bit_reader_t br;
+    series_t series;
+    uint16_t count;
+    uint16_t index;
+};
+
+static void put_first(bit_writer_t *bw, series_t *s, int64_t ts, uint64_t value)
+{
+    bw_put64(bw, 64, (uint64_t)ts);
+    bw_put64(bw, 64, value);
+    s->ts = ts;
+    s->delta = 0;
+    s->value = value;
+    s->leading = s->trailing = NO_WINDOW;
+}
+
+static void put_timestamp(bit_writer_t *bw, series_t *s, int64_t ts)
+{
+    int64_t delta = ts - s->ts;
+    int64_t dod = delta - s->delta;
+    unsigned cls = 0;
+
+    if (dod != 0) {
+        for (cls = 1; cls < 4; cls++) {
+            if (dod >= -dod_codes[cls].bias && dod < (1LL << dod_codes[cls].bits) - dod_codes[cls].bias) {
+                break;
+            }
+        }
+    }
+    bw_put(bw, cls < 4 ? cls + 1 : cls, (1u << cls) - 1);
+    bw_put64(bw, dod_codes[cls].bits, (uint64_t)(dod + dod_codes[cls].bias));
+
+    s->ts = ts;
+    s->delta = delta;
+}
+
+static void put_value(bit_writer_t *bw, series_t *s, uint64_t value)
+{
+    uint64_t x = value ^ s->value;
+
+    s->value = value;
+    if (x == 0) {
+        bw_put(bw, 1, 0);
+        return;
+    }
+
+    unsigned leading = __builtin_clzll(x);
+    unsigned trailing = __builtin_ctzll(x);
+    if (leading > 31) {
+        leading = 31;
+    }
+
+    // '10': same window as before; '11': new window
+    if (leading >= s->leading && trailing >= s->trailing) {
+        bw_put(bw, 2, 0x1);
+        bw_put64(bw, 64 - s->leading - s->trailing, x >> s->trailing);
+        return;
+    }
+
+    unsigned len = 64 - leading - trailing;
+    bw_put(bw, 2, 0x3);
+    bw_put(bw, 5, leading);
+    bw_put(bw, 6, len - 1);
+    bw_put64(bw, len, x >> trailing);
+    s->leading = leading;
+    s->trailing = trailing;
+}
+
+static void get_first(bit_reader_t *br, series_t *s)
+{
+    s->ts = (int64_t)br_get64(br, 64);
+    s->value = br_get64(br, 64);
+    s->delta = 0;
+    s->leading = s->trailing = NO_WINDOW;
+}
+
+static void get_timestamp(bit_reader_t *br, series_t *s)
+{
+    unsigned cls = 0;
+
+    while (cls < 4 && br_get(br, 1)) {
+        cls++;
+    }
+    int64_t dod = (int64_t)br_get64(br, dod_codes[cls].bits) - dod_codes[cls].bias;
+
+    s->delta += dod;
+    s->ts += s->delta;
+}
+
+static esp_err_t get_value(bit_reader_t *br, series_t *s)
+{
+    uint64_t x;
+
+    if (br_get(br, 1) == 0) {
+        return ESP_OK;
+    }
+
+    if (br_get(br, 1) == 0) {
+        if (s->leading == NO_WINDOW) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        x = br_get64(br, 64 - s->leading - s->trailing) << s->trailing;
+    } else {
+        unsigned leading = br_get(br, 5);
+        unsigned len = br_get(br, 6) + 1;
+        if (leading + len > 64) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+        s->leading = leading;
+        s->trailing = 64 - leading - len;
+        x = br_get64(br, len) << s->trailing;
+    }
+
+    s->value ^= x;
+    return ESP_OK;
+}
+
+static esp_err_t emit(gorilla_writer_t *w, const uint8_t *data, size_t len, int flush)
+{
+    size_t have;
+
+    if (w->strm == NULL) {
+        if (fwrite(data, 1, len, w->dest) != len) {
+            return ESP_FAIL;
+        }
+        w->stats.bytes_out += len;
+        return ESP_OK;
+    }
+
+    w->strm->next_in = (Bytef *)data;
+    w->strm->avail_in = len;
+    do {
+        w->strm->next_out = w->out;
+        w->strm->avail_out = IO_SIZE;
+        if (deflate(w->strm, flush) == Z_STREAM_ERROR) {
+            return ESP_FAIL;
+        }
+        have = IO_SIZE - w->strm->avail_out;
+        if (fwrite(w->out, 1, have, w->dest) != have) {
+            return ESP_FAIL;
+        }
+        w->stats.bytes_out += have;
+    } while (w->strm->avail_out == 0);
+    return ESP_OK;
+}
+
+static esp_err_t end_block(gorilla_writer_t *w)
+{
+    if (w->count == 0) {
+        return ESP_OK;
+    }
+
+    size_t len = bw_finish(&w->bw);
+    w->block[0] = w->count & 0xFF;
+    w->block[1] = w->count >> 8;
+    w->block[2] = len & 0xFF;
+    w->block[3] = len >> 8;
+
+    esp_err_t ret = emit(w, w->block, BLOCK_HEADER_SIZE + len, Z_NO_FLUSH);
+    w->count = 0;
+    w->stats.blocks++;
+    bw_init(&w->bw, w->block + BLOCK_HEADER_SIZE);
+    return ret;
+}
+
+static void writer_free(gorilla_writer_t *w)
+{
+    if (w->strm != NULL) {
+        deflateEnd(w->strm);
+        free(w->strm);
+    }
+    free(w->out);
+    free(w->block);
+    free(w);
+}
+
+esp_err_t gorilla_writer_open(FILE *dest, bool deflate, gorilla_writer_t **out)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t header[HEADER_SIZE] = MAGIC;
+
+    if (dest == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    gorilla_writer_t *w = (gorilla_writer_t *)calloc(1, sizeof(gorilla_writer_t));
+    if (w == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    w->dest = dest;
+
+    w->block = (uint8_t *)malloc(BLOCK_HEADER_SIZE + GORILLA_BLOCK_SIZE);
+    if (w->block == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+    bw_init(&w->bw, w->block + BLOCK_HEADER_SIZE);
+
+    if (deflate) {
+        w->strm = (z_stream *)calloc(1, sizeof(z_stream));
+        w->out = (uint8_t *)malloc(IO_SIZE);
+        if (w->strm == NULL || w->out == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            goto CLEANUP;
+        }
+        if (deflateInit2(w->strm, CONFIG_COMPRESSION_LEVEL, Z_DEFLATED, WINDOW_BITS, CONFIG_MEM_LEVEL,
+                         Z_DEFAULT_STRATEGY) != Z_OK) {
+            free(w->strm);
+            w->strm = NULL;
+            ret = ESP_ERR_NO_MEM;
+            goto CLEANUP;
+        }
+    }
+
+    // The file header stays outside the zlib stream so the reader knows what follows
+    header[4] = deflate ? FLAG_DEFLATE : 0;
+    header[5] = GORILLA_BLOCK_SIZE & 0xFF;
+    header[6] = GORILLA_BLOCK_SIZE >> 8;
+    if (fwrite(header, 1, HEADER_SIZE, dest) != HEADER_SIZE) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+    w->stats.bytes_out = HEADER_SIZE;
+
+    *out = w;
+    return ESP_OK;
+
+CLEANUP:
+    writer_free(w);
+    return ret;
+}
+
+esp_err_t gorilla_write(gorilla_writer_t *w, int64_t ts, double value)
+{
+    uint64_t bits;
+
+    if (w == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (w->bw.pos + MAX_SAMPLE_BYTES > GORILLA_BLOCK_SIZE || w->count == MAX_BLOCK_SAMPLES) {
+        esp_err_t ret = end_block(w);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    memcpy(&bits, &value, sizeof(bits));
+    if (w->count == 0) {
+        put_first(&w->bw, &w->series, ts, bits);
+    } else {
+        put_timestamp(&w->bw, &w->series, ts);
+        put_value(&w->bw, &w->series, bits);
+    }
+    w->count++;
+    w->stats.samples++;
+    return ESP_OK;
+}
+
+esp_err_t gorilla_writer_flush(gorilla_writer_t *w)
+{
+    if (w == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = end_block(w);
+    if (ret == ESP_OK && w->strm != NULL) {
+        ret = emit(w, NULL, 0, Z_SYNC_FLUSH);
+    }
+    if (ret == ESP_OK && fflush(w->dest) != 0) {
+        ret = ESP_FAIL;
+    }
+    return ret;
+}
+
+void gorilla_writer_get_stats(const gorilla_writer_t *w, gorilla_stats_t *stats)
+{
+    *stats = w->stats;
+}
+
+esp_err_t gorilla_writer_close(gorilla_writer_t *w)
+{
+    if (w == NULL) {
+        return ESP_OK;
+    }
+
+    esp_err_t ret = end_block(w);
+    if (ret == ESP_OK && w->strm != NULL) {
+        ret = emit(w, NULL, 0, Z_FINISH);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Write failed, series is incomplete");
+    }
+    writer_free(w);
+    return ret;
+}
+
+// Read up to len bytes of block data, through inflate if the file is deflated
+static esp_err_t read_bytes(gorilla_reader_t *r, uint8_t *dst, size_t len, size_t *got)
+{
+    if (r->strm == NULL) {
+        *got = fread(dst, 1, len, r->source);
+        return ferror(r->source) ? ESP_FAIL : ESP_OK;
+    }
+
+    r->strm->next_out = dst;
+    r->strm->avail_out = len;
+    while (r->strm->avail_out > 0 && !r->ended) {
+        if (r->strm->avail_in == 0) {
+            r->strm->avail_in = fread(r->in, 1, IO_SIZE, r->source);
+            r->strm->next_in = r->in;
+            if (ferror(r->source)) {
+                return ESP_FAIL;
+            }
+            if (r->strm->avail_in == 0) {
+                break;
+            }
+        }
+        int ret = inflate(r->strm, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            r->ended = true;
+        } else if (ret != Z_OK) {
+            return ESP_ERR_INVALID_SIZE;
+        }
+    }
+    *got = len - r->strm->avail_out;
+    return ESP_OK;
+}
+
+static esp_err_t next_block(gorilla_reader_t *r)
+{
+    uint8_t header[BLOCK_HEADER_SIZE];
+    size_t got;
+
+    esp_err_t ret = read_bytes(r, header, BLOCK_HEADER_SIZE, &got);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    // A deflated series only ends cleanly at the end of its zlib stream
+    if (got == 0 && (r->strm == NULL || r->ended)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (got < BLOCK_HEADER_SIZE) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint16_t count = header[0] | header[1] << 8;
+    size_t len = header[2] | header[3] << 8;
+    if (count == 0 || len > r->block_size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    ret = read_bytes(r, r->block, len, &got);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (got < len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    br_init(&r->br, r->block, len);
+    r->count = count;
+    r->index = 0;
+    return ESP_OK;
+}
+
+esp_err_t gorilla_reader_open(FILE *source, gorilla_reader_t **out)
+{
+    esp_err_t ret = ESP_OK;
+    uint8_t header[HEADER_SIZE];
+
+    if (source == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (fread(header, 1, HEADER_SIZE, source) != HEADER_SIZE || memcmp(header, MAGIC, 4) != 0 ||
+        (header[4] & ~FLAG_DEFLATE) != 0) {
+        ESP_LOGE(TAG, "Not a time series file");
+        return ferror(source) ? ESP_FAIL : ESP_ERR_INVALID_SIZE;
+    }
+
+    gorilla_reader_t *r = (gorilla_reader_t *)calloc(1, sizeof(gorilla_reader_t));
+    if (r == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    r->source = source;
+    r->block_size = header[5] | header[6] << 8;
+
+    r->block = (uint8_t *)malloc(r->block_size);
+    if (r->block == NULL) {
+        ret = ESP_ERR_NO_MEM;
+        goto CLEANUP;
+    }
+
+    if (header[4] & FLAG_DEFLATE) {
+        r->strm = (z_stream *)calloc(1, sizeof(z_stream));
+        r->in = (uint8_t *)malloc(IO_SIZE);
+        if (r->strm == NULL || r->in == NULL) {
+            ret = ESP_ERR_NO_MEM;
+            goto CLEANUP;
+        }
+        // Window size from the zlib header
+        if (inflateInit2(r->strm, 0) != Z_OK) {
+            free(r->strm);
+            r->strm = NULL;
+            ret = ESP_ERR_NO_MEM;
+            goto CLEANUP;
+        }
+    }
+
+    *out = r;
+    return ESP_OK;
+
+CLEANUP:
+    gorilla_reader_close(r);
+    return ret;
+}
+
+esp_err_t gorilla_read(gorilla_reader_t *r, int64_t *ts, double *value)
+{
+    esp_err_t ret = ESP_OK;
+
+    if (r == NULL || ts == NULL || value == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (r->index == r->count) {
+        ret = next_block(r);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    if (r->index == 0) {
+        get_first(&r->br, &r->series);
+    } else {
+        get_timestamp(&r->br, &r->series);
+        ret = get_value(&r->br, &r->series);
+    }
+    if (ret != ESP_OK || r->br.overrun) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    r->index++;
+
+    *ts = r->series.ts;
+    memcpy(value, &r->series.value, sizeof(*value));
+    return ESP_OK;
+}
+
+void gorilla_reader_close(gorilla_reader_t *r)
+{
+    if (r == NULL) {
+        return;
+    }
+    if (r->strm != NULL) {
+        inflateEnd(r->strm);
+        free(r->strm);
+    }
+    free(r->in);
+    free(r->block);
+    free(r);
+}
@@ -0,0 +1,274 @@
+/*
+    Host benchmark for gorilla.h: 100K synthetic (int64 ms timestamp, double) samples of three
+    series, written raw and with deflate, against deflate_file() of the raw samples. Prints the
+    README table and the decode times; every series is read back and compared. Then reads a
+    truncated and a corrupted file and a series that is still being written after a flush.
+
+    Series:
+        temperature: 1 s interval, 0.1 C steps on a slow sine
+        power: 100 ms interval with a ms of jitter now and then, whole watts
+        accelerometer: 10 ms interval, float noise on a sine
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/gorilla/include -I$C/gorilla -I$C/zlib_utils/include -I$C/filter/include -I$C/probe/include -I$C/zlib/include -o gorilla_bench $C/gorilla/host/gorilla_bench.c $C/gorilla/gorilla.c $C/zlib_utils/zlib_utils.c $C/filter/filter.c $C/probe/probe.c $C/zlib/src/*.c -lm
+//   ./gorilla_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "esp_timer.h"
+
+#include "zlib.h"
+#include "gorilla.h"
+#include "zlib_utils.h"
+
+#define SAMPLES (100000)
+#define RAW_SIZE (SAMPLES * 16)
+#define TRUNCATE_AT (3000)
+#define CORRUPT_AT (500)
+
+typedef enum {
+    SERIES_TEMPERATURE,
+    SERIES_POWER,
+    SERIES_ACCELEROMETER,
+    SERIES_MAX,
+} series_t;
+
+static const char *s_series_names[] = {
+    "Temperature, 1 s, 0.1 C steps", "Power, 100 ms with jitter, whole W", "Accelerometer float, 10 ms",
+};
+
+static int64_t s_ts[SAMPLES];
+static double s_values[SAMPLES];
+
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void make_series(series_t series)
+{
+    int64_t ts = 1700000000000LL;
+
+    srand(11 + series);
+    for (size_t i = 0; i < SAMPLES; i++) {
+        switch (series) {
+        case SERIES_TEMPERATURE:
+            ts += 1000;
+            s_values[i] = round((21.5 + 2 * sin(i / 5000.0) + 0.05 * gauss()) * 10) / 10;
+            break;
+        case SERIES_POWER:
+            ts += 100 + (rand() % 5 == 0 ? rand() % 3 - 1 : 0);
+            s_values[i] = round(230 + 40 * sin(i / 800.0) + 2 * gauss());
+            break;
+        default:
+            ts += 10;
+            s_values[i] = (float)(0.3 * sin(i / 9.0) + 0.02 * gauss());
+            break;
+        }
+        s_ts[i] = ts;
+    }
+}
+
+static long file_size(FILE *f)
+{
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    return size;
+}
+
+// Samples read back until the reader stops; *end gets the error it stopped with, *bad the mismatches
+static size_t read_back(FILE *f, esp_err_t *end, int *bad)
+{
+    gorilla_reader_t *r;
+    int64_t ts;
+    double value;
+    size_t n = 0;
+
+    rewind(f);
+    *bad = 0;
+    *end = gorilla_reader_open(f, &r);
+    if (*end != ESP_OK) {
+        return 0;
+    }
+    while ((*end = gorilla_read(r, &ts, &value)) == ESP_OK) {
+        if (n >= SAMPLES || ts != s_ts[n] || memcmp(&value, &s_values[n], sizeof(double)) != 0) {
+            (*bad)++;
+        }
+        n++;
+    }
+    gorilla_reader_close(r);
+    return n;
+}
+
+// Ratio, encode and decode time of one series; 0 on failure or mismatch
+static double run_gorilla(bool deflate, double *enc_ms, double *dec_ms)
+{
+    FILE *f = tmpfile();
+    gorilla_writer_t *w;
+    esp_err_t end;
+    double ratio = 0;
+    int bad;
+
+    if (f == NULL) {
+        return 0;
+    }
+    int64_t start = esp_timer_get_time();
+    if (gorilla_writer_open(f, deflate, &w) != ESP_OK) {
+        goto CLEANUP;
+    }
+    for (size_t i = 0; i < SAMPLES; i++) {
+        gorilla_write(w, s_ts[i], s_values[i]);
+    }
+    if (gorilla_writer_close(w) != ESP_OK) {
+        goto CLEANUP;
+    }
+    fflush(f);
+    *enc_ms = (esp_timer_get_time() - start) / 1000.0;
+
+    start = esp_timer_get_time();
+    size_t n = read_back(f, &end, &bad);
+    *dec_ms = (esp_timer_get_time() - start) / 1000.0;
+    if (n == SAMPLES && end == ESP_ERR_NOT_FOUND && bad == 0) {
+        ratio = (double)RAW_SIZE / file_size(f);
+    }
+
+CLEANUP:
+    fclose(f);
+    return ratio;
+}
+
+static double run_deflate_file(double *ms)
+{
+    FILE *raw = tmpfile(), *gz = tmpfile();
+    double ratio = 0;
+
+    if (raw == NULL || gz == NULL) {
+        goto CLEANUP;
+    }
+    for (size_t i = 0; i < SAMPLES; i++) {
+        fwrite(&s_ts[i], sizeof(int64_t), 1, raw);
+        fwrite(&s_values[i], sizeof(double), 1, raw);
+    }
+    rewind(raw);
+    int64_t start = esp_timer_get_time();
+    if (deflate_file(raw, gz) == Z_OK) {
+        *ms = (esp_timer_get_time() - start) / 1000.0;
+        ratio = (double)RAW_SIZE / file_size(gz);
+    }
+
+CLEANUP:
+    if (raw) {
+        fclose(raw);
+    }
+    if (gz) {
+        fclose(gz);
+    }
+    return ratio;
+}
+
+// Copy of the first len bytes of src, with count bytes of 0xff at offset when count > 0
+static FILE *damaged_copy(FILE *src, long len, long offset, int count)
+{
+    FILE *f = tmpfile();
+    uint8_t *buf = (uint8_t *)malloc(len);
+
+    if (f == NULL || buf == NULL) {
+        free(buf);
+        return f;
+    }
+    rewind(src);
+    len = fread(buf, 1, len, src);
+    if (count > 0 && offset + count <= len) {
+        memset(buf + offset, 0xff, count);
+    }
+    fwrite(buf, 1, len, f);
+    fflush(f);
+    free(buf);
+    return f;
+}
+
+// Damaged and unfinished files must end in an error, never in a crash or extra samples
+static int check_damage(void)
+{
+    FILE *f = tmpfile();
+    gorilla_writer_t *w;
+    esp_err_t end;
+    int bad, fail = 0;
+
+    make_series(SERIES_POWER);
+    if (f == NULL || gorilla_writer_open(f, true, &w) != ESP_OK) {
+        return 1;
+    }
+    for (size_t i = 0; i < SAMPLES; i++) {
+        gorilla_write(w, s_ts[i], s_values[i]);
+    }
+    gorilla_writer_close(w);
+    fflush(f);
+    long size = file_size(f);
+
+    FILE *damaged[2] = { damaged_copy(f, TRUNCATE_AT, 0, 0), damaged_copy(f, size, CORRUPT_AT, 3) };
+    const char *names[2] = { "truncated", "corrupted" };
+    for (int i = 0; i < 2; i++) {
+        size_t n = read_back(damaged[i], &end, &bad);
+        bool ok = end != ESP_OK && end != ESP_ERR_NOT_FOUND && n < SAMPLES;
+        printf("%s: %u samples read, %s, %s\n", names[i], (unsigned)n, esp_err_to_name(end), ok ? "ok" : "FAILED");
+        fail |= !ok;
+        fclose(damaged[i]);
+    }
+    fclose(f);
+
+    // Flushed but still open: everything so far reads back, then ESP_ERR_INVALID_SIZE
+    f = tmpfile();
+    if (f == NULL || gorilla_writer_open(f, true, &w) != ESP_OK) {
+        return 1;
+    }
+    for (size_t i = 0; i < 1000; i++) {
+        gorilla_write(w, s_ts[i], s_values[i]);
+    }
+    gorilla_writer_flush(w);
+    fflush(f);
+    size_t n = read_back(f, &end, &bad);
+    bool ok = n == 1000 && bad == 0 && end == ESP_ERR_INVALID_SIZE;
+    printf("flushed, still open: %u samples read, %s, %s\n", (unsigned)n, esp_err_to_name(end), ok ? "ok" : "FAILED");
+    fail |= !ok;
+    gorilla_writer_close(w);
+    fclose(f);
+    return fail;
+}
+
+int main(void)
+{
+    double dec_ms[SERIES_MAX][2];
+    int fail = 0;
+
+    printf("| Series | deflate_file | Gorilla | Gorilla + deflate |\n");
+    printf("| --- | --- | --- | --- |\n");
+    for (series_t s = 0; s < SERIES_MAX; s++) {
+        double ms[3], ratio[3];
+        make_series(s);
+        ratio[0] = run_deflate_file(&ms[0]);
+        ratio[1] = run_gorilla(false, &ms[1], &dec_ms[s][0]);
+        ratio[2] = run_gorilla(true, &ms[2], &dec_ms[s][1]);
+        fail |= ratio[0] == 0 || ratio[1] == 0 || ratio[2] == 0;
+        printf("| %s | %.2fx, %.0f ms | %.3gx, %.1f ms | %.3gx, %.0f ms |\n", s_series_names[s],
+               ratio[0], ms[0], ratio[1], ms[1], ratio[2], ms[2]);
+    }
+    printf("\nDecoding, raw / with inflate:");
+    for (series_t s = 0; s < SERIES_MAX; s++) {
+        printf(" %.1f / %.1f ms", dec_ms[s][0], dec_ms[s][1]);
+    }
+    printf("\n\n");
+    if (fail) {
+        printf("round trip FAILED (0x above)\n");
+    }
+
+    fail |= check_damage();
+    return fail;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Time series codec for (timestamp, value) samples, after Facebook's Gorilla (VLDB 2015).
+    Timestamps are stored as the change of the interval between samples in a 1 to 68 bit
+    prefix code, so a fixed sample rate costs one bit per timestamp. Values are XORed with
+    the previous one and only the bits that changed are kept, reusing the previous window
+    of changed bits when it still fits.
+
+    Samples go into blocks of up to CONFIG_GORILLA_BLOCK_SIZE bytes that start over from a
+    full timestamp and value. The blocks can be deflated on the way out (one zlib stream for
+    the whole file) for series that repeat over longer stretches.
+*/
+
+#define GORILLA_BLOCK_SIZE (CONFIG_GORILLA_BLOCK_SIZE)
+
+typedef struct gorilla_writer gorilla_writer_t;
+typedef struct gorilla_reader gorilla_reader_t;
+
+typedef struct {
+    uint32_t samples;
+    uint32_t blocks;
+    size_t bytes_out;       // Written to the file so far, header included
+} gorilla_stats_t;
+
+// Start a series in dest; with deflate, blocks go through a zlib stream (CONFIG_WINDOW_SIZE, CONFIG_MEM_LEVEL)
+esp_err_t gorilla_writer_open(FILE *dest, bool deflate, gorilla_writer_t **out);
+
+esp_err_t gorilla_write(gorilla_writer_t *w, int64_t ts, double value);
+
+/*
+    End the current block (and sync flush the deflate stage) so everything written can be read back.
+    A reader of a deflated series still being written gets ESP_ERR_INVALID_SIZE after the last sample.
+*/
+esp_err_t gorilla_writer_flush(gorilla_writer_t *w);
+
+void gorilla_writer_get_stats(const gorilla_writer_t *w, gorilla_stats_t *stats);
+
+// Flush and free the writer; dest stays open
+esp_err_t gorilla_writer_close(gorilla_writer_t *w);
+
+esp_err_t gorilla_reader_open(FILE *source, gorilla_reader_t **out);
+
+// Next sample; ESP_ERR_NOT_FOUND after the last one, ESP_ERR_INVALID_SIZE on a truncated or corrupt file
+esp_err_t gorilla_read(gorilla_reader_t *r, int64_t *ts, double *value);
+
+void gorilla_reader_close(gorilla_reader_t *r);
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+/*
+    Streaming LZSS codec for tiny heap budgets (heatshrink-style bit format).
+    Literal:  1 + 8 bits
+    Backref:  0 + LZSS_WINDOW_BITS (distance - 1) + LZSS_LOOKAHEAD_BITS (length - 1)
+    All state lives in the encoder/decoder structs; nothing is allocated.
+    With the default 256 byte window the encoder needs ~530 bytes, the decoder ~300 bytes.
+*/
+
+#define LZSS_WINDOW_BITS (CONFIG_LZSS_WINDOW_BITS)
+#define LZSS_LOOKAHEAD_BITS (CONFIG_LZSS_LOOKAHEAD_BITS)
+#define LZSS_WINDOW_SIZE (1 << LZSS_WINDOW_BITS)
+#define LZSS_LOOKAHEAD_SIZE (1 << LZSS_LOOKAHEAD_BITS)
+#define LZSS_DECODER_INPUT_SIZE (CONFIG_LZSS_DECODER_INPUT_SIZE)
+
+_Static_assert(LZSS_LOOKAHEAD_BITS < LZSS_WINDOW_BITS, "LZSS lookahead must be smaller than the window");
+
+typedef enum {
+    LZSS_OK = 0,        // Sink: input accepted
+    LZSS_FULL,          // Sink: no room, poll first
+    LZSS_MORE,          // Poll: output buffer filled, poll again / Finish: data pending, poll
+    LZSS_EMPTY,         // Poll: all available input processed, sink more
+    LZSS_DONE,          // Finish: stream complete
+    LZSS_ERROR_NULL,    // Invalid argument
+} lzss_res_t;
+
+typedef struct {
+    uint16_t input_size;        // Bytes waiting in the input half of buffer
+    uint16_t scan;              // Next input byte to encode
+    uint16_t history;           // Valid bytes in the window half of buffer
+    uint8_t bit_count;          // Bits queued in bit_buf
+    bool finishing;
+    uint32_t bit_buf;
+    uint8_t buffer[2 * LZSS_WINDOW_SIZE];   // Window, then input
+} lzss_encoder_t;
+
+typedef enum {
+    LZSS_DEC_TAG,
+    LZSS_DEC_LITERAL,
+    LZSS_DEC_INDEX,
+    LZSS_DEC_COUNT,
+    LZSS_DEC_BACKREF,
+} lzss_dec_state_t;
+
+typedef struct {
+    uint16_t input_size;
+    uint16_t input_index;
+    uint16_t head;              // Next write position in window
+    uint16_t index;             // Backref distance - 1
+    uint16_t count;             // Backref bytes left to copy
+    uint8_t bit_count;
+    uint8_t state;
+    uint32_t bit_buf;
+    uint8_t input[LZSS_DECODER_INPUT_SIZE];
+    uint8_t window[LZSS_WINDOW_SIZE];
+} lzss_decoder_t;
+
+void lzss_encoder_reset(lzss_encoder_t *enc);
+
+// Copy up to size bytes into the encoder; *input_size receives the bytes taken
+lzss_res_t lzss_encoder_sink(lzss_encoder_t *enc, const uint8_t *in, size_t size, size_t *input_size);
+
+// Produce compressed bytes; LZSS_MORE while output is pending, LZSS_EMPTY when input is needed
+lzss_res_t lzss_encoder_poll(lzss_encoder_t *enc, uint8_t *out, size_t out_size, size_t *output_size);
+
+// Mark end of input; returns LZSS_MORE until everything has been polled
+lzss_res_t lzss_encoder_finish(lzss_encoder_t *enc);
+
+void lzss_decoder_reset(lzss_decoder_t *dec);
+
+lzss_res_t lzss_decoder_sink(lzss_decoder_t *dec, const uint8_t *in, size_t size, size_t *input_size);
+
+lzss_res_t lzss_decoder_poll(lzss_decoder_t *dec, uint8_t *out, size_t out_size, size_t *output_size);
+
+lzss_res_t lzss_decoder_finish(lzss_decoder_t *dec);
+
+// File helpers with caller-provided state and small stack buffers
+esp_err_t lzss_compress_file(lzss_encoder_t *enc, FILE *source, FILE *dest);
+
+esp_err_t lzss_decompress_file(lzss_decoder_t *dec, FILE *source, FILE *dest);
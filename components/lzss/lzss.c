@@ -0,0 +1,394 @@
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "lzss.h"
+
+#define WINDOW_MASK (LZSS_WINDOW_SIZE - 1)
+#define BACKREF_BITS (1 + LZSS_WINDOW_BITS + LZSS_LOOKAHEAD_BITS)
+#define LITERAL_BITS (1 + 8)
+// Shortest match that is cheaper as a backref than as literals
+#define MIN_BACKREF (BACKREF_BITS / LITERAL_BITS + 1)
+#define FILE_CHUNK (64)
+
+static const char *TAG = "lzss";
+
+/* Encoder */
+
+static inline void push_bits(lzss_encoder_t *enc, uint32_t value, uint8_t count)
+{
+    enc->bit_buf = (enc->bit_buf << count) | (value & ((1u << count) - 1));
+    enc->bit_count += count;
+}
+
+// Move consumed input into the window half so the input half can be refilled
+static void slide(lzss_encoder_t *enc)
+{
+    uint16_t shift = enc->scan;
+
+    if (shift == 0) {
+        return;
+    }
+
+    memmove(enc->buffer, enc->buffer + shift, LZSS_WINDOW_SIZE + enc->input_size - shift);
+    enc->history = enc->history + shift > LZSS_WINDOW_SIZE ? LZSS_WINDOW_SIZE : enc->history + shift;
+    enc->input_size -= shift;
+    enc->scan = 0;
+}
+
+static void encode_step(lzss_encoder_t *enc, size_t avail)
+{
+    const uint8_t *cur = enc->buffer + LZSS_WINDOW_SIZE + enc->scan;
+    size_t max_len = avail < LZSS_LOOKAHEAD_SIZE ? avail : LZSS_LOOKAHEAD_SIZE;
+    size_t max_dist = enc->history + enc->scan;
+    size_t best_len = 0, best_dist = 0;
+
+    if (max_dist > LZSS_WINDOW_SIZE) {
+        max_dist = LZSS_WINDOW_SIZE;
+    }
+
+    // Brute-force search, nearest first; the window is small enough for this to be cheap
+    for (size_t dist = 1; dist <= max_dist; dist++) {
+        const uint8_t *cand = cur - dist;
+        if (cand[0] != cur[0] || cand[best_len] != cur[best_len]) {
+            continue;
+        }
+
+        size_t len = 0;
+        while (len < max_len && cand[len] == cur[len]) {
+            len++;
+        }
+        if (len > best_len) {
+            best_len = len;
+            best_dist = dist;
+            if (len == max_len) {
+                break;
+            }
+        }
+    }
+
+    if (best_len >= MIN_BACKREF) {
+        push_bits(enc, 0, 1);
+        push_bits(enc, best_dist - 1, LZSS_WINDOW_BITS);
+        push_bits(enc, best_len - 1, LZSS_LOOKAHEAD_BITS);
+        enc->scan += best_len;
+    } else {
+        push_bits(enc, 1, 1);
+        push_bits(enc, *cur, 8);
+        enc->scan++;
+    }
+}
+
+void lzss_encoder_reset(lzss_encoder_t *enc)
+{
+    memset(enc, 0, sizeof(lzss_encoder_t));
+}
+
+lzss_res_t lzss_encoder_sink(lzss_encoder_t *enc, const uint8_t *in, size_t size, size_t *input_size)
+{
+    if (enc == NULL || in == NULL || input_size == NULL || enc->finishing) {
+        return LZSS_ERROR_NULL;
+    }
+
+    size_t room = LZSS_WINDOW_SIZE - enc->input_size;
+    if (room == 0) {
+        *input_size = 0;
+        return LZSS_FULL;
+    }
+
+    size_t count = size < room ? size : room;
+    memcpy(enc->buffer + LZSS_WINDOW_SIZE + enc->input_size, in, count);
+    enc->input_size += count;
+    *input_size = count;
+    return LZSS_OK;
+}
+
+lzss_res_t lzss_encoder_poll(lzss_encoder_t *enc, uint8_t *out, size_t out_size, size_t *output_size)
+{
+    size_t op = 0;
+
+    if (enc == NULL || out == NULL || output_size == NULL) {
+        return LZSS_ERROR_NULL;
+    }
+
+    for (;;) {
+        while (enc->bit_count >= 8) {
+            if (op == out_size) {
+                *output_size = op;
+                return LZSS_MORE;
+            }
+            out[op++] = (uint8_t)(enc->bit_buf >> (enc->bit_count - 8));
+            enc->bit_count -= 8;
+        }
+
+        size_t avail = enc->input_size - enc->scan;
+
+        // Keep a full lookahead buffered unless the stream is ending
+        if (avail == 0 || (!enc->finishing && avail < LZSS_LOOKAHEAD_SIZE)) {
+            if (!enc->finishing) {
+                slide(enc);
+            } else if (enc->bit_count > 0) {
+                // Zero padding is shorter than any symbol, the decoder ignores it
+                if (op == out_size) {
+                    *output_size = op;
+                    return LZSS_MORE;
+                }
+                out[op++] = (uint8_t)(enc->bit_buf << (8 - enc->bit_count));
+                enc->bit_count = 0;
+            }
+            *output_size = op;
+            return LZSS_EMPTY;
+        }
+
+        encode_step(enc, avail);
+    }
+}
+
+lzss_res_t lzss_encoder_finish(lzss_encoder_t *enc)
+{
+    if (enc == NULL) {
+        return LZSS_ERROR_NULL;
+    }
+
+    enc->finishing = true;
+    return (enc->scan == enc->input_size && enc->bit_count == 0) ? LZSS_DONE : LZSS_MORE;
+}
+
+/* Decoder */
+
+static void refill(lzss_decoder_t *dec)
+{
+    while (dec->bit_count <= 24 && dec->input_index < dec->input_size) {
+        dec->bit_buf = (dec->bit_buf << 8) | dec->input[dec->input_index++];
+        dec->bit_count += 8;
+    }
+}
+
+// Returns -1 without consuming anything when fewer than count bits are buffered
+static int32_t get_bits(lzss_decoder_t *dec, uint8_t count)
+{
+    refill(dec);
+    if (dec->bit_count < count) {
+        return -1;
+    }
+
+    dec->bit_count -= count;
+    return (dec->bit_buf >> dec->bit_count) & ((1u << count) - 1);
+}
+
+static inline void emit(lzss_decoder_t *dec, uint8_t *out, size_t *op, uint8_t c)
+{
+    out[(*op)++] = c;
+    dec->window[dec->head] = c;
+    dec->head = (dec->head + 1) & WINDOW_MASK;
+}
+
+void lzss_decoder_reset(lzss_decoder_t *dec)
+{
+    memset(dec, 0, sizeof(lzss_decoder_t));
+    dec->state = LZSS_DEC_TAG;
+}
+
+lzss_res_t lzss_decoder_sink(lzss_decoder_t *dec, const uint8_t *in, size_t size, size_t *input_size)
+{
+    if (dec == NULL || in == NULL || input_size == NULL) {
+        return LZSS_ERROR_NULL;
+    }
+
+    if (dec->input_index > 0) {
+        memmove(dec->input, dec->input + dec->input_index, dec->input_size - dec->input_index);
+        dec->input_size -= dec->input_index;
+        dec->input_index = 0;
+    }
+
+    size_t room = LZSS_DECODER_INPUT_SIZE - dec->input_size;
+    if (room == 0) {
+        *input_size = 0;
+        return LZSS_FULL;
+    }
+
+    size_t count = size < room ? size : room;
+    memcpy(dec->input + dec->input_size, in, count);
+    dec->input_size += count;
+    *input_size = count;
+    return LZSS_OK;
+}
+
+lzss_res_t lzss_decoder_poll(lzss_decoder_t *dec, uint8_t *out, size_t out_size, size_t *output_size)
+{
+    size_t op = 0;
+    int32_t v;
+
+    if (dec == NULL || out == NULL || output_size == NULL) {
+        return LZSS_ERROR_NULL;
+    }
+
+    for (;;) {
+        switch (dec->state) {
+        case LZSS_DEC_TAG:
+            if ((v = get_bits(dec, 1)) < 0) {
+                goto EMPTY;
+            }
+            dec->state = v ? LZSS_DEC_LITERAL : LZSS_DEC_INDEX;
+            break;
+
+        case LZSS_DEC_LITERAL:
+            if (op == out_size) {
+                goto MORE;
+            }
+            if ((v = get_bits(dec, 8)) < 0) {
+                goto EMPTY;
+            }
+            emit(dec, out, &op, (uint8_t)v);
+            dec->state = LZSS_DEC_TAG;
+            break;
+
+        case LZSS_DEC_INDEX:
+            if ((v = get_bits(dec, LZSS_WINDOW_BITS)) < 0) {
+                goto EMPTY;
+            }
+            dec->index = v;
+            dec->state = LZSS_DEC_COUNT;
+            break;
+
+        case LZSS_DEC_COUNT:
+            if ((v = get_bits(dec, LZSS_LOOKAHEAD_BITS)) < 0) {
+                goto EMPTY;
+            }
+            dec->count = v + 1;
+            dec->state = LZSS_DEC_BACKREF;
+            break;
+
+        case LZSS_DEC_BACKREF:
+            while (dec->count > 0) {
+                if (op == out_size) {
+                    goto MORE;
+                }
+                emit(dec, out, &op, dec->window[(dec->head - dec->index - 1) & WINDOW_MASK]);
+                dec->count--;
+            }
+            dec->state = LZSS_DEC_TAG;
+            break;
+        }
+    }
+
+MORE:
+    *output_size = op;
+    return LZSS_MORE;
+
+EMPTY:
+    *output_size = op;
+    return LZSS_EMPTY;
+}
+
+lzss_res_t lzss_decoder_finish(lzss_decoder_t *dec)
+{
+    uint8_t needed;
+
+    if (dec == NULL) {
+        return LZSS_ERROR_NULL;
+    }
+
+    refill(dec);
+
+    // Leftover bits that cannot form a whole symbol are the encoder's padding
+    switch (dec->state) {
+    case LZSS_DEC_TAG:
+        if (dec->bit_count == 0) {
+            return LZSS_DONE;
+        }
+        needed = (dec->bit_buf >> (dec->bit_count - 1)) & 1 ? LITERAL_BITS : BACKREF_BITS;
+        break;
+    case LZSS_DEC_LITERAL:
+        needed = 8;
+        break;
+    case LZSS_DEC_INDEX:
+        needed = LZSS_WINDOW_BITS + LZSS_LOOKAHEAD_BITS;
+        break;
+    case LZSS_DEC_COUNT:
+        needed = LZSS_LOOKAHEAD_BITS;
+        break;
+    default:
+        return dec->count > 0 ? LZSS_MORE : LZSS_DONE;
+    }
+
+    return dec->bit_count >= needed ? LZSS_MORE : LZSS_DONE;
+}
+
+/* File helpers */
+
+esp_err_t lzss_compress_file(lzss_encoder_t *enc, FILE *source, FILE *dest)
+{
+    uint8_t in[FILE_CHUNK], out[FILE_CHUNK];
+    size_t n, taken, have;
+    lzss_res_t res;
+
+    if (enc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Initiated Compression");
+    lzss_encoder_reset(enc);
+
+    while ((n = fread(in, 1, sizeof(in), source)) > 0) {
+        for (size_t off = 0; off < n; off += taken) {
+            lzss_encoder_sink(enc, in + off, n - off, &taken);
+            do {
+                res = lzss_encoder_poll(enc, out, sizeof(out), &have);
+                if (fwrite(out, 1, have, dest) != have) {
+                    return ESP_FAIL;
+                }
+            } while (res == LZSS_MORE);
+        }
+    }
+    if (ferror(source)) {
+        return ESP_FAIL;
+    }
+
+    while (lzss_encoder_finish(enc) == LZSS_MORE) {
+        lzss_encoder_poll(enc, out, sizeof(out), &have);
+        if (fwrite(out, 1, have, dest) != have) {
+            return ESP_FAIL;
+        }
+    }
+
+    return ferror(dest) ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t lzss_decompress_file(lzss_decoder_t *dec, FILE *source, FILE *dest)
+{
+    uint8_t in[FILE_CHUNK], out[FILE_CHUNK];
+    size_t n, taken, have;
+    lzss_res_t res;
+
+    if (dec == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ESP_LOGI(TAG, "Initiated Decompression");
+    lzss_decoder_reset(dec);
+
+    while ((n = fread(in, 1, sizeof(in), source)) > 0) {
+        for (size_t off = 0; off < n; off += taken) {
+            lzss_decoder_sink(dec, in + off, n - off, &taken);
+            do {
+                res = lzss_decoder_poll(dec, out, sizeof(out), &have);
+                if (fwrite(out, 1, have, dest) != have) {
+                    return ESP_FAIL;
+                }
+            } while (res == LZSS_MORE);
+        }
+    }
+    if (ferror(source)) {
+        return ESP_FAIL;
+    }
+
+    while (lzss_decoder_finish(dec) == LZSS_MORE) {
+        lzss_decoder_poll(dec, out, sizeof(out), &have);
+        if (fwrite(out, 1, have, dest) != have) {
+            return ESP_FAIL;
+        }
+    }
+
+    return ferror(dest) ? ESP_FAIL : ESP_OK;
+}
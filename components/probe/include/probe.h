@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+    Compressibility probe: a greedy LZ77 parse over a short prefix with an
+    order-0 entropy estimate of the remaining literals, similar to the check
+    the Brotli encoder runs before emitting a meta-block (ShouldCompress).
+    Costs one pass over at most CONFIG_PROBE_SAMPLE_SIZE bytes and ~1.5K of stack,
+    much less than deflating data that turns out to be already compressed or encrypted.
+
+    Callers probe once, at the start: the level chosen from the prefix holds for the whole
+    stream, so a file with an incompressible header (e.g. an embedded JPEG thumbnail) is stored
+    end to end. Data whose compressibility changes along the way is better served by
+    blockpack.h or the blocked gzip writer, which probe every block.
+*/
+
+#define PROBE_SAMPLE_SIZE (CONFIG_PROBE_SAMPLE_SIZE)
+
+typedef enum {
+    PROBE_COMPRESS,     // Compress as configured
+    PROBE_FAST,         // Little to gain: use the fastest level
+    PROBE_STORE,        // Nothing to gain: store raw
+} probe_verdict_t;
+
+typedef struct {
+    size_t sampled;         // Bytes examined
+    size_t matched;         // Sampled bytes covered by repeats of 4 bytes or more
+    unsigned entropy;       // Literal entropy in 1/100 bits per byte
+    unsigned ratio;         // Predicted compressed size, percent of the input
+} probe_result_t;
+
+void probe_run(const void *data, size_t len, probe_result_t *res);
+
+// Verdict for a result against CONFIG_PROBE_STORE_RATIO / CONFIG_PROBE_FAST_RATIO
+probe_verdict_t probe_verdict(const probe_result_t *res);
+
+// probe_run() + probe_verdict()
+probe_verdict_t probe_data(const void *data, size_t len);
@@ -0,0 +1,105 @@
+#include <string.h>
+#include <math.h>
+
+#include "sdkconfig.h"
+#include "probe.h"
+
+#define HASH_LOG (9)
+#define MIN_MATCH (4)
+#define MAX_MATCH (258)
+#define MATCH_BITS (20)     // Typical cost of a deflate length/distance pair
+#define MIN_SAMPLE (16)     // Below this, framing overhead outweighs any gain
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint32_t hash4(uint32_t v)
+{
+    return (v * 2654435761u) >> (32 - HASH_LOG);
+}
+
+void probe_run(const void *data, size_t len, probe_result_t *res)
+{
+    const uint8_t *src = (const uint8_t *)data;
+    uint16_t histo[256] = { 0 };
+    uint16_t last[1 << HASH_LOG];   // Position + 1 of the last occurrence, 0 if none
+    size_t literals = 0, matches = 0;
+    size_t i = 0;
+
+    if (len > PROBE_SAMPLE_SIZE) {
+        len = PROBE_SAMPLE_SIZE;
+    }
+    memset(res, 0, sizeof(probe_result_t));
+    res->sampled = len;
+    if (len < MIN_SAMPLE) {
+        res->entropy = 800;
+        res->ratio = 100;
+        return;
+    }
+
+    memset(last, 0, sizeof(last));
+    while (i < len) {
+        if (i + MIN_MATCH <= len) {
+            uint32_t v = read32(src + i);
+            uint32_t h = hash4(v);
+            size_t cand = last[h];
+            last[h] = (uint16_t)(i + 1);
+
+            if (cand > 0 && read32(src + cand - 1) == v) {
+                size_t n = MIN_MATCH;
+                while (i + n < len && n < MAX_MATCH && src[cand - 1 + n] == src[i + n]) {
+                    n++;
+                }
+                res->matched += n;
+                matches++;
+                i += n;
+                continue;
+            }
+        }
+        histo[src[i++]]++;
+        literals++;
+    }
+
+    // Order-0 entropy of the literals with the Miller-Madow small sample correction
+    float bits = 0;
+    unsigned symbols = 0;
+    for (int s = 0; s < 256; s++) {
+        if (histo[s]) {
+            bits -= histo[s] * log2f((float)histo[s] / literals);
+            symbols++;
+        }
+    }
+    if (symbols > 1) {
+        bits += (symbols - 1) / (2 * (float)M_LN2);
+    }
+    if (literals > 0 && bits > 8.0f * literals) {
+        bits = 8.0f * literals;
+    }
+
+    res->entropy = literals ? (unsigned)(bits * 100 / literals) : 0;
+    bits += (float)matches * MATCH_BITS;
+    res->ratio = (unsigned)(bits * 100 / (8.0f * len) + 0.5f);
+}
+
+probe_verdict_t probe_verdict(const probe_result_t *res)
+{
+    if (res->ratio >= CONFIG_PROBE_STORE_RATIO) {
+        return PROBE_STORE;
+    }
+    if (res->ratio >= CONFIG_PROBE_FAST_RATIO) {
+        return PROBE_FAST;
+    }
+    return PROBE_COMPRESS;
+}
+
+probe_verdict_t probe_data(const void *data, size_t len)
+{
+    probe_result_t res;
+
+    probe_run(data, len, &res);
+    return probe_verdict(&res);
+}
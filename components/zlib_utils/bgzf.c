@@ -0,0 +1,432 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "zlib.h"
+#include "probe.h"
+#include "bgzf.h"
+
+// Same settings as deflate_file; zlib rejects raw deflate with a window of 8
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+#define MEM_LEVEL (CONFIG_MEM_LEVEL)
+#define COMPRESSION_LEVEL (CONFIG_COMPRESSION_LEVEL)
+
+#define HEADER_SIZE (BGZF_HEADER_SIZE)   // gzip header with the 6 byte "BC" extra field
+#define TRAILER_SIZE (8)                // CRC-32, ISIZE
+#define INDEX_GROW (64)
+
+static const char *TAG = "bgzf";
+
+// gzip header, FEXTRA set, OS unknown, extra field "BC" of length 2 holding the member size - 1
+static const unsigned char bgzf_header[HEADER_SIZE - 2] = {
+    0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0
+};
+
+static const unsigned char bgzf_eof[HEADER_SIZE + 2 + TRAILER_SIZE] = {
+    0x1f, 0x8b, 0x08, 0x04, 0, 0, 0, 0, 0, 0xff, 6, 0, 'B', 'C', 2, 0, 0x1b, 0, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+typedef struct {
+    long coffset;           // Member offset in the file
+    size_t uoffset;         // Uncompressed offset of its first byte
+    unsigned csize;         // Member size, header and trailer included
+    unsigned usize;
+} bgzf_entry_t;
+
+struct bgzf_index {
+    bgzf_entry_t *entries;
+    size_t count;
+    size_t size;
+};
+
+struct bgzf_writer {
+    z_stream strm;
+    size_t block;           // Largest input per member
+    unsigned char *out;     // One member
+    size_t out_size;
+};
+
+typedef struct {
+    unsigned char *in;      // Whole member
+    unsigned csize;
+    unsigned char *out;     // BGZF_MAX_MEMBER bytes
+    unsigned usize;
+    int ret;
+} bgzf_job_t;
+
+static inline void put_u16(unsigned char *p, unsigned v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+}
+
+static inline void put_u32(unsigned char *p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static inline unsigned get_u16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const unsigned char *p)
+{
+    return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+int bgzf_writer_create(size_t block_size, bgzf_writer_t **out)
+{
+    bgzf_writer_t *w = (bgzf_writer_t *)calloc(1, sizeof(bgzf_writer_t));
+    if (w == NULL) {
+        return Z_MEM_ERROR;
+    }
+
+    if (deflateInit2(&w->strm, COMPRESSION_LEVEL, Z_DEFLATED, -WINDOW_BITS, MEM_LEVEL, Z_DEFAULT_STRATEGY) != Z_OK) {
+        free(w);
+        return Z_MEM_ERROR;
+    }
+
+    // Small windows and memory levels emit more block headers, so their members take less input
+    w->block = block_size < BGZF_BLOCK_SIZE ? block_size : BGZF_BLOCK_SIZE;
+    while (deflateBound(&w->strm, w->block) > BGZF_MAX_MEMBER - HEADER_SIZE - TRAILER_SIZE) {
+        w->block -= 256;
+    }
+    w->out_size = HEADER_SIZE + deflateBound(&w->strm, w->block) + TRAILER_SIZE;
+
+    w->out = (unsigned char *)malloc(w->out_size);
+    if (w->out == NULL) {
+        bgzf_writer_free(w);
+        return Z_MEM_ERROR;
+    }
+
+    *out = w;
+    return Z_OK;
+}
+
+size_t bgzf_writer_block(const bgzf_writer_t *w)
+{
+    return w->block;
+}
+
+int bgzf_write(bgzf_writer_t *w, const unsigned char *in, size_t len, FILE *dest, size_t *written)
+{
+    probe_result_t res;
+
+    if (written != NULL) {
+        *written = 0;
+    }
+
+    while (len > 0) {
+        size_t have = len < w->block ? len : w->block;
+
+        // Members are independent, so each one gets its own level
+        probe_run(in, have, &res);
+        deflateReset(&w->strm);
+        deflateParams(&w->strm, probe_verdict(&res) == PROBE_STORE ? Z_NO_COMPRESSION : COMPRESSION_LEVEL,
+                      Z_DEFAULT_STRATEGY);
+
+        w->strm.next_in = (z_const Bytef *)in;
+        w->strm.avail_in = have;
+        w->strm.next_out = w->out + HEADER_SIZE;
+        w->strm.avail_out = w->out_size - HEADER_SIZE - TRAILER_SIZE;
+
+        if (deflate(&w->strm, Z_FINISH) != Z_STREAM_END) {
+            return Z_BUF_ERROR;
+        }
+
+        size_t csize = HEADER_SIZE + w->strm.total_out + TRAILER_SIZE;
+        memcpy(w->out, bgzf_header, sizeof(bgzf_header));
+        put_u16(w->out + HEADER_SIZE - 2, csize - 1);
+        put_u32(w->out + csize - TRAILER_SIZE, crc32(0, in, have));
+        put_u32(w->out + csize - 4, have);
+
+        if (fwrite(w->out, 1, csize, dest) != csize || ferror(dest)) {
+            return Z_ERRNO;
+        }
+
+        if (written != NULL) {
+            *written += csize;
+        }
+        in += have;
+        len -= have;
+    }
+    return Z_OK;
+}
+
+int bgzf_write_eof(FILE *dest)
+{
+    return fwrite(bgzf_eof, 1, sizeof(bgzf_eof), dest) == sizeof(bgzf_eof) ? Z_OK : Z_ERRNO;
+}
+
+void bgzf_writer_free(bgzf_writer_t *w)
+{
+    if (w == NULL) {
+        return;
+    }
+    (void)deflateEnd(&w->strm);
+    free(w->out);
+    free(w);
+}
+
+int bgzf_deflate_file(FILE *source, FILE *dest)
+{
+    int ret;
+    size_t have;
+    bgzf_writer_t *w;
+
+    ret = bgzf_writer_create(BGZF_BLOCK_SIZE, &w);
+    if (ret != Z_OK) {
+        return ret;
+    }
+
+    unsigned char *in = (unsigned char *)malloc(w->block);
+    if (in == NULL) {
+        bgzf_writer_free(w);
+        return Z_MEM_ERROR;
+    }
+
+    ESP_LOGI(TAG, "Initiated Compression, %u byte members", (unsigned)w->block);
+
+    while ((have = fread(in, 1, w->block, source)) > 0) {
+        ret = bgzf_write(w, in, have, dest, NULL);
+        if (ret != Z_OK) {
+            goto CLEANUP;
+        }
+    }
+
+    ret = ferror(source) ? Z_ERRNO : bgzf_write_eof(dest);
+
+CLEANUP:
+    bgzf_writer_free(w);
+    free(in);
+    return ret;
+}
+
+int bgzf_member_size(const unsigned char *header, size_t *csize)
+{
+    if (memcmp(header, bgzf_header, HEADER_SIZE - 2) != 0) {
+        return Z_DATA_ERROR;
+    }
+    *csize = get_u16(header + HEADER_SIZE - 2) + 1;
+    return *csize < HEADER_SIZE + TRAILER_SIZE ? Z_DATA_ERROR : Z_OK;
+}
+
+int bgzf_index_build(FILE *source, bgzf_index_t **out)
+{
+    int ret = Z_OK;
+    unsigned char header[HEADER_SIZE];
+    unsigned char trailer[4];
+    long coffset = 0;
+
+    bgzf_index_t *index = (bgzf_index_t *)calloc(1, sizeof(bgzf_index_t));
+    if (index == NULL) {
+        return Z_MEM_ERROR;
+    }
+
+    while (fseek(source, coffset, SEEK_SET) == 0 && fread(header, 1, HEADER_SIZE, source) == HEADER_SIZE) {
+        size_t csize;
+        if (bgzf_member_size(header, &csize) != Z_OK || fseek(source, coffset + csize - 4, SEEK_SET) != 0 ||
+                fread(trailer, 1, 4, source) != 4) {
+            ret = Z_DATA_ERROR;
+            goto CLEANUP;
+        }
+
+        unsigned usize = get_u32(trailer);
+        if (usize > BGZF_MAX_MEMBER) {
+            ret = Z_DATA_ERROR;
+            goto CLEANUP;
+        }
+
+        if (usize > 0) {
+            if (index->count % INDEX_GROW == 0) {
+                bgzf_entry_t *grown = (bgzf_entry_t *)realloc(index->entries,
+                                      (index->count + INDEX_GROW) * sizeof(bgzf_entry_t));
+                if (grown == NULL) {
+                    ret = Z_MEM_ERROR;
+                    goto CLEANUP;
+                }
+                index->entries = grown;
+            }
+            bgzf_entry_t *e = &index->entries[index->count++];
+            e->coffset = coffset;
+            e->uoffset = index->size;
+            e->csize = csize;
+            e->usize = usize;
+            index->size += usize;
+        }
+        coffset += csize;
+    }
+    if (ferror(source)) {
+        ret = Z_ERRNO;
+    }
+
+CLEANUP:
+    if (ret != Z_OK) {
+        bgzf_index_free(index);
+        return ret;
+    }
+    ESP_LOGI(TAG, "Indexed %u members, %u bytes", (unsigned)index->count, (unsigned)index->size);
+    *out = index;
+    return Z_OK;
+}
+
+size_t bgzf_index_size(const bgzf_index_t *index)
+{
+    return index->size;
+}
+
+void bgzf_index_free(bgzf_index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    free(index->entries);
+    free(index);
+}
+
+static void *bgzf_inflate_member(void *arg)
+{
+    bgzf_job_t *job = (bgzf_job_t *)arg;
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(strm));
+    job->ret = inflateInit2(&strm, -MAX_WBITS);
+    if (job->ret != Z_OK) {
+        return NULL;
+    }
+
+    strm.next_in = job->in + HEADER_SIZE;
+    strm.avail_in = job->csize - HEADER_SIZE - TRAILER_SIZE;
+    strm.next_out = job->out;
+    strm.avail_out = BGZF_MAX_MEMBER;
+
+    // The whole member is inflated in one call, so inflate never allocates its window
+    job->ret = inflate(&strm, Z_FINISH);
+    (void)inflateEnd(&strm);
+
+    const unsigned char *trailer = job->in + job->csize - TRAILER_SIZE;
+    if (job->ret != Z_STREAM_END || strm.total_out != job->usize || get_u32(trailer + 4) != job->usize ||
+            crc32(0, job->out, job->usize) != get_u32(trailer)) {
+        job->ret = job->ret == Z_MEM_ERROR ? Z_MEM_ERROR : Z_DATA_ERROR;
+        return NULL;
+    }
+    job->ret = Z_OK;
+    return NULL;
+}
+
+// Member holding an uncompressed offset
+static size_t bgzf_find(const bgzf_index_t *index, size_t offset)
+{
+    size_t lo = 0, hi = index->count;
+
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].uoffset <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+int bgzf_read(FILE *source, const bgzf_index_t *index, size_t offset,
+              unsigned char *out, size_t len, size_t *out_len, int threads)
+{
+    int ret = Z_OK;
+    size_t done = 0;
+    pthread_t *tids = NULL;
+    bgzf_job_t *jobs = NULL;
+
+    *out_len = 0;
+    if (offset >= index->size || len == 0) {
+        return Z_OK;
+    }
+    if (len > index->size - offset) {
+        len = index->size - offset;
+    }
+    if (threads < 1) {
+        threads = 1;
+    }
+
+    jobs = (bgzf_job_t *)calloc(threads, sizeof(bgzf_job_t));
+    tids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    if (jobs == NULL || tids == NULL) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+    for (int t = 0; t < threads; t++) {
+        jobs[t].in = (unsigned char *)malloc(BGZF_MAX_MEMBER);
+        jobs[t].out = (unsigned char *)malloc(BGZF_MAX_MEMBER);
+        if (jobs[t].in == NULL || jobs[t].out == NULL) {
+            ret = Z_MEM_ERROR;
+            goto CLEANUP;
+        }
+    }
+
+    size_t next = bgzf_find(index, offset);
+
+    while (done < len) {
+        int batch = 0;
+
+        // Members are read in file order by this thread, inflated in parallel
+        for (; batch < threads && next < index->count && index->entries[next].uoffset < offset + len; batch++, next++) {
+            const bgzf_entry_t *e = &index->entries[next];
+            if (fseek(source, e->coffset, SEEK_SET) != 0 || fread(jobs[batch].in, 1, e->csize, source) != e->csize) {
+                ret = Z_ERRNO;
+                goto CLEANUP;
+            }
+            jobs[batch].csize = e->csize;
+            jobs[batch].usize = e->usize;
+        }
+        if (batch == 0) {
+            break;
+        }
+
+        if (batch == 1) {
+            bgzf_inflate_member(&jobs[0]);
+        } else {
+            int started = 0;
+            for (; started < batch; started++) {
+                if (pthread_create(&tids[started], NULL, bgzf_inflate_member, &jobs[started]) != 0) {
+                    break;
+                }
+            }
+            // Whatever could not get a thread runs here
+            for (int t = started; t < batch; t++) {
+                bgzf_inflate_member(&jobs[t]);
+            }
+            for (int t = 0; t < started; t++) {
+                pthread_join(tids[t], NULL);
+            }
+        }
+
+        for (int t = 0; t < batch; t++) {
+            const bgzf_entry_t *e = &index->entries[next - batch + t];
+            if (jobs[t].ret != Z_OK) {
+                ret = jobs[t].ret;
+                goto CLEANUP;
+            }
+
+            size_t skip = offset + done - e->uoffset;
+            size_t n = e->usize - skip < len - done ? e->usize - skip : len - done;
+            memcpy(out + done, jobs[t].out + skip, n);
+            done += n;
+        }
+    }
+
+CLEANUP:
+    if (jobs != NULL) {
+        for (int t = 0; t < threads; t++) {
+            free(jobs[t].in);
+            free(jobs[t].out);
+        }
+    }
+    free(jobs);
+    free(tids);
+    *out_len = done;
+    return ret;
+}
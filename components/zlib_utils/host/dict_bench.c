@@ -0,0 +1,117 @@
+/*
+    Host benchmark for deflate_dict_prepare() / deflate_buf_dict(): 200 byte messages with a 4K
+    preset dictionary, compressed from a prepared dictionary against deflateInit2() plus
+    deflateSetDictionary() for every message, same window, memLevel and level. Prints the
+    messages/s of both and the speedup (README); every prepared message must match the
+    per message stream byte for byte and inflate back with inflate_buf_dict().
+
+    Dictionary and messages are cut from assets/demo.txt. Run from the repository root.
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/zlib_utils/include -I$C/filter/include -I$C/probe/include -I$C/zlib/include -o dict_bench $C/zlib_utils/host/dict_bench.c $C/zlib_utils/zlib_utils.c $C/filter/filter.c $C/probe/probe.c $C/zlib/src/*.c -lm
+//   ./dict_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sdkconfig.h"
+#include "esp_timer.h"
+
+#include "zlib.h"
+#include "zlib_utils.h"
+
+#define TEXT_PATH "assets/demo.txt"
+#define DICT_SIZE (4096)
+#define MSG_SIZE (200)
+#define MESSAGES (20000)
+#define OUT_SIZE (1024)
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+
+static unsigned char s_text[16 * 1024];
+static size_t s_text_len;
+
+static const unsigned char *message(int i)
+{
+    return s_text + DICT_SIZE / 2 + (i * 37) % (s_text_len - DICT_SIZE / 2 - MSG_SIZE);
+}
+
+// What deflate_buf_dict() replaces: a new stream and a re-hashed dictionary per message
+static int deflate_buf_set_dict(const unsigned char *in, size_t in_len, unsigned char *out, size_t *out_len)
+{
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(z_stream));
+    int ret = deflateInit2(&strm, CONFIG_COMPRESSION_LEVEL, Z_DEFLATED, WINDOW_BITS, CONFIG_MEM_LEVEL,
+                           Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        return ret;
+    }
+    ret = deflateSetDictionary(&strm, s_text, DICT_SIZE);
+    if (ret == Z_OK) {
+        strm.next_in = (z_const Bytef *)in;
+        strm.avail_in = in_len;
+        strm.next_out = out;
+        strm.avail_out = *out_len;
+        ret = deflate(&strm, Z_FINISH);
+        *out_len -= strm.avail_out;
+        ret = ret == Z_STREAM_END ? Z_OK : Z_BUF_ERROR;
+    }
+    (void)deflateEnd(&strm);
+    return ret;
+}
+
+int main(void)
+{
+    static unsigned char fresh[OUT_SIZE], prepared[OUT_SIZE], back[OUT_SIZE];
+    zlib_dict_t *dict;
+    size_t len;
+    int bad = 0;
+
+    FILE *f = fopen(TEXT_PATH, "rb");
+    if (f == NULL) {
+        printf("cannot open %s, run from the repository root\n", TEXT_PATH);
+        return 1;
+    }
+    s_text_len = fread(s_text, 1, sizeof(s_text), f);
+    fclose(f);
+    if (s_text_len < DICT_SIZE + MSG_SIZE || deflate_dict_prepare(s_text, DICT_SIZE, &dict) != Z_OK) {
+        printf("no dictionary\n");
+        return 1;
+    }
+
+    for (int i = 0; i < 1000; i++) {
+        size_t fresh_len = OUT_SIZE, prepared_len = OUT_SIZE, back_len = OUT_SIZE;
+        if (deflate_buf_set_dict(message(i), MSG_SIZE, fresh, &fresh_len) != Z_OK ||
+            deflate_buf_dict(dict, message(i), MSG_SIZE, prepared, &prepared_len) != Z_OK ||
+            fresh_len != prepared_len || memcmp(fresh, prepared, fresh_len) != 0 ||
+            inflate_buf_dict(dict, prepared, prepared_len, back, &back_len) != Z_OK ||
+            back_len != MSG_SIZE || memcmp(back, message(i), MSG_SIZE) != 0) {
+            bad++;
+        }
+    }
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < MESSAGES; i++) {
+        len = OUT_SIZE;
+        bad += deflate_buf_set_dict(message(i), MSG_SIZE, fresh, &len) != Z_OK;
+    }
+    int64_t set_dict_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < MESSAGES; i++) {
+        len = OUT_SIZE;
+        bad += deflate_buf_dict(dict, message(i), MSG_SIZE, prepared, &len) != Z_OK;
+    }
+    int64_t prepared_us = esp_timer_get_time() - start;
+
+    printf("%d byte messages, %dK dictionary, window %d, memLevel %d: deflateSetDictionary %.0f msg/s, "
+           "prepared %.0f msg/s (%.1fx)\n", MSG_SIZE, DICT_SIZE / 1024, WINDOW_BITS, CONFIG_MEM_LEVEL,
+           MESSAGES * 1e6 / set_dict_us, MESSAGES * 1e6 / prepared_us, (double)set_dict_us / prepared_us);
+    printf("prepared output identical and inflated back: %s\n", bad ? "FAILED" : "ok");
+
+    deflate_dict_free(dict);
+    return bad != 0;
+}
@@ -0,0 +1,162 @@
+/*
+    Host benchmark for deflate_buf_shuffle() / inflate_buf_shuffle() and the SHUFFLE and
+    BITSHUFFLE codec filters: 64K float32 samples of three synthetic traces compressed plain,
+    byte shuffled and bit shuffled, with deflate and Brotli q1. Prints the README table; every
+    buffer is decompressed and compared.
+
+    Traces:
+        accelerometer: three interleaved axes, quantized to a 12-bit ADC step
+        temperature: slow drift in 0.01 C steps
+        vibration: unquantized sine plus noise
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/zlib_utils/include -I$C/codec/include -I$C/codec -I$C/filter/include -I$C/probe/include -I$C/zlib/include -I$C/brotli/include -I$C/fastlz/include -I$C/lzss/include -o shuffle_bench $C/zlib_utils/host/shuffle_bench.c $C/zlib_utils/zlib_utils.c $C/codec/codec.c $C/codec/codec_zlib.c $C/codec/codec_brotli.c $C/codec/codec_fastlz.c $C/codec/codec_lzss.c $C/filter/filter.c $C/probe/probe.c $C/zlib/src/*.c $C/brotli/common/*.c $C/brotli/enc/*.c $C/brotli/dec/*.c $C/fastlz/*.c $C/lzss/*.c -lm -lpthread
+//   ./shuffle_bench
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "zlib.h"
+#include "codec.h"
+#include "zlib_utils.h"
+
+#define SAMPLES (65536)
+#define DATA_SIZE (SAMPLES * sizeof(float))
+#define BROTLI_QUALITY (1)
+#define BROTLI_BLOCK (1024)
+
+typedef enum {
+    TRACE_ACCELEROMETER,
+    TRACE_TEMPERATURE,
+    TRACE_VIBRATION,
+    TRACE_MAX,
+} trace_t;
+
+static const char *s_trace_names[] = {
+    "3-axis accelerometer, 12-bit ADC", "Temperature, 0.01 C steps", "Vibration, unquantized",
+};
+
+static double gauss(void)
+{
+    double u = (rand() + 1.0) / (RAND_MAX + 2.0), v = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return sqrt(-2 * log(u)) * cos(2 * M_PI * v);
+}
+
+static void make_trace(trace_t trace, float *data)
+{
+    srand(3 + trace);
+    for (size_t i = 0; i < SAMPLES; i++) {
+        int axis = i % 3;
+        switch (trace) {
+        case TRACE_ACCELEROMETER:
+            data[i] = (float)(round(((axis == 2) + 0.2 * sin(i / 3 / 40.0 + axis) + 0.01 * gauss()) * 1024) / 1024);
+            break;
+        case TRACE_TEMPERATURE:
+            data[i] = (float)(round((21.5 + 2 * sin(i / 5000.0) + 0.02 * gauss()) * 100) / 100);
+            break;
+        default:
+            data[i] = (float)(0.5 * sin(i / 7.0) + 0.05 * gauss());
+            break;
+        }
+    }
+}
+
+// Ratio through deflate_buf_shuffle(), 0 on failure or mismatch; elem_size 1 leaves the data as is
+static double deflate_ratio(const float *data, unsigned elem_size, bool bits, uint8_t *comp, uint8_t *back)
+{
+    size_t comp_len = 2 * DATA_SIZE, back_len = 2 * DATA_SIZE;
+
+    if (deflate_buf_shuffle(data, DATA_SIZE, elem_size, bits, comp, &comp_len) != Z_OK ||
+        inflate_buf_shuffle(comp, comp_len, back, &back_len) != Z_OK ||
+        back_len != DATA_SIZE || memcmp(back, data, DATA_SIZE) != 0) {
+        return 0;
+    }
+    return (double)DATA_SIZE / comp_len;
+}
+
+// Ratio through a Brotli codec with the given filter, 0 on failure or mismatch
+static double brotli_ratio(const float *data, filter_type_t filter, uint8_t *comp, uint8_t *back)
+{
+    codec_params_t params;
+    codec_t *codec;
+    size_t comp_len = 2 * DATA_SIZE, back_len = 2 * DATA_SIZE;
+
+    codec_default_params(CODEC_BROTLI, &params);
+    params.level = BROTLI_QUALITY;
+    if (filter != FILTER_NONE) {
+        params.filter = (filter_params_t) { filter, sizeof(float), BROTLI_BLOCK };
+    }
+    if (codec_create(CODEC_BROTLI, CODEC_COMPRESS, &params, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    esp_err_t ret = codec_buf(codec, (const uint8_t *)data, DATA_SIZE, comp, &comp_len);
+    codec_destroy(codec);
+    if (ret != ESP_OK || codec_create(CODEC_BROTLI, CODEC_DECOMPRESS, &params, 0, &codec) != ESP_OK) {
+        return 0;
+    }
+    ret = codec_buf(codec, comp, comp_len, back, &back_len);
+    codec_destroy(codec);
+    if (ret != ESP_OK || back_len != DATA_SIZE || memcmp(back, data, DATA_SIZE) != 0) {
+        return 0;
+    }
+    return (double)DATA_SIZE / comp_len;
+}
+
+int main(void)
+{
+    float *data = (float *)malloc(DATA_SIZE);
+    uint8_t *comp = (uint8_t *)malloc(2 * DATA_SIZE);
+    uint8_t *back = (uint8_t *)malloc(2 * DATA_SIZE);
+    int fail = 0;
+
+    if (data == NULL || comp == NULL || back == NULL) {
+        printf("out of memory\n");
+        return 1;
+    }
+
+    printf("| Trace | deflate | deflate, byte / bit shuffle | Brotli q%d | Brotli q%d, byte / bit shuffle |\n",
+           BROTLI_QUALITY, BROTLI_QUALITY);
+    printf("| --- | --- | --- | --- | --- |\n");
+    for (trace_t t = 0; t < TRACE_MAX; t++) {
+        make_trace(t, data);
+        double r[6] = {
+            deflate_ratio(data, 1, false, comp, back),
+            deflate_ratio(data, sizeof(float), false, comp, back),
+            deflate_ratio(data, sizeof(float), true, comp, back),
+            brotli_ratio(data, FILTER_NONE, comp, back),
+            brotli_ratio(data, FILTER_SHUFFLE, comp, back),
+            brotli_ratio(data, FILTER_BITSHUFFLE, comp, back),
+        };
+        for (int i = 0; i < 6; i++) {
+            fail |= r[i] == 0;
+        }
+        printf("| %s | %.2fx | %.2fx / %.2fx | %.2fx | %.2fx / %.2fx |\n",
+               s_trace_names[t], r[0], r[1], r[2], r[3], r[4], r[5]);
+    }
+
+    // A trailing partial block and element, and an output buffer that is too small
+    size_t comp_len = 2 * DATA_SIZE, back_len = 2 * DATA_SIZE;
+    if (deflate_buf_shuffle(data, 10001, sizeof(float), true, comp, &comp_len) != Z_OK ||
+        inflate_buf_shuffle(comp, comp_len, back, &back_len) != Z_OK ||
+        back_len != 10001 || memcmp(back, data, 10001) != 0) {
+        printf("partial block: FAILED\n");
+        fail = 1;
+    }
+    comp_len = 10;
+    if (deflate_buf_shuffle(data, DATA_SIZE, sizeof(float), false, comp, &comp_len) != Z_BUF_ERROR) {
+        printf("small output: FAILED\n");
+        fail = 1;
+    }
+    if (fail) {
+        printf("round trip FAILED (0.00x above)\n");
+    }
+
+    free(data);
+    free(comp);
+    free(back);
+    return fail;
+}
@@ -0,0 +1,318 @@
+/*
+    Host benchmark for zpipe.h: deflate_file() / inflate_file() against their pipelined
+    versions on storage throttled to a flash-like rate (fopencookie streams that sleep for
+    every byte they pass). Prints the README figures; every output is compared with the
+    unpipelined one and decompressed again. Then checks a sink that fails midway and a
+    truncated stream.
+
+    deflate_file_adaptive() is compared with fixed levels 1 and 9 on sinks of 1, 5 and
+    15 MB/s (README table); its output is inflated and compared as well.
+
+    Input: assets/hello-world.bin followed by copies of assets/demo.txt, about 270K of
+    executable and text, repeated 8 times for the adaptive runs. Run from the repository root.
+*/
+
+// Build from the repository root:
+//   C=components
+//   gcc -O2 -Itools/host/include -I$C/zlib_utils/include -I$C/filter/include -I$C/probe/include -I$C/zlib/include -o zpipe_bench $C/zlib_utils/host/zpipe_bench.c $C/zlib_utils/zpipe.c $C/zlib_utils/zlib_utils.c $C/filter/filter.c $C/probe/probe.c $C/zlib/src/*.c -lm -lpthread
+//   ./zpipe_bench
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_timer.h"
+
+#include "zlib.h"
+#include "zlib_utils.h"
+#include "zpipe.h"
+
+#define BINARY_PATH "assets/hello-world.bin"
+#define TEXT_PATH "assets/demo.txt"
+#define TEXT_COPIES (16)
+#define READ_RATE (400e3)           // Bytes per second
+#define WRITE_RATE (150e3)
+#define FAIL_AFTER (20000)
+#define TRUNCATE_AT (30000)
+#define ADAPT_COPIES (8)
+
+typedef int (*file_fn_t)(FILE *source, FILE *dest);
+
+typedef struct {
+    FILE *f;
+    double rate;            // Bytes per second, 0: unthrottled
+    long fail_after;        // Writes fail past this many bytes, 0: never
+    long done;
+} throttle_t;
+
+static ssize_t throttle_read(void *cookie, char *buf, size_t len)
+{
+    throttle_t *t = (throttle_t *)cookie;
+    size_t n = fread(buf, 1, len, t->f);
+    if (t->rate > 0) {
+        usleep((useconds_t)(n / t->rate * 1e6));
+    }
+    return n;
+}
+
+static ssize_t throttle_write(void *cookie, const char *buf, size_t len)
+{
+    throttle_t *t = (throttle_t *)cookie;
+    if (t->fail_after > 0 && t->done + (long)len > t->fail_after) {
+        return -1;
+    }
+    size_t n = fwrite(buf, 1, len, t->f);
+    t->done += n;
+    if (t->rate > 0) {
+        usleep((useconds_t)(n / t->rate * 1e6));
+    }
+    return n;
+}
+
+// The underlying file stays open
+static int throttle_close(void *cookie)
+{
+    free(cookie);
+    return 0;
+}
+
+// Throttled stream over f from its start; writing empties f first
+static FILE *throttle_open(FILE *f, const char *mode, double rate, long fail_after)
+{
+    throttle_t *t = (throttle_t *)calloc(1, sizeof(throttle_t));
+    cookie_io_functions_t io = { throttle_read, throttle_write, NULL, throttle_close };
+
+    if (t == NULL) {
+        return NULL;
+    }
+    t->f = f;
+    t->rate = rate;
+    t->fail_after = fail_after;
+    fflush(f);
+    if (mode[0] == 'w' && ftruncate(fileno(f), 0) != 0) {
+        free(t);
+        return NULL;
+    }
+    rewind(f);
+    return fopencookie(t, mode, io);
+}
+
+static bool append_file(FILE *dest, const char *path)
+{
+    char buf[1024];
+    size_t n;
+    FILE *f = fopen(path, "rb");
+
+    if (f == NULL) {
+        printf("cannot open %s, run from the repository root\n", path);
+        return false;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        fwrite(buf, 1, n, dest);
+    }
+    fclose(f);
+    return true;
+}
+
+static long file_size(FILE *f)
+{
+    fflush(f);
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    return size;
+}
+
+static bool same_contents(FILE *a, FILE *b)
+{
+    int ca, cb;
+
+    if (file_size(a) != file_size(b)) {
+        return false;
+    }
+    do {
+        ca = getc(a);
+        cb = getc(b);
+    } while (ca == cb && ca != EOF);
+    return ca == cb;
+}
+
+// Runs fn from source to dest through throttled streams; returns the time in ms, *ret the result
+static double run(file_fn_t fn, FILE *source, FILE *dest, double read_rate, double write_rate, int *ret)
+{
+    FILE *in = throttle_open(source, "rb", read_rate, 0);
+    FILE *out = throttle_open(dest, "wb", write_rate, 0);
+
+    *ret = Z_ERRNO;
+    if (in == NULL || out == NULL) {
+        return 0;
+    }
+    int64_t start = esp_timer_get_time();
+    *ret = fn(in, out);
+    fclose(out);
+    int64_t us = esp_timer_get_time() - start;
+    fclose(in);
+    return us / 1000.0;
+}
+
+static int check_pipelined(FILE *input)
+{
+    FILE *gz = tmpfile(), *gz_piped = tmpfile(), *out = tmpfile();
+    double ms[4];
+    int ret[4], fail = 0;
+
+    if (gz == NULL || gz_piped == NULL || out == NULL) {
+        printf("no temporary file\n");
+        return 1;
+    }
+
+    ms[0] = run(deflate_file, input, gz, READ_RATE, WRITE_RATE, &ret[0]);
+    ms[1] = run(deflate_file_pipelined, input, gz_piped, READ_RATE, WRITE_RATE, &ret[1]);
+    bool same = same_contents(gz, gz_piped);
+    ms[2] = run(inflate_file, gz_piped, out, READ_RATE, WRITE_RATE, &ret[2]);
+    bool inflated = same_contents(out, input);
+    ms[3] = run(inflate_file_pipelined, gz_piped, out, READ_RATE, WRITE_RATE, &ret[3]);
+    bool inflated_piped = same_contents(out, input);
+
+    printf("%ldK, storage %.0f KB/s read, %.0f KB/s write: deflate %.2f s -> %.2f s, inflate %.2f s -> %.2f s\n",
+           file_size(input) / 1024, READ_RATE / 1e3, WRITE_RATE / 1e3, ms[0] / 1e3, ms[1] / 1e3, ms[2] / 1e3, ms[3] / 1e3);
+    if (ret[0] != Z_OK || ret[1] != Z_OK || ret[2] != Z_OK || ret[3] != Z_OK || !same || !inflated || !inflated_piped) {
+        printf("round trip FAILED: %d %d %d %d, same stream %d, inflated %d / %d\n",
+               ret[0], ret[1], ret[2], ret[3], same, inflated, inflated_piped);
+        fail = 1;
+    }
+
+    // A sink that fails midway and a truncated stream must end in an error
+    FILE *in = throttle_open(input, "rb", 0, 0);
+    FILE *failing = throttle_open(out, "wb", 0, FAIL_AFTER);
+    int r = deflate_file_pipelined(in, failing);
+    fclose(in);
+    fclose(failing);
+    printf("sink failing after %dK: %d, %s\n", FAIL_AFTER / 1000, r, r != Z_OK ? "ok" : "FAILED");
+    fail |= r == Z_OK;
+
+    fflush(gz_piped);
+    if (ftruncate(fileno(gz_piped), TRUNCATE_AT) == 0) {
+        rewind(gz_piped);
+        rewind(out);
+        r = inflate_file_pipelined(gz_piped, out);
+        printf("stream truncated at %dK: %d, %s\n", TRUNCATE_AT / 1000, r, r != Z_OK ? "ok" : "FAILED");
+        fail |= r == Z_OK;
+    }
+
+    fclose(gz);
+    fclose(gz_piped);
+    fclose(out);
+    return fail;
+}
+
+// Level 1, level 9 and adaptive 1..9 on one sink rate; prints a README table row
+static int run_adaptive(FILE *input, FILE *gz, FILE *out, double rate)
+{
+    const zpipe_adapt_t adapt[3] = { { 1, 1 }, { 9, 9 }, { 1, 9 } };
+    zpipe_adapt_stats_t st;
+    int fail = 0;
+
+    printf("| %.0f MB/s |", rate / 1e6);
+    for (int i = 0; i < 3; i++) {
+        FILE *in = throttle_open(input, "rb", 0, 0);
+        FILE *sink = throttle_open(gz, "wb", rate, 0);
+        if (in == NULL || sink == NULL) {
+            return 1;
+        }
+        int64_t start = esp_timer_get_time();
+        int ret = deflate_file_adaptive(in, sink, &adapt[i], &st);
+        fclose(sink);
+        int64_t us = esp_timer_get_time() - start;
+        fclose(in);
+
+        rewind(gz);
+        rewind(out);
+        if (ftruncate(fileno(out), 0) != 0 || ret != Z_OK || inflate_file(gz, out) != Z_OK ||
+            !same_contents(out, input)) {
+            printf(" FAILED |");
+            fail = 1;
+            continue;
+        }
+        printf(" %.2f s, %ld B", us / 1e6, file_size(gz));
+
+        if (i == 2) {
+            int lo = 9, hi = 1, top = 1;
+            size_t total = 0;
+            for (int l = 1; l <= 9; l++) {
+                if (st.bytes_at_level[l] > 0) {
+                    lo = l < lo ? l : lo;
+                    hi = l > hi ? l : hi;
+                    top = st.bytes_at_level[l] > st.bytes_at_level[top] ? l : top;
+                    total += st.bytes_at_level[l];
+                }
+            }
+            if (lo == hi) {
+                printf(" (level %d)", lo);
+            } else {
+                printf(" (levels %d-%d, %u%% at level %d, %u changes)", lo, hi,
+                       (unsigned)(100 * st.bytes_at_level[top] / total), top, st.level_changes);
+            }
+        }
+        printf(" |");
+    }
+    printf("\n");
+    return fail;
+}
+
+static int check_adaptive(FILE *input)
+{
+    FILE *big = tmpfile(), *gz = tmpfile(), *out = tmpfile();
+    const double rates[] = { 1e6, 5e6, 15e6 };
+    char buf[1024];
+    size_t n;
+    int fail = 0;
+
+    if (big == NULL || gz == NULL || out == NULL) {
+        printf("no temporary file\n");
+        return 1;
+    }
+    for (int i = 0; i < ADAPT_COPIES; i++) {
+        rewind(input);
+        while ((n = fread(buf, 1, sizeof(buf), input)) > 0) {
+            fwrite(buf, 1, n, big);
+        }
+    }
+
+    printf("\n| Sink (host, %.1f MB file) | Level 1 | Level 9 | Adaptive 1..9 |\n", file_size(big) / 1e6);
+    printf("| --- | --- | --- | --- |\n");
+    for (size_t i = 0; i < sizeof(rates) / sizeof(rates[0]); i++) {
+        fail |= run_adaptive(big, gz, out, rates[i]);
+    }
+
+    fclose(big);
+    fclose(gz);
+    fclose(out);
+    return fail;
+}
+
+int main(void)
+{
+    FILE *input = tmpfile();
+    int fail = 0;
+
+    if (input == NULL) {
+        printf("no temporary file\n");
+        return 1;
+    }
+    bool ok = append_file(input, BINARY_PATH);
+    for (int i = 0; ok && i < TEXT_COPIES; i++) {
+        ok = append_file(input, TEXT_PATH);
+    }
+    if (!ok) {
+        return 1;
+    }
+
+    fail |= check_pipelined(input);
+    fail |= check_adaptive(input);
+
+    fclose(input);
+    return fail;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Blocked gzip (BGZF, the layout of htslib's bgzip): a series of independent gzip members
+    of at most 64K each, whose size is stored in a "BC" extra field, followed by an empty
+    end-of-file member. Any gunzip reads it as one file; readers that know the layout can
+    start at any member, so a read at an uncompressed offset costs one or two blocks.
+*/
+
+// Largest input per member
+#define BGZF_BLOCK_SIZE (65280)
+#define BGZF_MAX_MEMBER (65536)
+#define BGZF_HEADER_SIZE (18)
+
+typedef struct bgzf_index bgzf_index_t;
+typedef struct bgzf_writer bgzf_writer_t;
+
+int bgzf_deflate_file(FILE *source, FILE *dest);
+
+/*
+    Member writer for callers producing data piecemeal (e.g. logs): every bgzf_write() call
+    emits complete members, so the file is valid after each one.
+    block_size caps the input per member and sets the output buffer size.
+*/
+int bgzf_writer_create(size_t block_size, bgzf_writer_t **out);
+
+// Input per member, block_size or less when it might not fit in 64K
+size_t bgzf_writer_block(const bgzf_writer_t *w);
+
+// Compress len bytes into one or more members appended to dest; written (may be NULL) gets the bytes added
+int bgzf_write(bgzf_writer_t *w, const unsigned char *in, size_t len, FILE *dest, size_t *written);
+
+// Empty end-of-file member expected by bgzip readers
+int bgzf_write_eof(FILE *dest);
+
+void bgzf_writer_free(bgzf_writer_t *w);
+
+// Size of the member starting with a BGZF_HEADER_SIZE byte header; Z_DATA_ERROR if it is not a BGZF member
+int bgzf_member_size(const unsigned char *header, size_t *csize);
+
+// Scan member headers and trailers (no inflating) to map uncompressed offsets to members
+int bgzf_index_build(FILE *source, bgzf_index_t **out);
+
+// Total uncompressed size
+size_t bgzf_index_size(const bgzf_index_t *index);
+
+void bgzf_index_free(bgzf_index_t *index);
+
+/*
+    Read len bytes at an uncompressed offset into out, *out_len set to the bytes read
+    (short only at the end of the data). Members are inflated `threads` at a time on
+    separate pthreads, each with 128K of buffers; threads <= 1 inflates inline.
+*/
+int bgzf_read(FILE *source, const bgzf_index_t *index, size_t offset,
+              unsigned char *out, size_t len, size_t *out_len, int threads);
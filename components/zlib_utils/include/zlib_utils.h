@@ -1,11 +1,60 @@
 #pragma once
 
+#include <stddef.h>
+
 #include "esp_err.h"
 #include "esp_log.h"
 #include "esp_system.h"
 
+#include "filter.h"
+
 void zerr(int ret);
 
+/*
+    The level comes from probing the first CONFIG_PROBE_SAMPLE_SIZE bytes (probe.h) and is kept
+    for the whole file: an incompressible prefix means the file is stored.
+*/
 int deflate_file(FILE *source, FILE *dest);
 
-int inflate_file(FILE *source, FILE *dest);
\ No newline at end of file
+int inflate_file(FILE *source, FILE *dest);
+
+/*
+    deflate_file() / inflate_file() with a filter stage (see filter.h) in front of deflate and
+    behind inflate. The stream is plain deflate/gzip of the filtered data: the reader has to
+    pass the same filter parameters.
+*/
+int deflate_file_filter(FILE *source, FILE *dest, const filter_params_t *params);
+
+int inflate_file_filter(FILE *source, FILE *dest, const filter_params_t *params);
+
+/*
+    Blosc-style compression of arrays of fixed-size elements (float or integer sensor arrays):
+    every 4K block is split into elem_size byte planes, or with bits set into bit planes, and the
+    planes are deflated as one zlib stream. elem_size is 1, 2, 4 or 8 and is stored in a one
+    byte header, so the reader needs no parameters. in_len need not be a multiple of elem_size.
+    The level is chosen by probing the first shuffled block only.
+    For Brotli q0/q1, create a codec with a SHUFFLE or BITSHUFFLE filter instead (codec.h).
+*/
+int deflate_buf_shuffle(const void *in, size_t in_len, unsigned elem_size, bool bits,
+                        unsigned char *out, size_t *out_len);
+
+int inflate_buf_shuffle(const unsigned char *in, size_t in_len, void *out, size_t *out_len);
+
+/*
+    Prepared (pre-hashed) dictionary for compressing many small messages.
+    The dictionary is inserted into the deflate hash chains once; every message
+    stream is then cloned from that primed state instead of re-hashing the dictionary.
+    Messages use the zlib wrapper (gzip cannot carry a dictionary id).
+    The dictionary data is referenced, not copied, and must outlive the handle.
+*/
+typedef struct zlib_dict zlib_dict_t;
+
+int deflate_dict_prepare(const unsigned char *dict, unsigned dict_len, zlib_dict_t **out);
+
+int deflate_buf_dict(const zlib_dict_t *dict, const unsigned char *in, size_t in_len,
+                     unsigned char *out, size_t *out_len);
+
+int inflate_buf_dict(const zlib_dict_t *dict, const unsigned char *in, size_t in_len,
+                     unsigned char *out, size_t *out_len);
+
+void deflate_dict_free(zlib_dict_t *dict);
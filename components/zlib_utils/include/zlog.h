@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Compressed log files. Appended data is buffered and written as BGZF members (see bgzf.h),
+    each a complete gzip member synced to flash as soon as it is written, so logs are compressed
+    once on the way in and stay readable by gunzip and bgzf_index_build() at any time.
+    A member cut short by a reset is dropped when the log is reopened.
+
+    A file that reaches CONFIG_ZLOG_ROTATE_SIZE compressed bytes (overshooting by at most one
+    member) is rotated: path -> path.1 -> ... -> path.CONFIG_ZLOG_ROTATE_FILES, oldest deleted.
+*/
+
+#define ZLOG_BUFFER_SIZE (CONFIG_ZLOG_BUFFER_SIZE)
+#define ZLOG_ROTATE_SIZE (CONFIG_ZLOG_ROTATE_SIZE)
+#define ZLOG_ROTATE_FILES (CONFIG_ZLOG_ROTATE_FILES)
+
+typedef struct zlog zlog_t;
+
+// Append to path, creating it or trimming an incomplete last member; Z_DATA_ERROR if it is not a BGZF file
+int zlog_open(const char *path, zlog_t **out);
+
+// Buffer len bytes; full buffers are compressed and written right away
+int zlog_write(zlog_t *log, const void *data, size_t len);
+
+// Write whatever is buffered as a member, even a short one
+int zlog_flush(zlog_t *log);
+
+// Flush and free the log
+int zlog_close(zlog_t *log);
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdio.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    deflate_file() / inflate_file() as a three stage pipeline: a reader thread fills input
+    buffers, the calling thread runs zlib, a writer thread drains output buffers. Each stage
+    hands over CONFIG_ZPIPE_CHUNK_SIZE buffers through a queue of CONFIG_ZPIPE_DEPTH, so flash
+    reads and writes overlap with compression instead of alternating with it. On dual core
+    targets the I/O threads run on the other core.
+
+    Same stream format and settings as deflate_file() (gzip or zlib wrapper, window, level,
+    probe of the first buffer only); 2 * CONFIG_ZPIPE_DEPTH buffers of RAM on top of zlib.
+*/
+
+#define ZPIPE_CHUNK_SIZE (CONFIG_ZPIPE_CHUNK_SIZE)
+#define ZPIPE_DEPTH (CONFIG_ZPIPE_DEPTH)
+
+int deflate_file_pipelined(FILE *source, FILE *dest);
+
+int inflate_file_pipelined(FILE *source, FILE *dest);
+
+/*
+    deflate_file_pipelined() with the level chosen on the fly between min_level and max_level
+    (1..9). Every few input buffers the compressor's output rate is compared with the rate
+    the writer gets rid of it: a slow sink leaves CPU to spare for a higher level, a fast one
+    makes the compressor the bottleneck and the level drops. Changes go through deflateParams(),
+    so the output is still one ordinary stream. Input whose first buffer the probe finds
+    incompressible is stored throughout, the level is not adapted then.
+*/
+typedef struct {
+    int min_level;
+    int max_level;
+} zpipe_adapt_t;
+
+typedef struct {
+    int level;                      // Level at the end of the stream
+    unsigned level_changes;
+    size_t bytes_at_level[10];      // Input bytes compressed at each level
+} zpipe_adapt_stats_t;
+
+int deflate_file_adaptive(FILE *source, FILE *dest, const zpipe_adapt_t *adapt, zpipe_adapt_stats_t *stats);
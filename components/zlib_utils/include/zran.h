@@ -0,0 +1,35 @@
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+/*
+    Random access into existing gzip or zlib streams (zran, from zlib's examples).
+    One pass over the stream records an access point at a deflate block boundary every
+    CONFIG_ZRAN_SPAN KB: its compressed bit offset and the 32K of output before it.
+    A read then starts inflating at the nearest point before the offset instead of at the
+    beginning. Only the first member of a multi-member gzip file is indexed.
+*/
+
+#define ZRAN_SPAN (CONFIG_ZRAN_SPAN * 1024)
+#define ZRAN_WINDOW (32768)
+
+typedef struct zran_index zran_index_t;
+
+int zran_index_build(FILE *source, zran_index_t **out);
+
+// Total uncompressed size
+size_t zran_index_size(const zran_index_t *index);
+
+// RAM held by the access points (windows included)
+size_t zran_index_mem(const zran_index_t *index);
+
+void zran_index_free(zran_index_t *index);
+
+// Read len bytes at an uncompressed offset; *out_len is short only at the end of the stream
+int zran_extract(FILE *source, const zran_index_t *index, size_t offset,
+                 unsigned char *out, size_t len, size_t *out_len);
@@ -7,15 +7,29 @@
 
 #include "zlib.h"
 #include "zlib_utils.h"
+#include "probe.h"
+#include "filter.h"
 
-#define WINDOW_SIZE (CONFIG_WINDOW_SIZE | CONFIG_GZIP_ENCODING)
+// zlib rejects a window of 8 with gzip and writes 9 into zlib headers for it
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+#define WINDOW_SIZE (WINDOW_BITS | CONFIG_GZIP_ENCODING)
 #define CHUNK_SIZE (CONFIG_WINDOW_SIZE) // Must be same as window size
 #define MEM_LEVEL (CONFIG_MEM_LEVEL)
 #define COMPRESSION_LEVEL (CONFIG_COMPRESSION_LEVEL)
 #define COMPRESSION_STRATEGY (CONFIG_COMPRESSION_STRATEGY)
+#define DICT_WINDOW_SIZE (WINDOW_BITS) // zlib wrapper, required for preset dictionaries
+#define FILTER_CHUNK_SIZE (4096)
+#define SHUFFLE_BLOCK_SIZE (4096)   // Holds a multiple of 8 elements of every element size
+#define SHUFFLE_BITS (0x80)         // Header flag: bit planes
 
 static const char *TAG = "zlib_utils";
 
+struct zlib_dict {
+    z_stream primed;            // Deflate state with the dictionary already hashed in
+    const unsigned char *data;  // Dictionary bytes, needed again on the inflate side
+    unsigned len;
+};
+
 void zerr(int ret)
 {
     switch (ret) {
@@ -37,10 +51,30 @@ void zerr(int ret)
     }
 }
 
+// Level for data starting with the given prefix: stored blocks if it will not compress
+static int probe_level(const unsigned char *prefix, size_t len)
+{
+    probe_result_t res;
+
+    probe_run(prefix, len, &res);
+    switch (probe_verdict(&res)) {
+    case PROBE_STORE:
+        ESP_LOGI(TAG, "Predicted ratio %u%%, storing", res.ratio);
+        return Z_NO_COMPRESSION;
+    case PROBE_FAST:
+        ESP_LOGI(TAG, "Predicted ratio %u%%, fastest level", res.ratio);
+        return COMPRESSION_LEVEL == Z_NO_COMPRESSION ? Z_NO_COMPRESSION : Z_BEST_SPEED;
+    default:
+        return COMPRESSION_LEVEL;
+    }
+}
+
 int deflate_file(FILE *source, FILE *dest)
 {
-    int ret, flush;
+    int ret = Z_OK, flush;
     unsigned have;
+    size_t prefix_len;
+    bool started = false;
     z_stream strm;
 
     /*  Allocating on the stack only works for very small chunk sizes.
@@ -49,6 +83,18 @@ int deflate_file(FILE *source, FILE *dest)
     */
     unsigned char *in = (unsigned char *)malloc(CHUNK_SIZE * sizeof(char));
     unsigned char *out = (unsigned char *)malloc(CHUNK_SIZE * sizeof(char));
+    // The prefix is read up front for the probe and fed to deflate as the first chunk
+    unsigned char *prefix = (unsigned char *)malloc(PROBE_SAMPLE_SIZE);
+    if (in == NULL || out == NULL || prefix == NULL) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    prefix_len = fread(prefix, 1, PROBE_SAMPLE_SIZE, source);
+    if (ferror(source)) {
+        ret = Z_ERRNO;
+        goto CLEANUP;
+    }
 
     strm.zalloc = Z_NULL;
     strm.zfree = Z_NULL;
@@ -56,42 +102,55 @@ int deflate_file(FILE *source, FILE *dest)
 
     ESP_LOGI(TAG, "Initiated Compression");
 
-    ret = deflateInit2(&strm, COMPRESSION_LEVEL, Z_DEFLATED, WINDOW_SIZE, MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    ret = deflateInit2(&strm, probe_level(prefix, prefix_len), Z_DEFLATED, WINDOW_SIZE, MEM_LEVEL, Z_DEFAULT_STRATEGY);
     if (ret != Z_OK) {
-        return ret;
+        goto CLEANUP;
     }
+    started = true;
 
     do {
-        strm.avail_in = fread(in, 1, CHUNK_SIZE, source);
+        if (prefix != NULL) {
+            strm.avail_in = prefix_len;
+            strm.next_in = prefix;
+        } else {
+            strm.avail_in = fread(in, 1, CHUNK_SIZE, source);
+            strm.next_in = in;
+        }
         if (ferror(source)) {
-            zerr(deflateEnd(&strm));
-            return Z_ERRNO;
+            ret = Z_ERRNO;
+            goto CLEANUP;
         }
         flush = feof(source) ? Z_FINISH : Z_NO_FLUSH;
-        strm.next_in = in;
 
         do {
             strm.avail_out = CHUNK_SIZE;
             strm.next_out = out;
             ret = deflate(&strm, flush);
             assert(ret != Z_STREAM_ERROR);
-            zerr(ret);
             have = CHUNK_SIZE - strm.avail_out;
 
             if (fwrite(out, sizeof(char), have, dest) != have || ferror(dest)) {
-                zerr(deflateEnd(&strm));
-                return Z_ERRNO;
+                ret = Z_ERRNO;
+                goto CLEANUP;
             }
         } while (strm.avail_out == 0);
         assert(strm.avail_in == 0);
 
+        free(prefix);
+        prefix = NULL;
     } while (flush != Z_FINISH);
     assert(ret == Z_STREAM_END);
+    ret = Z_OK;
 
-    zerr(deflateEnd(&strm));
+CLEANUP:
+    if (started) {
+        deflateEnd(&strm);
+    }
+    zerr(ret);
+    free(prefix);
     free(in);
     free(out);
-    return Z_OK;
+    return ret;
 }
 
 int inflate_file(FILE *source, FILE *dest)
@@ -162,3 +221,386 @@ int inflate_file(FILE *source, FILE *dest)
     free(out);
     return ret == Z_STREAM_END ? Z_OK : Z_DATA_ERROR;
 }
+
+// Shuffled data has to be cut at block boundaries, the history filters take any chunk size
+static size_t filter_chunk(const filter_params_t *params)
+{
+    return filter_is_blocked(params) ? params->stride : FILTER_CHUNK_SIZE;
+}
+
+int deflate_file_filter(FILE *source, FILE *dest, const filter_params_t *params)
+{
+    int ret = Z_OK, flush;
+    size_t have;
+    bool started = false;
+    filter_t filter;
+    z_stream strm;
+
+    if (filter_init(&filter, params) != ESP_OK) {
+        return Z_STREAM_ERROR;
+    }
+
+    size_t chunk = filter_chunk(&filter.params);
+    unsigned char *in = (unsigned char *)malloc(chunk);
+    unsigned char *out = (unsigned char *)malloc(FILTER_CHUNK_SIZE);
+    if (in == NULL || out == NULL) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    memset(&strm, 0, sizeof(z_stream));
+
+    do {
+        have = fread(in, 1, chunk, source);
+        if (ferror(source)) {
+            ret = Z_ERRNO;
+            goto CLEANUP;
+        }
+        flush = feof(source) ? Z_FINISH : Z_NO_FLUSH;
+        if (filter_encode(&filter, in, have) != ESP_OK) {
+            ret = Z_DATA_ERROR;
+            goto CLEANUP;
+        }
+
+        // Probe the filtered data: that is what deflate sees
+        if (!started) {
+            ret = deflateInit2(&strm, probe_level(in, have), Z_DEFLATED, WINDOW_SIZE, MEM_LEVEL,
+                               COMPRESSION_STRATEGY);
+            if (ret != Z_OK) {
+                goto CLEANUP;
+            }
+            started = true;
+        }
+
+        strm.next_in = in;
+        strm.avail_in = have;
+        do {
+            strm.next_out = out;
+            strm.avail_out = FILTER_CHUNK_SIZE;
+            ret = deflate(&strm, flush);
+            if (ret == Z_STREAM_ERROR) {
+                goto CLEANUP;
+            }
+            have = FILTER_CHUNK_SIZE - strm.avail_out;
+            if (fwrite(out, 1, have, dest) != have || ferror(dest)) {
+                ret = Z_ERRNO;
+                goto CLEANUP;
+            }
+        } while (strm.avail_out == 0);
+    } while (flush != Z_FINISH);
+
+    ret = ret == Z_STREAM_END ? Z_OK : Z_STREAM_ERROR;
+
+CLEANUP:
+    if (started) {
+        deflateEnd(&strm);
+    }
+    zerr(ret);
+    filter_deinit(&filter);
+    free(in);
+    free(out);
+    return ret;
+}
+
+int inflate_file_filter(FILE *source, FILE *dest, const filter_params_t *params)
+{
+    int ret = Z_OK;
+    size_t fill = 0;
+    filter_t filter;
+    z_stream strm;
+
+    if (filter_init(&filter, params) != ESP_OK) {
+        return Z_STREAM_ERROR;
+    }
+
+    // Output is collected into whole chunks so shuffled blocks come out in one piece
+    size_t chunk = filter_chunk(&filter.params);
+    unsigned char *in = (unsigned char *)malloc(FILTER_CHUNK_SIZE);
+    unsigned char *out = (unsigned char *)malloc(chunk);
+    if (in == NULL || out == NULL) {
+        filter_deinit(&filter);
+        free(in);
+        free(out);
+        return Z_MEM_ERROR;
+    }
+
+    memset(&strm, 0, sizeof(z_stream));
+    ret = inflateInit2(&strm, WINDOW_SIZE);
+    if (ret != Z_OK) {
+        goto CLEANUP;
+    }
+
+    do {
+        strm.avail_in = fread(in, 1, FILTER_CHUNK_SIZE, source);
+        if (ferror(source)) {
+            ret = Z_ERRNO;
+            break;
+        }
+        if (strm.avail_in == 0) {
+            ret = Z_DATA_ERROR;
+            break;
+        }
+        strm.next_in = in;
+
+        do {
+            strm.next_out = out + fill;
+            strm.avail_out = chunk - fill;
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_NEED_DICT || ret == Z_STREAM_ERROR) {
+                ret = Z_DATA_ERROR;
+            }
+            if (ret == Z_DATA_ERROR || ret == Z_MEM_ERROR) {
+                break;
+            }
+            fill = chunk - strm.avail_out;
+
+            if (fill == chunk || ret == Z_STREAM_END) {
+                if (filter_decode(&filter, out, fill) != ESP_OK) {
+                    ret = Z_DATA_ERROR;
+                    break;
+                }
+                if (fwrite(out, 1, fill, dest) != fill || ferror(dest)) {
+                    ret = Z_ERRNO;
+                    break;
+                }
+                fill = 0;
+            }
+        } while (strm.avail_out == 0 && ret != Z_STREAM_END);
+    } while (ret == Z_OK || ret == Z_BUF_ERROR);
+
+    inflateEnd(&strm);
+    ret = ret == Z_STREAM_END ? Z_OK : ret;
+
+CLEANUP:
+    zerr(ret);
+    filter_deinit(&filter);
+    free(in);
+    free(out);
+    return ret;
+}
+
+int deflate_buf_shuffle(const void *in, size_t in_len, unsigned elem_size, bool bits,
+                        unsigned char *out, size_t *out_len)
+{
+    int ret;
+    filter_t filter;
+    z_stream strm;
+    const filter_params_t params = {
+        .type = bits ? FILTER_BITSHUFFLE : FILTER_SHUFFLE,
+        .elem_size = elem_size,
+        .stride = SHUFFLE_BLOCK_SIZE,
+    };
+
+    if (out_len == NULL || *out_len < 1 || filter_init(&filter, &params) != ESP_OK) {
+        return Z_STREAM_ERROR;
+    }
+
+    // Blocks are shuffled in a copy, the caller's array stays as it is
+    unsigned char *block = (unsigned char *)malloc(SHUFFLE_BLOCK_SIZE);
+    if (block == NULL) {
+        filter_deinit(&filter);
+        return Z_MEM_ERROR;
+    }
+
+    out[0] = elem_size | (bits ? SHUFFLE_BITS : 0);
+    memset(&strm, 0, sizeof(z_stream));
+    strm.next_out = out + 1;
+    strm.avail_out = *out_len - 1;
+
+    const unsigned char *src = (const unsigned char *)in;
+    size_t pos = 0;
+    do {
+        size_t n = in_len - pos < SHUFFLE_BLOCK_SIZE ? in_len - pos : SHUFFLE_BLOCK_SIZE;
+        memcpy(block, src + pos, n);
+        if (filter_encode(&filter, block, n) != ESP_OK) {
+            ret = Z_DATA_ERROR;
+            break;
+        }
+
+        if (pos == 0) {
+            ret = deflateInit2(&strm, probe_level(block, n), Z_DEFLATED, DICT_WINDOW_SIZE, MEM_LEVEL,
+                               COMPRESSION_STRATEGY);
+            if (ret != Z_OK) {
+                goto CLEANUP;
+            }
+        }
+        pos += n;
+
+        strm.next_in = block;
+        strm.avail_in = n;
+        ret = deflate(&strm, pos == in_len ? Z_FINISH : Z_NO_FLUSH);
+        if (strm.avail_in > 0) {
+            ret = Z_BUF_ERROR;
+            break;
+        }
+    } while (pos < in_len);
+
+    *out_len = 1 + strm.total_out;
+    ret = ret == Z_STREAM_END ? Z_OK : (ret == Z_OK ? Z_BUF_ERROR : ret);
+    (void)deflateEnd(&strm);
+
+CLEANUP:
+    filter_deinit(&filter);
+    free(block);
+    return ret;
+}
+
+int inflate_buf_shuffle(const unsigned char *in, size_t in_len, void *out, size_t *out_len)
+{
+    int ret;
+    filter_t filter;
+    z_stream strm;
+
+    if (out_len == NULL || in_len < 1) {
+        return Z_STREAM_ERROR;
+    }
+
+    const filter_params_t params = {
+        .type = (in[0] & SHUFFLE_BITS) ? FILTER_BITSHUFFLE : FILTER_SHUFFLE,
+        .elem_size = in[0] & ~SHUFFLE_BITS,
+        .stride = SHUFFLE_BLOCK_SIZE,
+    };
+    if (filter_init(&filter, &params) != ESP_OK) {
+        return Z_DATA_ERROR;
+    }
+
+    memset(&strm, 0, sizeof(z_stream));
+    strm.next_in = (z_const Bytef *)in + 1;
+    strm.avail_in = in_len - 1;
+
+    ret = inflateInit2(&strm, DICT_WINDOW_SIZE);
+    if (ret != Z_OK) {
+        filter_deinit(&filter);
+        return ret;
+    }
+
+    strm.next_out = (Bytef *)out;
+    strm.avail_out = *out_len;
+    ret = inflate(&strm, Z_FINISH);
+    *out_len -= strm.avail_out;
+    (void)inflateEnd(&strm);
+
+    if (ret == Z_STREAM_END) {
+        ret = filter_decode(&filter, (uint8_t *)out, *out_len) == ESP_OK ? Z_OK : Z_DATA_ERROR;
+    } else if (ret == Z_OK || ret == Z_NEED_DICT) {
+        ret = ret == Z_OK ? Z_BUF_ERROR : Z_DATA_ERROR;
+    }
+    filter_deinit(&filter);
+    return ret;
+}
+
+int deflate_dict_prepare(const unsigned char *dict, unsigned dict_len, zlib_dict_t **out)
+{
+    int ret;
+
+    if (dict == NULL || dict_len == 0 || out == NULL) {
+        return Z_STREAM_ERROR;
+    }
+
+    zlib_dict_t *d = (zlib_dict_t *)calloc(1, sizeof(zlib_dict_t));
+    if (d == NULL) {
+        return Z_MEM_ERROR;
+    }
+
+    d->primed.zalloc = Z_NULL;
+    d->primed.zfree = Z_NULL;
+    d->primed.opaque = Z_NULL;
+
+    ret = deflateInit2(&d->primed, COMPRESSION_LEVEL, Z_DEFLATED, DICT_WINDOW_SIZE, MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        free(d);
+        return ret;
+    }
+
+    ret = deflateSetDictionary(&d->primed, dict, dict_len);
+    if (ret != Z_OK) {
+        (void)deflateEnd(&d->primed);
+        free(d);
+        return ret;
+    }
+
+    d->data = dict;
+    d->len = dict_len;
+    *out = d;
+    return Z_OK;
+}
+
+int deflate_buf_dict(const zlib_dict_t *dict, const unsigned char *in, size_t in_len,
+                     unsigned char *out, size_t *out_len)
+{
+    int ret;
+    z_stream strm;
+
+    if (dict == NULL || out_len == NULL) {
+        return Z_STREAM_ERROR;
+    }
+
+    // deflateCopy() only copies the hashed window; the dictionary is not re-inserted
+    ret = deflateCopy(&strm, (z_streamp)&dict->primed);
+    if (ret != Z_OK) {
+        return ret;
+    }
+
+    strm.next_in = (z_const Bytef *)in;
+    strm.avail_in = in_len;
+    strm.next_out = out;
+    strm.avail_out = *out_len;
+
+    ret = deflate(&strm, Z_FINISH);
+    *out_len -= strm.avail_out;
+    (void)deflateEnd(&strm);
+
+    if (ret == Z_STREAM_END) {
+        return Z_OK;
+    }
+    return ret == Z_OK ? Z_BUF_ERROR : ret;
+}
+
+int inflate_buf_dict(const zlib_dict_t *dict, const unsigned char *in, size_t in_len,
+                     unsigned char *out, size_t *out_len)
+{
+    int ret;
+    z_stream strm;
+
+    if (dict == NULL || out_len == NULL) {
+        return Z_STREAM_ERROR;
+    }
+
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.next_in = (z_const Bytef *)in;
+    strm.avail_in = in_len;
+
+    ret = inflateInit2(&strm, DICT_WINDOW_SIZE);
+    if (ret != Z_OK) {
+        return ret;
+    }
+
+    strm.next_out = out;
+    strm.avail_out = *out_len;
+
+    ret = inflate(&strm, Z_FINISH);
+    if (ret == Z_NEED_DICT) {
+        ret = inflateSetDictionary(&strm, dict->data, dict->len);
+        if (ret == Z_OK) {
+            ret = inflate(&strm, Z_FINISH);
+        }
+    }
+    *out_len -= strm.avail_out;
+    (void)inflateEnd(&strm);
+
+    if (ret == Z_STREAM_END) {
+        return Z_OK;
+    }
+    return ret == Z_OK ? Z_BUF_ERROR : ret;
+}
+
+void deflate_dict_free(zlib_dict_t *dict)
+{
+    if (dict == NULL) {
+        return;
+    }
+    (void)deflateEnd(&dict->primed);
+    free(dict);
+}
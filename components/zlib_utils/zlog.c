@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "zlib.h"
+#include "bgzf.h"
+#include "zlog.h"
+
+static const char *TAG = "zlog";
+
+struct zlog {
+    char *path;
+    char *name;                 // Scratch for rotated file names
+    FILE *file;
+    size_t file_size;           // Compressed bytes in the current file
+    bgzf_writer_t *writer;
+    unsigned char *buf;
+    size_t buf_len;
+    size_t buf_size;
+};
+
+/*
+    Walk the members of an existing log and cut it after the last complete one.
+    Anything that is not a member header is left alone: it is not our file.
+*/
+static int repair(const char *path, size_t *size)
+{
+    int ret = Z_OK;
+    unsigned char header[BGZF_HEADER_SIZE];
+    struct stat st;
+    size_t pos = 0, csize;
+
+    *size = 0;
+    if (stat(path, &st) != 0) {
+        return Z_OK;
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return Z_ERRNO;
+    }
+
+    while (pos < (size_t)st.st_size) {
+        if (fseek(file, pos, SEEK_SET) != 0) {
+            ret = Z_ERRNO;
+            break;
+        }
+        if (fread(header, 1, BGZF_HEADER_SIZE, file) != BGZF_HEADER_SIZE) {
+            break;
+        }
+        if (bgzf_member_size(header, &csize) != Z_OK) {
+            ESP_LOGE(TAG, "%s is not a compressed log", path);
+            ret = Z_DATA_ERROR;
+            break;
+        }
+        if (pos + csize > (size_t)st.st_size) {
+            break;
+        }
+        pos += csize;
+    }
+    fclose(file);
+
+    if (ret == Z_OK && pos < (size_t)st.st_size) {
+        ESP_LOGW(TAG, "Dropping %u bytes of an incomplete member", (unsigned)(st.st_size - pos));
+        if (truncate(path, pos) != 0) {
+            ret = Z_ERRNO;
+        }
+    }
+    *size = pos;
+    return ret;
+}
+
+static int sync_file(FILE *file)
+{
+    if (fflush(file) != 0 || fsync(fileno(file)) != 0) {
+        return Z_ERRNO;
+    }
+    return Z_OK;
+}
+
+// path.n, path itself for n == 0
+static const char *rotated_name(zlog_t *log, int n)
+{
+    if (n == 0) {
+        return log->path;
+    }
+    sprintf(log->name, "%s.%d", log->path, n);
+    return log->name;
+}
+
+static int rotate(zlog_t *log)
+{
+    char *from;
+
+    fclose(log->file);
+    log->file = NULL;
+
+    ESP_LOGI(TAG, "Rotating %s at %u bytes", log->path, (unsigned)log->file_size);
+
+    unlink(rotated_name(log, ZLOG_ROTATE_FILES));
+    for (int n = ZLOG_ROTATE_FILES; n > 0; n--) {
+        from = strdup(rotated_name(log, n - 1));
+        if (from == NULL) {
+            return Z_MEM_ERROR;
+        }
+        rename(from, rotated_name(log, n));
+        free(from);
+    }
+
+    log->file = fopen(log->path, "ab");
+    log->file_size = 0;
+    return log->file == NULL ? Z_ERRNO : Z_OK;
+}
+
+static int write_member(zlog_t *log)
+{
+    int ret;
+    size_t written;
+
+    if (log->buf_len == 0) {
+        return Z_OK;
+    }
+    if (log->file == NULL) {
+        return Z_ERRNO;
+    }
+
+    ret = bgzf_write(log->writer, log->buf, log->buf_len, log->file, &written);
+    if (ret == Z_OK) {
+        ret = sync_file(log->file);
+    }
+    if (ret != Z_OK) {
+        return ret;
+    }
+    log->buf_len = 0;
+    log->file_size += written;
+
+    if (ZLOG_ROTATE_SIZE > 0 && log->file_size >= ZLOG_ROTATE_SIZE) {
+        return rotate(log);
+    }
+    return Z_OK;
+}
+
+int zlog_open(const char *path, zlog_t **out)
+{
+    int ret;
+
+    zlog_t *log = (zlog_t *)calloc(1, sizeof(zlog_t));
+    if (log == NULL) {
+        return Z_MEM_ERROR;
+    }
+
+    log->path = strdup(path);
+    log->name = (char *)malloc(strlen(path) + 12);
+    if (log->path == NULL || log->name == NULL) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    ret = bgzf_writer_create(ZLOG_BUFFER_SIZE, &log->writer);
+    if (ret != Z_OK) {
+        goto CLEANUP;
+    }
+    log->buf_size = bgzf_writer_block(log->writer);
+    log->buf = (unsigned char *)malloc(log->buf_size);
+    if (log->buf == NULL) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    ret = repair(path, &log->file_size);
+    if (ret != Z_OK) {
+        goto CLEANUP;
+    }
+
+    log->file = fopen(path, "ab");
+    if (log->file == NULL) {
+        ret = Z_ERRNO;
+        goto CLEANUP;
+    }
+
+    ESP_LOGI(TAG, "Appending to %s at %u bytes", path, (unsigned)log->file_size);
+    *out = log;
+    return Z_OK;
+
+CLEANUP:
+    bgzf_writer_free(log->writer);
+    free(log->buf);
+    free(log->name);
+    free(log->path);
+    free(log);
+    return ret;
+}
+
+int zlog_write(zlog_t *log, const void *data, size_t len)
+{
+    int ret;
+    const unsigned char *p = (const unsigned char *)data;
+
+    while (len > 0) {
+        size_t n = log->buf_size - log->buf_len < len ? log->buf_size - log->buf_len : len;
+        memcpy(log->buf + log->buf_len, p, n);
+        log->buf_len += n;
+        p += n;
+        len -= n;
+
+        if (log->buf_len == log->buf_size) {
+            ret = write_member(log);
+            if (ret != Z_OK) {
+                return ret;
+            }
+        }
+    }
+    return Z_OK;
+}
+
+int zlog_flush(zlog_t *log)
+{
+    return write_member(log);
+}
+
+int zlog_close(zlog_t *log)
+{
+    if (log == NULL) {
+        return Z_OK;
+    }
+
+    int ret = write_member(log);
+
+    if (log->file != NULL) {
+        fclose(log->file);
+    }
+    bgzf_writer_free(log->writer);
+    free(log->buf);
+    free(log->name);
+    free(log->path);
+    free(log);
+    return ret;
+}
@@ -0,0 +1,518 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "zlib.h"
+#include "esp_timer.h"
+#include "probe.h"
+#include "zlib_utils.h"
+#include "zpipe.h"
+
+#ifdef ESP_PLATFORM
+#include "esp_pthread.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#endif
+
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+#define WINDOW_SIZE (WINDOW_BITS | CONFIG_GZIP_ENCODING)
+#define MEM_LEVEL (CONFIG_MEM_LEVEL)
+#define COMPRESSION_LEVEL (CONFIG_COMPRESSION_LEVEL)
+#define COMPRESSION_STRATEGY (CONFIG_COMPRESSION_STRATEGY)
+#define IO_STACK_SIZE (4096)
+
+// Adaptive level: input buffers between decisions, and how much faster than the sink the
+// compressor must be before it may spend more CPU per byte
+#define ADAPT_INTERVAL (8)
+#define ADAPT_HEADROOM_PCT (125)
+
+static const char *TAG = "zpipe";
+
+// Fixed buffers handed from one stage to the next, in order
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    unsigned char *bufs[ZPIPE_DEPTH];
+    size_t lens[ZPIPE_DEPTH];
+    unsigned head;              // Oldest filled buffer
+    unsigned count;             // Filled buffers
+    bool closed;                // Producer is done
+    bool aborted;               // Consumer or producer failed, stop everything
+} zpipe_queue_t;
+
+typedef struct {
+    FILE *source;
+    FILE *dest;
+    zpipe_queue_t in;
+    zpipe_queue_t out;
+    int io_ret;                 // First reader or writer failure (Z_ERRNO),
+    int64_t write_us;           // sink time and bytes since the last level decision,
+    size_t write_bytes;         // all under out.lock
+} zpipe_t;
+
+static int queue_init(zpipe_queue_t *q)
+{
+    memset(q, 0, sizeof(zpipe_queue_t));
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->cond, NULL);
+    for (int i = 0; i < ZPIPE_DEPTH; i++) {
+        q->bufs[i] = (unsigned char *)malloc(ZPIPE_CHUNK_SIZE);
+        if (q->bufs[i] == NULL) {
+            return Z_MEM_ERROR;
+        }
+    }
+    return Z_OK;
+}
+
+static void queue_deinit(zpipe_queue_t *q)
+{
+    for (int i = 0; i < ZPIPE_DEPTH; i++) {
+        free(q->bufs[i]);
+    }
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->cond);
+}
+
+// Producer side: the next free buffer, NULL once aborted
+static unsigned char *queue_get_free(zpipe_queue_t *q)
+{
+    unsigned char *buf = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == ZPIPE_DEPTH && !q->aborted) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+    if (!q->aborted) {
+        buf = q->bufs[(q->head + q->count) % ZPIPE_DEPTH];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return buf;
+}
+
+static void queue_put(zpipe_queue_t *q, size_t len)
+{
+    pthread_mutex_lock(&q->lock);
+    q->lens[(q->head + q->count) % ZPIPE_DEPTH] = len;
+    q->count++;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+// Consumer side: the oldest filled buffer, NULL when closed and drained or aborted
+static unsigned char *queue_get_filled(zpipe_queue_t *q, size_t *len)
+{
+    unsigned char *buf = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->count == 0 && !q->closed && !q->aborted) {
+        pthread_cond_wait(&q->cond, &q->lock);
+    }
+    if (q->count > 0 && !q->aborted) {
+        buf = q->bufs[q->head];
+        *len = q->lens[q->head];
+    }
+    pthread_mutex_unlock(&q->lock);
+    return buf;
+}
+
+static void queue_release(zpipe_queue_t *q)
+{
+    pthread_mutex_lock(&q->lock);
+    q->head = (q->head + 1) % ZPIPE_DEPTH;
+    q->count--;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static void queue_close(zpipe_queue_t *q, bool abort)
+{
+    pthread_mutex_lock(&q->lock);
+    q->closed = true;
+    q->aborted |= abort;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+}
+
+static bool queue_aborted(zpipe_queue_t *q)
+{
+    pthread_mutex_lock(&q->lock);
+    bool aborted = q->aborted;
+    pthread_mutex_unlock(&q->lock);
+    return aborted;
+}
+
+// Reader and writer can fail at the same time, the first error is kept
+static void zpipe_io_error(zpipe_t *p, int err)
+{
+    pthread_mutex_lock(&p->out.lock);
+    if (p->io_ret == Z_OK) {
+        p->io_ret = err;
+    }
+    pthread_mutex_unlock(&p->out.lock);
+}
+
+static void *zpipe_reader(void *arg)
+{
+    zpipe_t *p = (zpipe_t *)arg;
+    unsigned char *buf;
+
+    while ((buf = queue_get_free(&p->in)) != NULL) {
+        size_t len = fread(buf, 1, ZPIPE_CHUNK_SIZE, p->source);
+        if (ferror(p->source)) {
+            zpipe_io_error(p, Z_ERRNO);
+            queue_close(&p->in, true);
+            return NULL;
+        }
+        if (len > 0) {
+            queue_put(&p->in, len);
+        }
+        if (feof(p->source)) {
+            break;
+        }
+    }
+    queue_close(&p->in, false);
+    return NULL;
+}
+
+static void *zpipe_writer(void *arg)
+{
+    zpipe_t *p = (zpipe_t *)arg;
+    unsigned char *buf;
+    size_t len;
+
+    while ((buf = queue_get_filled(&p->out, &len)) != NULL) {
+        int64_t start = esp_timer_get_time();
+        if (fwrite(buf, 1, len, p->dest) != len || ferror(p->dest)) {
+            zpipe_io_error(p, Z_ERRNO);
+            queue_close(&p->out, true);
+            // Unblock the reader too, the compressor notices on its next buffer
+            queue_close(&p->in, true);
+            return NULL;
+        }
+        pthread_mutex_lock(&p->out.lock);
+        p->write_us += esp_timer_get_time() - start;
+        p->write_bytes += len;
+        pthread_mutex_unlock(&p->out.lock);
+        queue_release(&p->out);
+    }
+    return NULL;
+}
+
+// Hand every full output buffer to the writer and continue in a fresh one
+static int zpipe_drain(zpipe_t *p, z_stream *strm, unsigned char **out, bool last)
+{
+    if (strm->avail_out > 0 && !last) {
+        return Z_OK;
+    }
+    queue_put(&p->out, ZPIPE_CHUNK_SIZE - strm->avail_out);
+    if (last) {
+        return Z_OK;
+    }
+    *out = queue_get_free(&p->out);
+    if (*out == NULL) {
+        return Z_ERRNO;
+    }
+    strm->next_out = *out;
+    strm->avail_out = ZPIPE_CHUNK_SIZE;
+    return Z_OK;
+}
+
+/*
+    One level step per interval: up while the compressor outruns the sink with headroom to
+    spare, down once it falls behind. Rates are compressed bytes per microsecond of deflate()
+    and of fwrite(), so they compare directly whatever the level does to the ratio.
+*/
+static int zpipe_adapt(zpipe_t *p, int level, const zpipe_adapt_t *adapt,
+                       int64_t deflate_us, size_t deflate_bytes)
+{
+    pthread_mutex_lock(&p->out.lock);
+    int64_t write_us = p->write_us;
+    size_t write_bytes = p->write_bytes;
+    p->write_us = 0;
+    p->write_bytes = 0;
+    pthread_mutex_unlock(&p->out.lock);
+
+    if (write_bytes == 0 || write_us == 0 || deflate_bytes == 0 || deflate_us == 0) {
+        return level;
+    }
+
+    // deflate_bytes / deflate_us against write_bytes / write_us, cross multiplied
+    uint64_t deflate_rate = (uint64_t)deflate_bytes * (uint64_t)write_us;
+    uint64_t write_rate = (uint64_t)write_bytes * (uint64_t)deflate_us;
+
+    if (deflate_rate * 100 > write_rate * ADAPT_HEADROOM_PCT && level < adapt->max_level) {
+        level++;
+    } else if (deflate_rate < write_rate && level > adapt->min_level) {
+        level--;
+    }
+    return level;
+}
+
+// Switch levels between input buffers; deflateParams() may need output space to end a block
+static int zpipe_set_level(zpipe_t *p, z_stream *strm, unsigned char **out, int level)
+{
+    int ret;
+
+    while ((ret = deflateParams(strm, level, COMPRESSION_STRATEGY)) == Z_BUF_ERROR) {
+        if (zpipe_drain(p, strm, out, false) != Z_OK) {
+            return Z_ERRNO;
+        }
+    }
+    return ret;
+}
+
+static int zpipe_deflate(zpipe_t *p, const zpipe_adapt_t *adapt, zpipe_adapt_stats_t *stats)
+{
+    int ret = Z_OK;
+    bool started = false, adapting = false;
+    unsigned char *in, *out;
+    size_t len, deflate_bytes = 0;
+    int64_t deflate_us = 0;
+    int level = COMPRESSION_LEVEL;
+    unsigned buffers = 0;
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(z_stream));
+    out = queue_get_free(&p->out);
+    if (out == NULL) {
+        return Z_ERRNO;
+    }
+    strm.next_out = out;
+    strm.avail_out = ZPIPE_CHUNK_SIZE;
+
+    for (;;) {
+        in = queue_get_filled(&p->in, &len);
+        if (in == NULL && queue_aborted(&p->in)) {
+            ret = Z_ERRNO;
+            break;
+        }
+
+        if (!started) {
+            probe_verdict_t verdict = probe_data(in, in == NULL ? 0 : len);
+            if (verdict == PROBE_STORE) {
+                level = Z_NO_COMPRESSION;
+            } else if (adapt != NULL) {
+                // Incompressible data stays stored, anything else starts fast and works up
+                level = adapt->min_level;
+                adapting = true;
+            } else if (verdict == PROBE_FAST && level != Z_NO_COMPRESSION) {
+                level = Z_BEST_SPEED;
+            }
+            ret = deflateInit2(&strm, level, Z_DEFLATED, WINDOW_SIZE, MEM_LEVEL, COMPRESSION_STRATEGY);
+            if (ret != Z_OK) {
+                break;
+            }
+            started = true;
+        }
+
+        if (adapting && in != NULL && ++buffers % ADAPT_INTERVAL == 0) {
+            int next = zpipe_adapt(p, level, adapt, deflate_us, deflate_bytes);
+            deflate_us = 0;
+            deflate_bytes = 0;
+            if (next != level) {
+                ret = zpipe_set_level(p, &strm, &out, next);
+                if (ret != Z_OK) {
+                    break;
+                }
+                level = next;
+                if (stats != NULL) {
+                    stats->level_changes++;
+                }
+            }
+        }
+
+        strm.next_in = in;
+        strm.avail_in = in == NULL ? 0 : len;
+        if (stats != NULL && level >= 0) {
+            stats->bytes_at_level[level] += strm.avail_in;
+        }
+        int flush = in == NULL ? Z_FINISH : Z_NO_FLUSH;
+        do {
+            int64_t start = esp_timer_get_time();
+            uLong before = strm.total_out;
+            ret = deflate(&strm, flush);
+            deflate_us += esp_timer_get_time() - start;
+            deflate_bytes += strm.total_out - before;
+            if (ret == Z_STREAM_ERROR) {
+                break;
+            }
+            if (zpipe_drain(p, &strm, &out, ret == Z_STREAM_END) != Z_OK) {
+                ret = Z_ERRNO;
+                break;
+            }
+        } while (ret != Z_STREAM_END && (strm.avail_in > 0 || flush == Z_FINISH));
+
+        if (in == NULL || (ret != Z_OK && ret != Z_BUF_ERROR)) {
+            break;
+        }
+        queue_release(&p->in);
+    }
+    if (ret == Z_STREAM_END) {
+        ret = Z_OK;
+    }
+
+    if (stats != NULL) {
+        stats->level = level;
+    }
+    if (started) {
+        deflateEnd(&strm);
+    }
+    return ret;
+}
+
+static int zpipe_inflate(zpipe_t *p)
+{
+    int ret;
+    unsigned char *in, *out;
+    size_t len;
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(z_stream));
+    ret = inflateInit2(&strm, WINDOW_SIZE);
+    if (ret != Z_OK) {
+        return ret;
+    }
+
+    out = queue_get_free(&p->out);
+    if (out == NULL) {
+        inflateEnd(&strm);
+        return Z_ERRNO;
+    }
+    strm.next_out = out;
+    strm.avail_out = ZPIPE_CHUNK_SIZE;
+
+    while (ret != Z_STREAM_END) {
+        in = queue_get_filled(&p->in, &len);
+        if (in == NULL) {
+            ret = queue_aborted(&p->in) ? Z_ERRNO : Z_DATA_ERROR;
+            break;
+        }
+
+        strm.next_in = in;
+        strm.avail_in = len;
+        do {
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_NEED_DICT || ret == Z_STREAM_ERROR) {
+                ret = Z_DATA_ERROR;
+            }
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                break;
+            }
+            int drained = zpipe_drain(p, &strm, &out, ret == Z_STREAM_END);
+            if (drained != Z_OK) {
+                ret = drained;
+                break;
+            }
+        } while (ret != Z_STREAM_END && strm.avail_in > 0);
+
+        queue_release(&p->in);
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            break;
+        }
+    }
+
+    inflateEnd(&strm);
+    return ret == Z_STREAM_END ? Z_OK : ret;
+}
+
+// Create a thread for an I/O stage, on the other core where there is one
+static int zpipe_start(pthread_t *tid, void *(*fn)(void *), zpipe_t *p)
+{
+#if defined(ESP_PLATFORM) && !CONFIG_FREERTOS_UNICORE
+    esp_pthread_cfg_t prev;
+    bool restore = esp_pthread_get_cfg(&prev) == ESP_OK;
+    esp_pthread_cfg_t cfg = esp_pthread_get_default_config();
+
+    cfg.pin_to_core = !xPortGetCoreID();
+    cfg.stack_size = IO_STACK_SIZE;
+    esp_pthread_set_cfg(&cfg);
+    int ret = pthread_create(tid, NULL, fn, p);
+    if (!restore) {
+        prev = esp_pthread_get_default_config();
+    }
+    esp_pthread_set_cfg(&prev);
+    return ret;
+#else
+    return pthread_create(tid, NULL, fn, p);
+#endif
+}
+
+static int zpipe_run(FILE *source, FILE *dest, bool compress,
+                     const zpipe_adapt_t *adapt, zpipe_adapt_stats_t *stats)
+{
+    int ret;
+    pthread_t reader, writer;
+    bool reading = false, writing = false;
+
+    zpipe_t *p = (zpipe_t *)calloc(1, sizeof(zpipe_t));
+    if (p == NULL) {
+        return Z_MEM_ERROR;
+    }
+    p->source = source;
+    p->dest = dest;
+    p->io_ret = Z_OK;
+
+    // Both queues are set up before checking, so both can be torn down
+    ret = queue_init(&p->in);
+    if (queue_init(&p->out) != Z_OK || ret != Z_OK) {
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    reading = zpipe_start(&reader, zpipe_reader, p) == 0;
+    writing = reading && zpipe_start(&writer, zpipe_writer, p) == 0;
+    if (!writing) {
+        ESP_LOGE(TAG, "Could not start I/O threads");
+        queue_close(&p->in, true);
+        ret = Z_MEM_ERROR;
+        goto CLEANUP;
+    }
+
+    ret = compress ? zpipe_deflate(p, adapt, stats) : zpipe_inflate(p);
+
+    // Stop the reader (input after the end of an inflated stream is ignored) and let the writer
+    // finish what it has unless something failed
+    queue_close(&p->in, true);
+    queue_close(&p->out, ret != Z_OK);
+
+CLEANUP:
+    if (reading) {
+        pthread_join(reader, NULL);
+    }
+    if (writing) {
+        pthread_join(writer, NULL);
+    }
+    // A failed read or write also shows up as an error in the zlib stage
+    if (p->io_ret != Z_OK) {
+        ret = p->io_ret;
+    }
+    queue_deinit(&p->in);
+    queue_deinit(&p->out);
+    free(p);
+    zerr(ret);
+    return ret;
+}
+
+int deflate_file_pipelined(FILE *source, FILE *dest)
+{
+    return zpipe_run(source, dest, true, NULL, NULL);
+}
+
+int inflate_file_pipelined(FILE *source, FILE *dest)
+{
+    return zpipe_run(source, dest, false, NULL, NULL);
+}
+
+int deflate_file_adaptive(FILE *source, FILE *dest, const zpipe_adapt_t *adapt, zpipe_adapt_stats_t *stats)
+{
+    if (adapt == NULL || adapt->min_level < Z_BEST_SPEED || adapt->max_level > Z_BEST_COMPRESSION ||
+        adapt->min_level > adapt->max_level) {
+        return Z_STREAM_ERROR;
+    }
+    if (stats != NULL) {
+        memset(stats, 0, sizeof(zpipe_adapt_stats_t));
+    }
+    return zpipe_run(source, dest, true, adapt, stats);
+}
@@ -0,0 +1,367 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "zlib.h"
+#include "zran.h"
+
+#define WINDOW_BITS ((CONFIG_WINDOW_SIZE == 8) ? 9 : CONFIG_WINDOW_SIZE)
+#define MEM_LEVEL (CONFIG_MEM_LEVEL)
+#define COMPRESSION_LEVEL (CONFIG_COMPRESSION_LEVEL)
+
+#define ZRAN_CHUNK (4096)
+#define ZRAN_AUTO_HEADER (15 + 32)  // Detect gzip or zlib, largest window
+#define INDEX_GROW (8)
+
+static const char *TAG = "zran";
+
+typedef struct {
+    size_t out;                 // Uncompressed offset
+    long in;                    // Compressed offset of the first whole byte after the point
+    int bits;                   // Bits of the byte before it that belong to the point (0-7)
+    unsigned dict_len;          // Output before the point held in the window, up to 32K
+    unsigned win_len;           // Stored window size, less than dict_len when compressed
+    unsigned char *window;
+} zran_point_t;
+
+struct zran_index {
+    zran_point_t *points;
+    size_t count;
+    size_t size;
+};
+
+typedef struct {
+    z_stream strm;
+    unsigned char *window;      // Current inflate window, also the discarded output
+#if CONFIG_ZRAN_COMPRESS_WINDOWS
+    z_stream def;
+    unsigned char *packed;
+    unsigned packed_size;
+#endif
+} zran_build_t;
+
+static int add_point(zran_index_t *index, zran_build_t *b, int bits, long in, size_t out)
+{
+    int ret;
+    unsigned dict_len;
+
+    if (index->count % INDEX_GROW == 0) {
+        zran_point_t *grown = (zran_point_t *)realloc(index->points, (index->count + INDEX_GROW) * sizeof(zran_point_t));
+        if (grown == NULL) {
+            return Z_MEM_ERROR;
+        }
+        index->points = grown;
+    }
+
+    ret = inflateGetDictionary(&b->strm, b->window, &dict_len);
+    if (ret != Z_OK) {
+        return ret;
+    }
+
+    zran_point_t *point = &index->points[index->count];
+    point->out = out;
+    point->in = in;
+    point->bits = bits;
+    point->dict_len = dict_len;
+
+#if CONFIG_ZRAN_COMPRESS_WINDOWS
+    deflateReset(&b->def);
+    b->def.next_in = b->window;
+    b->def.avail_in = dict_len;
+    b->def.next_out = b->packed;
+    b->def.avail_out = b->packed_size;
+    if (deflate(&b->def, Z_FINISH) != Z_STREAM_END) {
+        return Z_BUF_ERROR;
+    }
+    point->win_len = b->def.total_out;
+    point->window = (unsigned char *)malloc(point->win_len ? point->win_len : 1);
+    if (point->window == NULL) {
+        return Z_MEM_ERROR;
+    }
+    memcpy(point->window, b->packed, point->win_len);
+#else
+    point->win_len = dict_len;
+    point->window = (unsigned char *)malloc(dict_len ? dict_len : 1);
+    if (point->window == NULL) {
+        return Z_MEM_ERROR;
+    }
+    memcpy(point->window, b->window, dict_len);
+#endif
+
+    index->count++;
+    return Z_OK;
+}
+
+int zran_index_build(FILE *source, zran_index_t **out)
+{
+    int ret;
+    long totin = 0;
+    size_t totout = 0, last = 0;
+    zran_build_t b;
+
+    memset(&b, 0, sizeof(b));
+    unsigned char *in = (unsigned char *)malloc(ZRAN_CHUNK);
+    b.window = (unsigned char *)malloc(ZRAN_WINDOW);
+    zran_index_t *index = (zran_index_t *)calloc(1, sizeof(zran_index_t));
+
+    if (in == NULL || b.window == NULL || index == NULL) {
+        free(in);
+        free(b.window);
+        free(index);
+        return Z_MEM_ERROR;
+    }
+
+    ret = inflateInit2(&b.strm, ZRAN_AUTO_HEADER);
+    if (ret != Z_OK) {
+        goto CLEANUP;
+    }
+
+#if CONFIG_ZRAN_COMPRESS_WINDOWS
+    ret = deflateInit2(&b.def, COMPRESSION_LEVEL, Z_DEFLATED, -WINDOW_BITS, MEM_LEVEL, Z_DEFAULT_STRATEGY);
+    if (ret != Z_OK) {
+        (void)inflateEnd(&b.strm);
+        goto CLEANUP;
+    }
+    b.packed_size = deflateBound(&b.def, ZRAN_WINDOW);
+    b.packed = (unsigned char *)malloc(b.packed_size);
+    if (b.packed == NULL) {
+        ret = Z_MEM_ERROR;
+        goto END;
+    }
+#endif
+
+    ESP_LOGI(TAG, "Building index");
+
+    b.strm.avail_out = 0;
+    do {
+        b.strm.avail_in = fread(in, 1, ZRAN_CHUNK, source);
+        if (ferror(source)) {
+            ret = Z_ERRNO;
+            goto END;
+        }
+        if (b.strm.avail_in == 0) {
+            ret = Z_DATA_ERROR;
+            goto END;
+        }
+        b.strm.next_in = in;
+
+        do {
+            // Output is only needed through inflate's own window
+            if (b.strm.avail_out == 0) {
+                b.strm.avail_out = ZRAN_WINDOW;
+                b.strm.next_out = b.window;
+            }
+
+            totin += b.strm.avail_in;
+            totout += b.strm.avail_out;
+            ret = inflate(&b.strm, Z_BLOCK);
+            totin -= b.strm.avail_in;
+            totout -= b.strm.avail_out;
+            if (ret == Z_NEED_DICT) {
+                ret = Z_DATA_ERROR;
+            }
+            if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+                goto END;
+            }
+            if (ret == Z_STREAM_END) {
+                break;
+            }
+
+            // At the end of the header or of a block that is not the last one
+            if ((b.strm.data_type & 128) && !(b.strm.data_type & 64) && (totout == 0 || totout - last > ZRAN_SPAN)) {
+                ret = add_point(index, &b, b.strm.data_type & 7, totin, totout);
+                if (ret != Z_OK) {
+                    goto END;
+                }
+                last = totout;
+            }
+        } while (b.strm.avail_in != 0);
+    } while (ret != Z_STREAM_END);
+
+    index->size = totout;
+    ret = Z_OK;
+
+END:
+    (void)inflateEnd(&b.strm);
+#if CONFIG_ZRAN_COMPRESS_WINDOWS
+    (void)deflateEnd(&b.def);
+    free(b.packed);
+#endif
+CLEANUP:
+    free(in);
+    free(b.window);
+    if (ret != Z_OK) {
+        zran_index_free(index);
+        return ret;
+    }
+    ESP_LOGI(TAG, "%u access points over %u bytes, %u bytes of windows",
+             (unsigned)index->count, (unsigned)index->size, (unsigned)zran_index_mem(index));
+    *out = index;
+    return Z_OK;
+}
+
+size_t zran_index_size(const zran_index_t *index)
+{
+    return index->size;
+}
+
+size_t zran_index_mem(const zran_index_t *index)
+{
+    size_t mem = sizeof(zran_index_t) + index->count * sizeof(zran_point_t);
+
+    for (size_t i = 0; i < index->count; i++) {
+        mem += index->points[i].win_len;
+    }
+    return mem;
+}
+
+void zran_index_free(zran_index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < index->count; i++) {
+        free(index->points[i].window);
+    }
+    free(index->points);
+    free(index);
+}
+
+// Window of a point into dict (ZRAN_WINDOW bytes)
+static int load_window(const zran_point_t *point, unsigned char *dict)
+{
+#if CONFIG_ZRAN_COMPRESS_WINDOWS
+    int ret;
+    z_stream strm;
+
+    memset(&strm, 0, sizeof(strm));
+    ret = inflateInit2(&strm, -MAX_WBITS);
+    if (ret != Z_OK) {
+        return ret;
+    }
+    strm.next_in = point->window;
+    strm.avail_in = point->win_len;
+    strm.next_out = dict;
+    strm.avail_out = ZRAN_WINDOW;
+
+    ret = inflate(&strm, Z_FINISH);
+    (void)inflateEnd(&strm);
+    return ret == Z_STREAM_END && strm.total_out == point->dict_len ? Z_OK : Z_DATA_ERROR;
+#else
+    memcpy(dict, point->window, point->dict_len);
+    return Z_OK;
+#endif
+}
+
+int zran_extract(FILE *source, const zran_index_t *index, size_t offset,
+                 unsigned char *out, size_t len, size_t *out_len)
+{
+    int ret;
+    z_stream strm;
+
+    *out_len = 0;
+    if (offset >= index->size || len == 0 || index->count == 0) {
+        return Z_OK;
+    }
+
+    // Last point at or before the offset
+    size_t lo = 0, hi = index->count;
+    while (hi - lo > 1) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (index->points[mid].out <= offset) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    const zran_point_t *point = &index->points[lo];
+
+    unsigned char *in = (unsigned char *)malloc(ZRAN_CHUNK);
+    unsigned char *dict = (unsigned char *)malloc(ZRAN_WINDOW);
+    if (in == NULL || dict == NULL) {
+        free(in);
+        free(dict);
+        return Z_MEM_ERROR;
+    }
+
+    memset(&strm, 0, sizeof(strm));
+    ret = inflateInit2(&strm, -MAX_WBITS);
+    if (ret != Z_OK) {
+        goto CLEANUP;
+    }
+
+    if (fseek(source, point->in - (point->bits ? 1 : 0), SEEK_SET) != 0) {
+        ret = Z_ERRNO;
+        goto END;
+    }
+    if (point->bits) {
+        int c = getc(source);
+        if (c == EOF) {
+            ret = ferror(source) ? Z_ERRNO : Z_DATA_ERROR;
+            goto END;
+        }
+        (void)inflatePrime(&strm, point->bits, c >> (8 - point->bits));
+    }
+
+    ret = load_window(point, dict);
+    if (ret == Z_OK) {
+        ret = inflateSetDictionary(&strm, dict, point->dict_len);
+    }
+    if (ret != Z_OK) {
+        goto END;
+    }
+
+    // Inflate into dict (discarded) up to the offset, then into out
+    size_t skip = offset - point->out;
+    int skipping = 1;
+    strm.avail_in = 0;
+    do {
+        if (skip == 0 && skipping) {
+            strm.next_out = out;
+            strm.avail_out = len;
+            skipping = 0;
+        } else if (skip > ZRAN_WINDOW) {
+            strm.next_out = dict;
+            strm.avail_out = ZRAN_WINDOW;
+            skip -= ZRAN_WINDOW;
+        } else if (skip > 0) {
+            strm.next_out = dict;
+            strm.avail_out = skip;
+            skip = 0;
+        }
+
+        do {
+            if (strm.avail_in == 0) {
+                strm.avail_in = fread(in, 1, ZRAN_CHUNK, source);
+                if (ferror(source)) {
+                    ret = Z_ERRNO;
+                    goto END;
+                }
+                if (strm.avail_in == 0) {
+                    ret = Z_DATA_ERROR;
+                    goto END;
+                }
+                strm.next_in = in;
+            }
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (ret == Z_NEED_DICT) {
+                ret = Z_DATA_ERROR;
+            }
+            if (ret == Z_MEM_ERROR || ret == Z_DATA_ERROR) {
+                goto END;
+            }
+        } while (ret != Z_STREAM_END && strm.avail_out != 0);
+    } while (ret != Z_STREAM_END && skipping);
+
+    if (!skipping) {
+        *out_len = len - strm.avail_out;
+    }
+    ret = Z_OK;
+
+END:
+    (void)inflateEnd(&strm);
+CLEANUP:
+    free(in);
+    free(dict);
+    return ret;
+}
@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+
+#include "blockpack.h"
+
+#define LOG_PATH "/spiffs/mixed.log"
+#define COMP_PATH "/spiffs/mixed.bpk"
+#define DECOMP_PATH "/spiffs/mixed.out"
+
+// Size of the random section standing in for an already compressed attachment
+#define RANDOM_SIZE (32 * 1024)
+
+static const char *TAG = "spiffs_blockpack";
+
+// Text and binary sections of the mixed log; upload the files from assets/ to the SPIFFS partition
+static const char *sections[] = {
+    "/spiffs/demo.txt",
+    "/spiffs/hello-world.bin",
+};
+
+esp_err_t init_spiffs(void)
+{
+    ESP_LOGI(TAG, "Initializing SPIFFS");
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGI(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return ESP_FAIL;
+    }
+
+    //Getting SPIFFS info
+    size_t total = 0, used = 0;
+    ret = esp_spiffs_info(NULL, &total, &used);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    }
+
+    return ESP_OK;
+}
+
+int get_file_size(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    return st.st_size;
+}
+
+// Text, random data and a binary image back to back, the way a device log with attachments looks
+esp_err_t build_log(void)
+{
+    esp_err_t ret = ESP_OK;
+    size_t have;
+
+    uint8_t *buf = (uint8_t *)malloc(RANDOM_SIZE);
+    FILE *log = fopen(LOG_PATH, "wb");
+
+    if (buf == NULL || log == NULL) {
+        ret = ESP_FAIL;
+        goto CLEANUP;
+    }
+
+    for (int i = 0; i < sizeof(sections) / sizeof(sections[0]); i++) {
+        FILE *section = fopen(sections[i], "rb");
+        if (section == NULL) {
+            ESP_LOGE(TAG, "Error opening %s", sections[i]);
+            ret = ESP_FAIL;
+            goto CLEANUP;
+        }
+        while ((have = fread(buf, 1, RANDOM_SIZE, section)) > 0) {
+            fwrite(buf, 1, have, log);
+        }
+        fclose(section);
+
+        if (i == 0) {
+            esp_fill_random(buf, RANDOM_SIZE);
+            fwrite(buf, 1, RANDOM_SIZE, log);
+        }
+    }
+    if (ferror(log)) {
+        ret = ESP_FAIL;
+    }
+
+CLEANUP:
+    if (log) fclose(log);
+    free(buf);
+    return ret;
+}
+
+void app_main(void)
+{
+    blockpack_stats_t stats;
+
+    ESP_ERROR_CHECK(init_spiffs());
+    ESP_ERROR_CHECK(build_log());
+
+    FILE *source = fopen(LOG_PATH, "rb");
+    FILE *dest = fopen(COMP_PATH, "wb");
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening files");
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = blockpack_compress_file(source, dest, &stats);
+    int64_t comp_time = esp_timer_get_time() - start;
+    fclose(source);
+    fclose(dest);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Compression failed (%s)", esp_err_to_name(ret));
+        return;
+    }
+
+    source = fopen(COMP_PATH, "rb");
+    dest = fopen(DECOMP_PATH, "wb");
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening files");
+        return;
+    }
+
+    start = esp_timer_get_time();
+    ret = blockpack_decompress_file(source, dest);
+    int64_t decomp_time = esp_timer_get_time() - start;
+    fclose(source);
+    fclose(dest);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Decompression failed (%s)", esp_err_to_name(ret));
+        return;
+    }
+
+    ESP_LOGI(TAG, "%d -> %d bytes, C/R %0.2f | blocks: %u stored, %u deflate, %u brotli",
+             get_file_size(LOG_PATH), get_file_size(COMP_PATH), (float)stats.bytes_in / stats.bytes_out,
+             (unsigned)stats.blocks[BLOCKPACK_STORED], (unsigned)stats.blocks[BLOCKPACK_DEFLATE],
+             (unsigned)stats.blocks[BLOCKPACK_BROTLI]);
+    ESP_LOGI(TAG, "Compression %lld us | Decompression %lld us | round trip size %s",
+             comp_time, decomp_time, get_file_size(DECOMP_PATH) == get_file_size(LOG_PATH) ? "OK" : "MISMATCH");
+
+    unlink(COMP_PATH);
+    unlink(DECOMP_PATH);
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+
+#include "brseek.h"
+
+// Upload assets/hello-world.bin to the SPIFFS partition
+#define FILE_PATH "/spiffs/hello-world.bin"
+#define COMP_PATH "/spiffs/hello-world.brs"
+#define DECOMP_PATH "/spiffs/hello-world.out"
+
+#define READ_OFFSET (100000)
+#define READ_SIZE (256)
+
+static const char *TAG = "spiffs_brseek";
+
+esp_err_t init_spiffs(void)
+{
+    ESP_LOGI(TAG, "Initializing SPIFFS");
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGI(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return ESP_FAIL;
+    }
+
+    //Getting SPIFFS info
+    size_t total = 0, used = 0;
+    ret = esp_spiffs_info(NULL, &total, &used);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    }
+
+    return ESP_OK;
+}
+
+int get_file_size(const char *path)
+{
+    struct stat st;
+
+    if (stat(path, &st) != 0) {
+        return -1;
+    }
+    return st.st_size;
+}
+
+// Read a slice of the original file for comparison
+esp_err_t read_original(size_t offset, uint8_t *buf, size_t len)
+{
+    FILE *file = fopen(FILE_PATH, "rb");
+    if (file == NULL) {
+        return ESP_FAIL;
+    }
+
+    esp_err_t ret = fseek(file, offset, SEEK_SET) == 0 && fread(buf, 1, len, file) == len ? ESP_OK : ESP_FAIL;
+    fclose(file);
+    return ret;
+}
+
+void app_main(void)
+{
+    brseek_t *brseek;
+    size_t got;
+    uint8_t slice[READ_SIZE];
+    uint8_t expected[READ_SIZE];
+
+    ESP_ERROR_CHECK(init_spiffs());
+
+    FILE *source = fopen(FILE_PATH, "rb");
+    FILE *dest = fopen(COMP_PATH, "wb");
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening files");
+        return;
+    }
+
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = brseek_compress_file(source, dest);
+    int64_t comp_time = esp_timer_get_time() - start;
+    fclose(source);
+    fclose(dest);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Compression failed (%s)", esp_err_to_name(ret));
+        return;
+    }
+
+    source = fopen(COMP_PATH, "rb");
+    dest = fopen(DECOMP_PATH, "wb");
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening files");
+        return;
+    }
+
+    start = esp_timer_get_time();
+    ret = brseek_decompress_file(source, dest);
+    int64_t decomp_time = esp_timer_get_time() - start;
+    fclose(dest);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Decompression failed (%s)", esp_err_to_name(ret));
+        fclose(source);
+        return;
+    }
+
+    // Only the chunk holding the slice is decoded
+    start = esp_timer_get_time();
+    ret = brseek_open(source, &brseek);
+    if (ret == ESP_OK) {
+        ret = brseek_read(brseek, READ_OFFSET, slice, READ_SIZE, &got);
+        brseek_close(brseek);
+    }
+    int64_t read_time = esp_timer_get_time() - start;
+    fclose(source);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Read failed (%s)", esp_err_to_name(ret));
+        return;
+    }
+
+    bool match = got == READ_SIZE && read_original(READ_OFFSET, expected, READ_SIZE) == ESP_OK &&
+                 memcmp(slice, expected, READ_SIZE) == 0;
+
+    ESP_LOGI(TAG, "%d -> %d bytes, C/R %0.2f", get_file_size(FILE_PATH), get_file_size(COMP_PATH),
+             (float)get_file_size(FILE_PATH) / get_file_size(COMP_PATH));
+    ESP_LOGI(TAG, "Compression %lld us | Full decompression %lld us | %d bytes at %d: %lld us, %s",
+             comp_time, decomp_time, READ_SIZE, READ_OFFSET, read_time, match ? "OK" : "MISMATCH");
+
+    unlink(COMP_PATH);
+    unlink(DECOMP_PATH);
+}
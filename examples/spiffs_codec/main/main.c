@@ -0,0 +1,131 @@
+#include <stdio.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+
+#include "codec.h"
+
+#define COMP_PATH "/spiffs/bench.cmp"
+#define DECOMP_PATH "/spiffs/bench.out"
+
+static const char *TAG = "spiffs_codec";
+
+// Same corpus for both codecs; upload the files from assets/ to the SPIFFS partition
+static const char *corpus[] = {
+    "/spiffs/demo.txt",
+    "/spiffs/hello-world.bin",
+};
+
+// Per-codec compression heap budget; parameters are scaled down to fit
+#define MEM_BUDGET (64 * 1024)
+
+esp_err_t init_spiffs(void)
+{
+    ESP_LOGI(TAG, "Initializing SPIFFS");
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGI(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return ESP_FAIL;
+    }
+
+    //Getting SPIFFS info
+    size_t total = 0, used = 0;
+    ret = esp_spiffs_info(NULL, &total, &used);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    }
+
+    return ESP_OK;
+}
+
+int run_codec(codec_type_t type, codec_mode_t mode, const char *src_path, const char *dst_path,
+              codec_stats_t *stats)
+{
+    codec_t *codec;
+    FILE *source = fopen(src_path, "rb");
+    FILE *dest = fopen(dst_path, "wb");
+
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening %s or %s", src_path, dst_path);
+        if (source) fclose(source);
+        if (dest) fclose(dest);
+        return ESP_FAIL;
+    }
+
+    // The decompressor window is fixed by the stream, only compression is budgeted
+    esp_err_t ret = codec_create(type, mode, NULL, mode == CODEC_COMPRESS ? MEM_BUDGET : 0, &codec);
+    if (ret == ESP_OK) {
+        ret = codec_file(codec, source, dest);
+        codec_get_stats(codec, stats);
+        codec_destroy(codec);
+    }
+
+    fclose(source);
+    fclose(dest);
+    return ret;
+}
+
+void bench(codec_type_t type, const char *path)
+{
+    codec_stats_t comp, decomp;
+    const char *name = codec_name(type);
+
+    if (run_codec(type, CODEC_COMPRESS, path, COMP_PATH, &comp) != ESP_OK) {
+        ESP_LOGE(TAG, "%s: compression failed", name);
+        return;
+    }
+    if (run_codec(type, CODEC_DECOMPRESS, COMP_PATH, DECOMP_PATH, &decomp) != ESP_OK) {
+        ESP_LOGE(TAG, "%s: decompression failed", name);
+        return;
+    }
+    if (decomp.bytes_out != comp.bytes_in) {
+        ESP_LOGE(TAG, "%s: size mismatch after round trip", name);
+        return;
+    }
+
+    ESP_LOGI(TAG, "%-8s | %s: C/R %0.2f | compress %lld us, peak %d B | decompress %lld us, peak %d B",
+             name, path, (float)comp.bytes_in / comp.bytes_out,
+             comp.time_us, comp.mem_peak, decomp.time_us, decomp.mem_peak);
+}
+
+/*
+    Runs every codec through the same codec_file() loop on the same files.
+    Times are codec time only (SPIFFS I/O excluded), memory is the codec's own peak heap.
+*/
+void app_main(void)
+{
+    ESP_ERROR_CHECK(init_spiffs());
+
+    for (int i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        for (codec_type_t type = 0; type < CODEC_MAX; type++) {
+            bench(type, corpus[i]);
+        }
+    }
+
+    unlink(COMP_PATH);
+    unlink(DECOMP_PATH);
+}
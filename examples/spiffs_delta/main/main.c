@@ -0,0 +1,99 @@
+#include <stdio.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+#include "esp_ota_ops.h"
+
+#include "delta.h"
+
+// Made on the host with: delta_diff old.bin new.bin patch.dlt (old.bin = the image flashed to this device)
+#define PATCH_PATH "/spiffs/patch.dlt"
+
+static const char *TAG = "spiffs_delta";
+
+esp_err_t init_spiffs(void)
+{
+    ESP_LOGI(TAG, "Initializing SPIFFS");
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGI(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return ESP_FAIL;
+    }
+
+    //Getting SPIFFS info
+    size_t total = 0, used = 0;
+    ret = esp_spiffs_info(NULL, &total, &used);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    }
+
+    return ESP_OK;
+}
+
+/*
+    Rebuilds the new firmware in the next OTA slot from the running image and a patch on SPIFFS.
+    The running image is read from flash as the patch needs it; nothing but the decoder state is held in RAM.
+*/
+void app_main(void)
+{
+    esp_ota_handle_t ota;
+
+    ESP_ERROR_CHECK(init_spiffs());
+
+    const esp_partition_t *running = esp_ota_get_running_partition();
+    const esp_partition_t *update = esp_ota_get_next_update_partition(NULL);
+    if (running == NULL || update == NULL) {
+        ESP_LOGE(TAG, "No OTA partitions");
+        return;
+    }
+
+    FILE *patch = fopen(PATCH_PATH, "rb");
+    if (patch == NULL) {
+        ESP_LOGE(TAG, "Error opening %s", PATCH_PATH);
+        return;
+    }
+
+    ESP_ERROR_CHECK(esp_ota_begin(update, OTA_SIZE_UNKNOWN, &ota));
+
+    ESP_LOGI(TAG, "Patching %s into %s, free heap %d", running->label, update->label, esp_get_free_heap_size());
+    int64_t start = esp_timer_get_time();
+    esp_err_t ret = delta_apply_file(patch, delta_partition_read, (void *)running, delta_ota_write, &ota);
+    int64_t time = esp_timer_get_time() - start;
+    fclose(patch);
+
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Patch failed (%s)", esp_err_to_name(ret));
+        esp_ota_abort(ota);
+        return;
+    }
+    ESP_ERROR_CHECK(esp_ota_end(ota));
+    ESP_ERROR_CHECK(esp_ota_set_boot_partition(update));
+
+    ESP_LOGI(TAG, "Patched in %lld us, restarting into %s", time, update->label);
+    unlink(PATCH_PATH);
+    esp_restart();
+}
@@ -0,0 +1,150 @@
+#include <stdio.h>
+
+#include <sys/unistd.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+
+#include "esp_spiffs.h"
+#include "esp_timer.h"
+
+#include "zlib_utils.h"
+#include "lzss.h"
+
+#define COMP_PATH "/spiffs/bench.cmp"
+#define DECOMP_PATH "/spiffs/bench.out"
+
+static const char *TAG = "spiffs_lzss";
+
+// Same corpus for both codecs; upload the files from assets/ to the SPIFFS partition
+static const char *corpus[] = {
+    "/spiffs/demo.txt",
+    "/spiffs/hello-world.bin",
+};
+
+typedef int (*file_codec_t)(FILE *source, FILE *dest);
+
+// Codec state is static: LZSS does not touch the heap
+static lzss_encoder_t encoder;
+static lzss_decoder_t decoder;
+
+esp_err_t init_spiffs(void)
+{
+    ESP_LOGI(TAG, "Initializing SPIFFS");
+
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = "/spiffs",
+        .partition_label = NULL,
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+
+    esp_err_t ret = esp_vfs_spiffs_register(&conf);
+
+    if (ret != ESP_OK) {
+        if (ret == ESP_FAIL) {
+            ESP_LOGE(TAG, "Failed to mount or format filesystem");
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "Failed to find SPIFFS partition");
+        } else {
+            ESP_LOGI(TAG, "Failed to initialize SPIFFS (%s)", esp_err_to_name(ret));
+        }
+        return ESP_FAIL;
+    }
+
+    //Getting SPIFFS info
+    size_t total = 0, used = 0;
+    ret = esp_spiffs_info(NULL, &total, &used);
+    if (ret != ESP_OK) {
+        ESP_LOGI(TAG, "Failed to get SPIFFS partition information (%s)", esp_err_to_name(ret));
+    } else {
+        ESP_LOGI(TAG, "Partition size: total: %d, used: %d", total, used);
+    }
+
+    return ESP_OK;
+}
+
+int get_file_size(const char *file_path)
+{
+    struct stat st;
+    if (stat(file_path, &st) == 0)
+        return st.st_size;
+    return -1;
+}
+
+int run_codec(file_codec_t codec, const char *src_path, const char *dst_path, int64_t *time)
+{
+    FILE *source = fopen(src_path, "rb");
+    FILE *dest = fopen(dst_path, "wb");
+
+    if (source == NULL || dest == NULL) {
+        ESP_LOGE(TAG, "Error opening %s or %s", src_path, dst_path);
+        if (source) fclose(source);
+        if (dest) fclose(dest);
+        return -1;
+    }
+
+    int64_t start = esp_timer_get_time();
+    int ret = codec(source, dest);
+    *time = esp_timer_get_time() - start;
+
+    fclose(source);
+    fclose(dest);
+    return ret;
+}
+
+void bench(const char *name, file_codec_t compress, file_codec_t decompress, const char *path)
+{
+    int64_t comp_time, decomp_time;
+    uint32_t heap_before = esp_get_free_heap_size();
+
+    if (run_codec(compress, path, COMP_PATH, &comp_time) != 0) {
+        ESP_LOGE(TAG, "%s: compression failed", name);
+        return;
+    }
+    uint32_t heap_min = esp_get_minimum_free_heap_size();
+
+    if (run_codec(decompress, COMP_PATH, DECOMP_PATH, &decomp_time) != 0) {
+        ESP_LOGE(TAG, "%s: decompression failed", name);
+        return;
+    }
+
+    int size = get_file_size(path);
+    int comp_size = get_file_size(COMP_PATH);
+
+    ESP_LOGI(TAG, "%s | %s: C/R %0.2f | compress %lld us (%0.2f MB/s) | decompress %lld us (%0.2f MB/s)",
+             name, path, (float)size / comp_size,
+             comp_time, (float)size / comp_time,
+             decomp_time, (float)size / decomp_time);
+    ESP_LOGI(TAG, "%s | Free heap: before %d, minimum so far %d", name, heap_before, heap_min);
+}
+
+int lzss_compress(FILE *source, FILE *dest)
+{
+    return lzss_compress_file(&encoder, source, dest);
+}
+
+int lzss_decompress(FILE *source, FILE *dest)
+{
+    return lzss_decompress_file(&decoder, source, dest);
+}
+
+/*
+    Compares LZSS with deflate at the minimum window and memory level (see sdkconfig.defaults).
+    LZSS state is ~830 bytes in total; the free heap should not move while it runs.
+    Times include SPIFFS I/O, as seen by an application logging to flash.
+*/
+void app_main(void)
+{
+    ESP_ERROR_CHECK(init_spiffs());
+
+    for (int i = 0; i < sizeof(corpus) / sizeof(corpus[0]); i++) {
+        bench("lzss", lzss_compress, lzss_decompress, corpus[i]);
+        bench("deflate", deflate_file, inflate_file, corpus[i]);
+    }
+
+    unlink(COMP_PATH);
+    unlink(DECOMP_PATH);
+}
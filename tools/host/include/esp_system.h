@@ -0,0 +1,29 @@
+#pragma once
+
+// Host stand-in: the heap never runs low unless HOST_FREE_HEAP is defined; pulls in assert() as in IDF
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifndef HOST_FREE_HEAP
+#define HOST_FREE_HEAP (200 * 1024)
+#endif
+
+static inline uint32_t esp_get_free_heap_size(void)
+{
+    return HOST_FREE_HEAP;
+}
+
+static inline uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return HOST_FREE_HEAP;
+}
+
+static inline void esp_fill_random(void *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        ((uint8_t *)buf)[i] = (uint8_t)rand();
+    }
+}
@@ -0,0 +1,146 @@
+#pragma once
+
+// Host stand-in for the generated sdkconfig.h: Kconfig defaults, each can be overridden with -DCONFIG_...
+
+// zlib_utils
+#ifndef CONFIG_ENABLE_GZIP_ENCODING
+#define CONFIG_ENABLE_GZIP_ENCODING 1
+#endif
+#ifndef CONFIG_GZIP_ENCODING
+#define CONFIG_GZIP_ENCODING 16
+#endif
+#ifndef CONFIG_WINDOW_SIZE
+#define CONFIG_WINDOW_SIZE 12
+#endif
+#ifndef CONFIG_MEM_LEVEL
+#define CONFIG_MEM_LEVEL 3
+#endif
+#ifndef CONFIG_COMPRESSION_LEVEL
+#define CONFIG_COMPRESSION_LEVEL -1
+#endif
+#ifndef CONFIG_COMPRESSION_STRATEGY
+#define CONFIG_COMPRESSION_STRATEGY 0
+#endif
+#ifndef CONFIG_ZRAN_SPAN
+#define CONFIG_ZRAN_SPAN 256
+#endif
+#ifndef CONFIG_ZRAN_COMPRESS_WINDOWS
+#define CONFIG_ZRAN_COMPRESS_WINDOWS 1
+#endif
+#ifndef CONFIG_ZLOG_BUFFER_SIZE
+#define CONFIG_ZLOG_BUFFER_SIZE 4096
+#endif
+#ifndef CONFIG_ZLOG_ROTATE_SIZE
+#define CONFIG_ZLOG_ROTATE_SIZE 65536
+#endif
+#ifndef CONFIG_ZLOG_ROTATE_FILES
+#define CONFIG_ZLOG_ROTATE_FILES 2
+#endif
+#ifndef CONFIG_ZPIPE_CHUNK_SIZE
+#define CONFIG_ZPIPE_CHUNK_SIZE 4096
+#endif
+#ifndef CONFIG_ZPIPE_DEPTH
+#define CONFIG_ZPIPE_DEPTH 2
+#endif
+
+// brotli
+#ifndef CONFIG_BROTLI_ENCODER
+#define CONFIG_BROTLI_ENCODER 1
+#endif
+#ifndef CONFIG_BROTLI_DECODER
+#define CONFIG_BROTLI_DECODER 1
+#endif
+
+// codec
+#ifndef CONFIG_CODEC_BUFFER_SIZE
+#define CONFIG_CODEC_BUFFER_SIZE 1024
+#endif
+#ifndef CONFIG_CODEC_BROTLI_QUALITY
+#define CONFIG_CODEC_BROTLI_QUALITY 1
+#endif
+#ifndef CONFIG_CODEC_BROTLI_WINDOW
+#define CONFIG_CODEC_BROTLI_WINDOW 16
+#endif
+
+// probe
+#ifndef CONFIG_PROBE_SAMPLE_SIZE
+#define CONFIG_PROBE_SAMPLE_SIZE 4096
+#endif
+#ifndef CONFIG_PROBE_STORE_RATIO
+#define CONFIG_PROBE_STORE_RATIO 97
+#endif
+#ifndef CONFIG_PROBE_FAST_RATIO
+#define CONFIG_PROBE_FAST_RATIO 85
+#endif
+
+// fastlz
+#ifndef CONFIG_FASTLZ_BLOCK_SIZE
+#define CONFIG_FASTLZ_BLOCK_SIZE 4096
+#endif
+#ifndef CONFIG_FASTLZ_HASH_LOG
+#define CONFIG_FASTLZ_HASH_LOG 10
+#endif
+
+// lzss
+#ifndef CONFIG_LZSS_WINDOW_BITS
+#define CONFIG_LZSS_WINDOW_BITS 8
+#endif
+#ifndef CONFIG_LZSS_LOOKAHEAD_BITS
+#define CONFIG_LZSS_LOOKAHEAD_BITS 4
+#endif
+#ifndef CONFIG_LZSS_DECODER_INPUT_SIZE
+#define CONFIG_LZSS_DECODER_INPUT_SIZE 32
+#endif
+
+// blockpack
+#ifndef CONFIG_BLOCKPACK_BLOCK_SIZE
+#define CONFIG_BLOCKPACK_BLOCK_SIZE 16384
+#endif
+#ifndef CONFIG_BLOCKPACK_BROTLI_QUALITY
+#define CONFIG_BLOCKPACK_BROTLI_QUALITY 5
+#endif
+#ifndef CONFIG_BLOCKPACK_BROTLI_RATIO
+#define CONFIG_BLOCKPACK_BROTLI_RATIO 50
+#endif
+
+// brseek
+#ifndef CONFIG_BRSEEK_CHUNK_SIZE
+#define CONFIG_BRSEEK_CHUNK_SIZE 65536
+#endif
+#ifndef CONFIG_BRSEEK_QUALITY
+#define CONFIG_BRSEEK_QUALITY 5
+#endif
+#ifndef CONFIG_BRSEEK_BUFFER_SIZE
+#define CONFIG_BRSEEK_BUFFER_SIZE 4096
+#endif
+
+// delta
+#ifndef CONFIG_DELTA_BUFFER_SIZE
+#define CONFIG_DELTA_BUFFER_SIZE 1024
+#endif
+
+// cring
+#ifndef CONFIG_CRING_PAGE_SIZE
+#define CONFIG_CRING_PAGE_SIZE 1024
+#endif
+#ifndef CONFIG_CRING_CACHE_PAGES
+#define CONFIG_CRING_CACHE_PAGES 2
+#endif
+
+// gorilla
+#ifndef CONFIG_GORILLA_BLOCK_SIZE
+#define CONFIG_GORILLA_BLOCK_SIZE 1024
+#endif
+
+// compsvc
+#ifndef CONFIG_COMPSVC_QUEUE_SIZE
+#define CONFIG_COMPSVC_QUEUE_SIZE 8
+#endif
+#ifndef CONFIG_COMPSVC_STACK_SIZE
+#define CONFIG_COMPSVC_STACK_SIZE 6144
+#endif
+
+// cring page codec choice
+#if !defined(CONFIG_CRING_CODEC_FASTLZ) && !defined(CONFIG_CRING_CODEC_DEFLATE)
+#define CONFIG_CRING_CODEC_FASTLZ 1
+#endif